@@ -1,28 +1,137 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
-#include <map>
+#include <variant>
 
 #include "can_interface.h"
+#include "dense_lut.hpp"
 #include "esp_can.h"
+#include "fixed_point.hpp"
+#include "flat_lut.hpp"
+#include "grid_lut.hpp"
 #include "lut_can.hpp"
+#include "lut_store.hpp"
+#include "throttle_brake_driver.hpp"
 #include "virtualTimer.h"
 
 class Lookup {
  public:
   Lookup(ICAN& can_interface, VirtualTimerGroup& timers)
-      : can_interface(can_interface), timers(timers) {};
+      : can_interface(can_interface), timers(timers) {
+    for (size_t profile = 0; profile < kNumProfiles; profile++) {
+      profile_banks[profile] = static_cast<uint8_t>(profile);
+      load_defaults(banks[profile], static_cast<DriveProfile>(profile));
+    }
+    attach_throttle_tables(active_bank.load(), 0);
+  };
   // Max current/torque we can request from Inverter (in mA)
   // current:torque is ~1:1
   enum class TorqueReqLimit { kAccelMax = 235000, kRegenMax = 235000 };
 
   enum class PWMLimit { kPumpMax = 255, kFanMax = 255 };
 
+  // kDense: throttle curves are read from tables precomputed for every throttle index
+  // kInterpolated: throttle curves are searched and interpolated on every call
+  // kTorqueMap: one bilinear lookup in the pedal x rpm map baked from the curves above
+  enum class ThrottleLUTMode { kInterpolated = 0, kDense = 1, kTorqueMap = 2 };
+
+  // builds the mode's tables in every slot that lacks them, in place: call it before the control
+  // loop runs (or from it), not while another core may be in a control call
+  void set_throttle_LUT_mode(ThrottleLUTMode mode);
+
+  // every calibration table, also the table field of a CAN upload
+  enum class TableID : uint8_t {
+    kIGBTTemp2Modifier = 0,
+    kBatteryTemp2Modifier,
+    kMotorTemp2Modifier,
+    kRPM2Throttle,
+    kAccelThrottle2Modifier,
+    kRegenThrottle2Modifier,
+    kMotorRPM2RegenMax,
+    kMotorTemp2PumpDutyCycle,
+    kIGBTTemp2PumpDutyCycle,
+    kBatteryTemp2PumpDutyCycle,
+    kCoolantTemp2FanDutyCycle,
+    kCount
+  };
+
+  // complete table sets prebuilt at boot, switched from the dash or over CAN. Every profile starts
+  // as the base calibration and only differs once its own tables are uploaded
+  enum class DriveProfile : uint8_t { kAutocross = 0, kEndurance, kWet, kCount };
+
+  // switch profiles at the next updateCANLUTs(), an unknown profile is ignored
+  void request_profile(DriveProfile profile);
+  DriveProfile active_profile() const;
+
+  // one calibration for a whole control tick: every stage between begin and end reads the same
+  // tables, so a profile switch or upload lands on a tick boundary
+  void begin_control_cycle() { pin_calibration(); }
+  void end_control_cycle() { unpin_calibration(); }
+
+  // profile requests, then uploads (into the active profile)
   void updateCANLUTs();
 
-  void update_status_CAN();
+  // kInstalled: built in the spare bank and published
+  // kUnchanged: already the table in use
+  // kInvalid: failed validation, the table in use is kept
+  // kBusy: the control path still holds the spare bank, retry on the next call
+  // also the result byte of the 0x20A response. kSequenceReused is sent for an upload the
+  // receiver refused because it reused its table's last sequence: resend it with a new one
+  enum class InstallResult {
+    kInstalled = 0,
+    kUnchanged = 1,
+    kInvalid = 2,
+    kBusy = 3,
+    kSequenceReused = 4
+  };
 
-  float lookup(int16_t key, const std::map<int16_t, float>& lut);
+  // validate a table, build it into a copy of the active profile off the control path and publish
+  // the copy with one index flip
+  InstallResult install_LUT(TableID id, const FlatLUT& lut, uint8_t lut_id);
+
+  // several tables published together: begin copies a profile's calibration into the spare bank,
+  // stage replaces tables in the copy, publish rebuilds what depends on them and hands the copy to
+  // the profile (and the control path, for the active profile)
+  InstallResult begin_calibration_update();
+  InstallResult begin_calibration_update(DriveProfile profile);
+  InstallResult stage_LUT(TableID id, const FlatLUT& lut, uint8_t lut_id);
+  void publish_calibration_update();
+
+  // upload ID of a table in use (0 for the built in default)
+  uint8_t LUT_id(TableID id) const;
+
+  // boot: publish the uploaded tables of the newest valid stored image over the profile defaults,
+  // false (defaults kept) if there is none
+  bool load_calibration(LUTStore& store);
+  // store every profile if one changed since the last load / save, false otherwise
+  bool save_calibration(LUTStore& store);
+  // writer only: something was published since the last load / save
+  bool has_unsaved_calibration() const { return unsaved_calibration; }
+
+
+  float lookup(int16_t key, const FlatLUT& lut);
+  float lookup(int16_t key, const FlatLUT& lut, LUTCursor& cursor);
+
+  // segment cache hits / misses summed over every cached table
+  struct LUTCacheStats {
+    uint32_t hits;
+    uint32_t misses;
+  };
+  LUTCacheStats get_LUT_cache_stats() const;
+
+  // what the status frames (0x20B - 0x20D) carry, taken on the control core
+  struct StatusCAN {
+    uint8_t torque_status = 0;
+    bool IGBT_temp_limiting = false;
+    bool battery_temp_limiting = false;
+    bool motor_temp_limiting = false;
+    int32_t regen_max = 0;
+    LUTCacheStats cache_stats{0, 0};
+  };
+  StatusCAN get_status_CAN() const;
+  // CAN I/O core: the signals are only written where their frames are encoded
+  void update_status_CAN(const StatusCAN& status);
 
   template <typename IntT>
   IntT scale(float value, IntT max);
@@ -41,10 +150,95 @@ class Lookup {
   std::pair<int32_t, int32_t> calculate_torque_reqs(int16_t motor_rpm, float temp_mod,
                                                     std::pair<float, float> torque_mods);
 
+  // returns <accel_torque, regen_torque> in mA for the whole chain (pedal -> temps -> request)
+  // built with -D LUT_FIXED_POINT this runs the integer-only pipeline, otherwise the float one
+  std::pair<int32_t, int32_t> get_torque_reqs(int16_t real_throttle, int16_t throttle_max,
+                                              int16_t motor_rpm, bool brake_pressed,
+                                              int16_t igbt_temp, int16_t batt_temp,
+                                              int16_t motor_temp);
+
+  // float reference pipeline
+  std::pair<int32_t, int32_t> get_torque_reqs_float(int16_t real_throttle, int16_t throttle_max,
+                                                    int16_t motor_rpm, bool brake_pressed,
+                                                    int16_t igbt_temp, int16_t batt_temp,
+                                                    int16_t motor_temp);
+
+  // integer-only (Q15) pipeline, no float math between the sensor inputs and the mA request except
+  // converting the one value kDense / kTorqueMap read from their (float) tables
+  std::pair<int32_t, int32_t> get_torque_reqs_fixed(int16_t real_throttle, int16_t throttle_max,
+                                                    int16_t motor_rpm, bool brake_pressed,
+                                                    int16_t igbt_temp, int16_t batt_temp,
+                                                    int16_t motor_temp);
+
+  /* Q15 versions of the pipeline stages above */
+  int16_t get_throttle_index_fixed(int16_t real_throttle, int16_t throttle_max, int16_t motor_rpm);
+
+  // returns <accel_mod, regen_mod>
+  std::pair<q15_t, q15_t> get_torque_mods_fixed(int16_t real_throttle, int16_t throttle_max,
+                                                int16_t motor_rpm, bool brake_pressed);
+
+  q15_t calculate_temp_mod_fixed(int16_t igbt_temp, int16_t batt_temp, int16_t motor_temp);
+
+  int32_t get_regen_max_fixed(int16_t motor_rpm);
+
+  // returns <accel_torque, regen_torque>
+  std::pair<int32_t, int32_t> calculate_torque_reqs_fixed(int16_t motor_rpm, q15_t temp_mod,
+                                                          std::pair<q15_t, q15_t> torque_mods);
+
   uint8_t calculate_pump_duty_cycle(int16_t motor_temp, int16_t igbt_temp, int16_t batt_temp);
 
   uint8_t calculate_fan_duty_cycle(float coolant_temp);
 
+  // everything derived from one temperature snapshot
+  struct ThermalFrame {
+    float temp_mod;  // torque derating product
+#ifdef LUT_FIXED_POINT
+    q15_t temp_mod_q15;  // same, for the integer pipeline
+#endif
+    bool igbt_limiting;
+    bool batt_limiting;
+    bool motor_limiting;
+    uint8_t pump_duty_cycle;
+    uint8_t fan_duty_cycle;
+  };
+
+  // calculate_temp_mod + calculate_pump_duty_cycle + calculate_fan_duty_cycle in one pass, each
+  // sensor's segment search is shared by its modifier and pump tables. The last frame is reused
+  // while the readings (whole degrees) and the calibration stay the same. With LUT_FIXED_POINT
+  // only the Q15 lookups run, temp_mod is then temp_mod_q15 as a float; without it only the float
+  // ones run and the frame has no temp_mod_q15
+  ThermalFrame calculate_thermal_frame(int16_t motor_temp, int16_t igbt_temp, int16_t batt_temp,
+                                       float coolant_temp);
+
+  // get_torque_reqs with the derating taken from a thermal frame of the same tick
+  std::pair<int32_t, int32_t> get_torque_reqs(int16_t real_throttle, int16_t throttle_max,
+                                              int16_t motor_rpm, bool brake_pressed,
+                                              const ThermalFrame& thermal);
+
+  /* Batch evaluation for host tools (log replay, calibration sweeps, exhaustive checks) */
+  // table in use, not pinned: don't hold on to it across an upload
+  const FlatLUT& table(TableID id) const;
+
+  // out[i] = lookup(keys[i], table) for i in [0, n)
+  void lookup_batch(TableID id, const int16_t* keys, float* out, size_t n) const;
+
+  // one logged control loop input
+  struct TorqueInputs {
+    int16_t real_throttle;
+    int16_t throttle_max;
+    int16_t motor_rpm;
+    bool brake_pressed;
+    int16_t igbt_temp;
+    int16_t batt_temp;
+    int16_t motor_temp;
+  };
+
+  // out[i] = get_torque_reqs_float(inputs[i]...) for i in [0, n), stage by stage with batch table
+  // lookups, in any ThrottleLUTMode (the torque map itself is looked up per input, GridLUT has no
+  // batch path). Does not touch the CAN status signals or the segment caches.
+  void get_torque_reqs_batch(const TorqueInputs* inputs, std::pair<int32_t, int32_t>* out,
+                             size_t n);
+
  private:
   ICAN& can_interface;
   VirtualTimerGroup& timers;
@@ -54,9 +248,12 @@ class Lookup {
   enum class TempLimitingType { kNotLimiting = 0, kLimiting = 1 };
   enum class TorqueStatusType { kZero = 0, kAccel = 1, kRegen = 2 };
 
+  // index into the per sensor temp limiting flags
+  enum TempModIndex : uint8_t { kIGBTTempMod = 0, kBatteryTempMod, kMotorTempMod, kNumTempMods };
+
   struct CANData {
     TorqueStatusType torque_status;
-    std::vector<TempLimitingType> temp_limiting_statuses;
+    TempLimitingType temp_limiting_statuses[kNumTempMods];
     int32_t regen_max_value;
   };
 
@@ -68,6 +265,76 @@ class Lookup {
 
   Lookup::TempLimitingType is_temp_limiting(float temp_mod);
 
+  // last inputs / outputs of the temp derating stage, reused while the temperatures don't change
+  template <typename ModT>
+  struct TempModCache {
+    bool valid = false;
+    int16_t igbt_temp = 0;
+    int16_t batt_temp = 0;
+    int16_t motor_temp = 0;
+    ModT temp_mod{};
+    TempLimitingType statuses[kNumTempMods] = {};
+    uint32_t generation = 0;  // calibration the result was computed with
+
+    bool matches(int16_t igbt, int16_t batt, int16_t motor, uint32_t calibration) const {
+      return valid && igbt == igbt_temp && batt == batt_temp && motor == motor_temp &&
+             calibration == generation;
+    }
+  };
+  TempModCache<float> temp_mod_cache;
+  TempModCache<q15_t> temp_mod_fixed_cache;
+
+  // last calculate_thermal_frame() result, keyed like TempModCache plus the rounded coolant temp
+  struct ThermalFrameCache {
+    bool valid = false;
+    int16_t motor_temp = 0;
+    int16_t igbt_temp = 0;
+    int16_t batt_temp = 0;
+    int16_t coolant_temp = 0;
+    uint32_t generation = 0;
+    ThermalFrame frame{};
+    TempLimitingType statuses[kNumTempMods] = {};
+
+    bool matches(int16_t motor, int16_t igbt, int16_t batt, int16_t coolant,
+                 uint32_t calibration) const {
+      return valid && motor == motor_temp && igbt == igbt_temp && batt == batt_temp &&
+             coolant == coolant_temp && calibration == generation;
+    }
+  };
+  ThermalFrameCache thermal_frame_cache;
+
+  // record a fresh result in cache and publish its flags for update_status_CAN
+  template <typename ModT>
+  ModT store_temp_mod(TempModCache<ModT>& cache, int16_t igbt_temp, int16_t batt_temp,
+                      int16_t motor_temp, uint32_t generation, ModT temp_mod);
+  void set_temp_limiting_statuses(const TempLimitingType (&statuses)[kNumTempMods]);
+
+  // segment caches for the tables read with slowly varying inputs (rpm, temperatures, pedal)
+  enum class LUTCursorID : uint8_t {
+    kRPM2Throttle = 0,
+    kMotorRPM2RegenMax,
+    kIGBTTemp2Modifier,
+    kBatteryTemp2Modifier,
+    kMotorTemp2Modifier,
+    kMotorTemp2PumpDutyCycle,
+    kIGBTTemp2PumpDutyCycle,
+    kBatteryTemp2PumpDutyCycle,
+    kCoolantTemp2FanDutyCycle,
+    kTorqueMapRPM,
+    kTorqueMapPedal,
+    kCount
+  };
+  LUTCursor lut_cursors[static_cast<size_t>(LUTCursorID::kCount)];
+  LUTCursor& cursor(LUTCursorID id) { return lut_cursors[static_cast<size_t>(id)]; }
+
+  int16_t get_throttle_index_from_zero_dot(int16_t real_throttle, int16_t throttle_max,
+                                           int16_t zero_dot);
+
+  std::pair<float, float> get_torque_mods_from_map(int16_t real_throttle, int16_t throttle_max,
+                                                   int16_t motor_rpm, bool brake_pressed);
+  // the torque map's pedal axis is in SENSOR_SCALED_MAX units
+  static int16_t map_pedal(int16_t real_throttle, int16_t throttle_max);
+
   CANSignal<bool, 0, 1, CANTemplateConvertFloat(1), CANTemplateConvertFloat(0), false>
       IGBT_Temp_Limiting{};
   CANSignal<bool, 1, 1, CANTemplateConvertFloat(1), CANTemplateConvertFloat(0), false>
@@ -85,69 +352,240 @@ class Lookup {
   CANTXMessage<2> ECU_Torque_Status{can_interface, 0x20C,          1, 100, timers,
                                     Torque_Status, Regen_Max_Value};
 
+  CANSignal<uint32_t, 0, 32, CANTemplateConvertFloat(1), CANTemplateConvertFloat(0), false>
+      LUT_Cache_Hits{};
+  CANSignal<uint32_t, 32, 32, CANTemplateConvertFloat(1), CANTemplateConvertFloat(0), false>
+      LUT_Cache_Misses{};
+  CANTXMessage<2> ECU_LUT_Cache_Status{can_interface, 0x20D,          8, 100, timers,
+                                       LUT_Cache_Hits, LUT_Cache_Misses};
+
   /* Power limit modifier LUTs */
   // IGBT temp : Power limit modifier
-  const std::map<int16_t, float> IGBTTemp2Modifier_LUT{
+  static constexpr FlatLUT IGBTTemp2Modifier_LUT{
       {0, 1.0},    {10, 1.0},   {20, 1.0},   {30, 1.0}, {40, 1.0},  {50, 1.0},
       {60, 1.0},   {70, 1.0},   {80, 1.0},   {90, 1.0}, {100, 1.0}, {110, 0.9},
       {120, 0.75}, {130, 0.25}, {140, 0.05}, {150, 0.0}};
 
   // Battery temp : Power limit modifier
-  const std::map<int16_t, float> BatteryTemp2Modifier_LUT{
+  static constexpr FlatLUT BatteryTemp2Modifier_LUT{
       {0, 1.0},  {5, 1.0},  {10, 1.0}, {15, 1.0},  {20, 1.0},  {25, 1.0}, {30, 1.0},
       {35, 1.0}, {40, 1.0}, {45, 1.0}, {50, 0.75}, {55, 0.25}, {60, 0.0},
   };
 
   // Motor temp : Power limit modifier
-  const std::map<int16_t, float> MotorTemp2Modifier_LUT{
+  static constexpr FlatLUT MotorTemp2Modifier_LUT{
       {0, 1.0},  {10, 1.0},  {20, 1.0},  {30, 1.0},  {40, 1.0},   {50, 1.0}, {60, 1.0},
       {70, 1.0}, {80, 0.95}, {90, 0.75}, {100, 0.2}, {110, 0.05}, {120, 0.0}};
 
   // Motor RPM : throttle %
-  const std::map<int16_t, float> RPM2Throttle_LUT{
+  static constexpr FlatLUT RPM2Throttle_LUT{
       {0, 0.0},     {200, 0.0},   {400, 0.07},  {600, 0.12},  {800, 0.16},
       {1000, 0.19}, {1200, 0.21}, {1400, 0.23}, {1600, 0.24}, {1800, 0.24},
       {2000, 0.24}, {2200, 0.24}, {2400, 0.24}, {2600, 0.24}, {10000, 0.25}};
 
   // Throttle value : power limit modifier (Accel)
-  const std::map<int16_t, float> DefaultAccelThrottle2Modifier_LUT{
+  static constexpr FlatLUT DefaultAccelThrottle2Modifier_LUT{
       {0, 0.0},     {102, 0.03},  {205, 0.09},  {307, 0.16},  {409, 0.23},  {512, 0.3},
       {614, 0.37},  {716, 0.44},  {819, 0.51},  {921, 0.58},  {1024, 0.65}, {1126, 0.72},
       {1228, 0.78}, {1331, 0.83}, {1433, 0.88}, {1535, 0.92}, {1638, 0.95}, {1740, 0.97},
       {1842, 0.98}, {1945, 0.99}, {2047, 1.0}};
 
-  std::map<int16_t, float> AccelThrottle2Modifier_LUT = DefaultAccelThrottle2Modifier_LUT;
-
   // Throttle value : power limit modifier (Regen)
-  const std::map<int16_t, float> RegenThrottle2Modifier_LUT{
+  static constexpr FlatLUT RegenThrottle2Modifier_LUT{
       {0, 0.0},     {102, 0.01},  {205, 0.02},  {307, 0.03},  {409, 0.04},  {512, 0.05},
       {614, 0.07},  {716, 0.11},  {819, 0.17},  {921, 0.24},  {1024, 0.32}, {1126, 0.43},
       {1228, 0.54}, {1331, 0.65}, {1433, 0.77}, {1535, 0.85}, {1638, 0.91}, {1740, 0.95},
       {1842, 0.97}, {1945, 0.99}, {2047, 1.0}};
 
-  const std::map<int16_t, float> MotorRPM2RegenMax_LUT{
+  // throttle index (0 - SENSOR_SCALED_MAX) : modifier, rebuilt whenever the source table changes
+  static constexpr size_t kThrottleIndexRange = static_cast<size_t>(Bounds::SENSOR_SCALED_MAX) + 1;
+
+  ThrottleLUTMode throttle_LUT_mode = ThrottleLUTMode::kDense;
+
+  // Motor RPM x pedal (0 - SENSOR_SCALED_MAX) : signed torque modifier, accel > 0 > regen.
+  // Pedal columns are packed below 25% where the zero torque point (and the whole regen curve)
+  // sits, rows are every 100 rpm over the range where the zero torque point moves.
+  static constexpr FlatLUT TorqueMapRPMAxis = FlatLUT::axis(
+      {0,    100,  200,  300,  400,  500,  600,  700,  800,  900,  1000, 1100, 1200, 1300,
+       1400, 1500, 1600, 1700, 1800, 1900, 2000, 2100, 2200, 2300, 2400, 2500, 2600, 10000});
+  static constexpr FlatLUT TorqueMapPedalAxis = FlatLUT::axis(
+      {0,   27,  54,  81,  108, 135, 162, 189,  216,  243,  270,  297,  324,  351,  378,  405,
+       432, 459, 486, 513, 641, 769, 897, 1024, 1152, 1280, 1408, 1536, 1664, 1791, 1919, 2047});
+
+  static constexpr size_t kNumTables = static_cast<size_t>(TableID::kCount);
+  static constexpr size_t kNumProfiles = static_cast<size_t>(DriveProfile::kCount);
+  static_assert(kNumTables * kNumProfiles <= kMaxStoredLUTs && kNumTables <= kMaxUploadTables,
+                "every table of every profile can be stored and uploaded");
+
+  // the throttle curves precomputed for kDense / for kTorqueMap
+  struct DenseThrottleLUTs {
+    DenseLUT<kThrottleIndexRange> accel;
+    DenseLUT<kThrottleIndexRange> regen;
+  };
+  using TorqueMap = GridLUT<TorqueMapRPMAxis.size(), TorqueMapPedalAxis.size()>;
+  // only what throttle_LUT_mode reads: the dense copies and the torque map share the space,
+  // nothing is kept for kInterpolated (see build_throttle_tables())
+  using ThrottleTables = std::variant<std::monostate, DenseThrottleLUTs, TorqueMap>;
+
+  // SMOOTH_STEP tables a bank precomputes, e.g. the accel and regen curves
+  static constexpr size_t kMaxSmoothTables = 2;
+
+  // one complete calibration: every table, where it came from and what is precomputed from it.
+  // Each profile owns a bank and one more is spare. The control path only reads the active bank,
+  // updates are built in the spare one and published by flipping active_bank
+  struct CalibrationBank {
+    // in LUTStore's layout, so the banks are saved as they are
+    StoredLUT tables[kNumTables];
+    uint32_t generation = 0;  // unique per build of a bank, across banks
+    // each pump table has its temp modifier table's keys (true for the defaults), so
+    // calculate_thermal_frame can share one segment search between them
+    bool pump_keys_shared = true;
+    // the slot holding this bank's throttle tables, null while the bank can't be read
+    const ThrottleTables* throttle_tables = nullptr;
+    // the precomputed curves of the bank's first kMaxSmoothTables SMOOTH_STEP tables (in table
+    // order), any further ones work out their segment on every lookup
+    CubicSegments cubics[kMaxSmoothTables];
+
+    const FlatLUT& table(TableID id) const { return tables[static_cast<size_t>(id)].lut; }
+    uint8_t lut_id(TableID id) const { return tables[static_cast<size_t>(id)].lut_id; }
+    // the mode's tables, only valid in that mode
+    const DenseThrottleLUTs& dense() const {
+      return *std::get_if<DenseThrottleLUTs>(throttle_tables);
+    }
+    const TorqueMap& torque_map() const { return *std::get_if<TorqueMap>(throttle_tables); }
+    bool has_throttle_tables(ThrottleLUTMode mode) const {
+      switch (mode) {
+        case ThrottleLUTMode::kDense:
+          return throttle_tables != nullptr &&
+                 std::holds_alternative<DenseThrottleLUTs>(*throttle_tables);
+        case ThrottleLUTMode::kTorqueMap:
+          return throttle_tables != nullptr &&
+                 std::holds_alternative<TorqueMap>(*throttle_tables);
+        case ThrottleLUTMode::kInterpolated:
+        default:
+          return true;
+      }
+    }
+  };
+  static constexpr size_t kNumBanks = kNumProfiles + 1;
+  CalibrationBank banks[kNumBanks];
+  std::atomic<uint8_t> active_bank{0};
+  // bank the control path is reading (kNoBank between calls), never rebuilt by an update
+  static constexpr uint8_t kNoBank = kNumBanks;
+  std::atomic<uint8_t> pinned_bank{kNoBank};
+  // The throttle tables are ~16 KB, so only the banks a control call can read have them: the
+  // active one and the one it replaced, which a call that started before the flip may still be
+  // reading. A bank gets a slot when it becomes active (see free_throttle_slot())
+  static constexpr size_t kNumThrottleSlots = 2;
+  static constexpr uint8_t kNoSlot = kNumThrottleSlots;
+  ThrottleTables throttle_slots[kNumThrottleSlots];
+  // writer only: the bank each slot was built for
+  uint8_t throttle_slot_banks[kNumThrottleSlots] = {kNoBank, kNoBank};
+  // writer only: bank of each profile, the bank that belongs to none, the last generation given
+  uint8_t profile_banks[kNumProfiles] = {};
+  uint8_t spare_bank = kNumProfiles;
+  DriveProfile current_profile = DriveProfile::kAutocross;
+  uint32_t last_generation = 0;
+  // dash / CAN requests for updateCANLUTs(), kNoProfileRequest once taken
+  static constexpr uint8_t kNoProfileRequest = 0xFF;
+  std::atomic<uint8_t> requested_profile{kNoProfileRequest};
+  // control thread only: PinnedCalibration nesting depth and the bank pinned by the outermost
+  uint8_t pin_depth = 0;
+  const CalibrationBank* pinned_calibration = nullptr;
+  // writer only: a begin_calibration_update() is open for updating_profile / tables staged since
+  bool updating = false;
+  DriveProfile updating_profile = DriveProfile::kAutocross;
+  uint8_t staged_tables = 0;
+  // writer only: published since the last load_calibration() / save_calibration()
+  bool unsaved_calibration = false;
+
+  const CalibrationBank& pin_calibration();
+  void unpin_calibration();
+
+  // keeps the active calibration pinned for the rest of a control call, nests
+  class PinnedCalibration {
+   public:
+    explicit PinnedCalibration(Lookup& lookup) : lookup(lookup), bank(lookup.pin_calibration()) {}
+    ~PinnedCalibration() { lookup.unpin_calibration(); }
+    PinnedCalibration(const PinnedCalibration&) = delete;
+    PinnedCalibration& operator=(const PinnedCalibration&) = delete;
+
+    const CalibrationBank* operator->() const { return &bank; }
+
+   private:
+    Lookup& lookup;
+    const CalibrationBank& bank;
+  };
+
+  // the flash default of each table, the same for every profile
+  static const FlatLUT& default_table(TableID id);
+  void load_defaults(CalibrationBank& bank, DriveProfile profile);
+
+  // flip to a profile's bank, writer side. False while no throttle slot is free for it
+  bool select_profile(DriveProfile profile);
+
+  // pump_keys_shared and the SMOOTH_STEP curves, the throttle tables are built when the bank gets
+  // a slot
+  void build_derived(CalibrationBank& bank);
+
+  // writer only: the bank's own slot, else one no control call can be reading, else kNoSlot
+  uint8_t free_throttle_slot(uint8_t bank) const;
+  // writer only: build the bank's throttle tables in the slot, the slot's last bank loses them
+  void attach_throttle_tables(uint8_t bank, uint8_t slot);
+  void detach_throttle_tables(uint8_t bank);
+
+  // the dense copies or the torque map, whichever throttle_LUT_mode reads
+  void build_throttle_tables(ThrottleTables& tables, const CalibrationBank& bank);
+
+  // evaluate the zero point / pedal rescale / accel + regen curve chain at every grid point
+  void build_torque_map(TorqueMap& torque_map, const CalibrationBank& bank);
+
+  static constexpr FlatLUT MotorRPM2RegenMax_LUT{
       {0, 0.0},     {200, 0.0},   {400, 0.03},  {600, 0.18}, {800, 0.55},
       {1000, 0.74}, {1200, 0.87}, {1400, 0.95}, {1600, 1.0}, {1800, 1.0},
       {2000, 1.0},  {2200, 1.0},  {2400, 1.0},  {2600, 1.0}, {10000, 1.0}};
 
   // Motor temp : Pump duty cycle
-  const std::map<int16_t, float> MotorTemp2PumpDutyCycle_LUT{
+  static constexpr FlatLUT MotorTemp2PumpDutyCycle_LUT{
       {0, 0.0},  {10, 0.0},  {20, 0.0}, {30, 0.0},  {40, 0.1},  {50, 0.25}, {60, 0.5},
       {70, 0.8}, {80, 0.95}, {90, 1.0}, {100, 1.0}, {110, 1.0}, {120, 1.0}};
 
   // IGBT Temp : Pump duty cycle
-  const std::map<int16_t, float> IGBTTemp2PumpDutyCycle_LUT{
+  static constexpr FlatLUT IGBTTemp2PumpDutyCycle_LUT{
       {0, 0.0},   {10, 0.0},  {20, 0.0},  {30, 0.0}, {40, 0.0},  {50, 0.1},
       {60, 0.3},  {70, 0.55}, {80, 0.75}, {90, 0.9}, {100, 1.0}, {110, 1.0},
       {120, 1.0}, {130, 1.0}, {140, 1.0}, {150, 1.0}};
 
   // Battery Temp : Pump duty cycle
-  const std::map<int16_t, float> BatteryTemp2PumpDutyCycle_LUT{
+  static constexpr FlatLUT BatteryTemp2PumpDutyCycle_LUT{
       {0, 0.0},  {5, 0.0},  {10, 0.0}, {15, 0.0}, {20, 0.0}, {25, 0.0}, {30, 0.0},
       {35, 0.1}, {40, 0.4}, {45, 0.7}, {50, 0.9}, {55, 1.0}, {60, 1.0}};
 
   // Coolant Temp : Fan duty cycle
-  const std::map<int16_t, float> CoolantTemp2FanDutyCycle_LUT{
+  static constexpr FlatLUT CoolantTemp2FanDutyCycle_LUT{
       {0, 0.0},  {5, 0.0},  {10, 0.0}, {15, 0.0},  {20, 0.0}, {25, 0.05}, {30, 0.15},
       {35, 0.4}, {40, 0.7}, {45, 0.9}, {50, 0.97}, {55, 1.0}, {60, 1.0}};
+
+  // calibration tables are checked at compile time
+  static_assert(IGBTTemp2Modifier_LUT.is_valid(), "IGBTTemp2Modifier_LUT is invalid");
+  static_assert(BatteryTemp2Modifier_LUT.is_valid(), "BatteryTemp2Modifier_LUT is invalid");
+  static_assert(MotorTemp2Modifier_LUT.is_valid(), "MotorTemp2Modifier_LUT is invalid");
+  static_assert(RPM2Throttle_LUT.is_valid(), "RPM2Throttle_LUT is invalid");
+  static_assert(DefaultAccelThrottle2Modifier_LUT.is_valid(),
+                "DefaultAccelThrottle2Modifier_LUT is invalid");
+  static_assert(RegenThrottle2Modifier_LUT.is_valid(), "RegenThrottle2Modifier_LUT is invalid");
+  static_assert(MotorRPM2RegenMax_LUT.is_valid(), "MotorRPM2RegenMax_LUT is invalid");
+  static_assert(MotorTemp2PumpDutyCycle_LUT.is_valid(), "MotorTemp2PumpDutyCycle_LUT is invalid");
+  static_assert(IGBTTemp2PumpDutyCycle_LUT.is_valid(), "IGBTTemp2PumpDutyCycle_LUT is invalid");
+  static_assert(BatteryTemp2PumpDutyCycle_LUT.is_valid(),
+                "BatteryTemp2PumpDutyCycle_LUT is invalid");
+  static_assert(CoolantTemp2FanDutyCycle_LUT.is_valid(), "CoolantTemp2FanDutyCycle_LUT is invalid");
+  // calculate_thermal_frame locates each temperature once for both of its tables (uploads that
+  // break this are handled at runtime, see CalibrationBank::pump_keys_shared)
+  static_assert(IGBTTemp2Modifier_LUT.same_keys(IGBTTemp2PumpDutyCycle_LUT),
+                "IGBT modifier and pump tables must share keys");
+  static_assert(BatteryTemp2Modifier_LUT.same_keys(BatteryTemp2PumpDutyCycle_LUT),
+                "Battery modifier and pump tables must share keys");
+  static_assert(MotorTemp2Modifier_LUT.same_keys(MotorTemp2PumpDutyCycle_LUT),
+                "Motor modifier and pump tables must share keys");
 };
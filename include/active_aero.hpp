@@ -27,14 +27,23 @@ class ActiveAero {
   ActiveAero(ICAN& can_interface_, VirtualTimerGroup& timer_group)
       : can_interface(can_interface_), timers(timer_group) {};
 
-  void update_active_aero(int32_t set_current, float max_current, bool brake_pressed);
+  // what 0x208 carries
+  struct Command {
+    ActiveAeroState state = ActiveAeroState::kClosed;
+    int16_t position = static_cast<int16_t>(ActiveAeroPosition::kClosed);
+  };
 
- private:
-  void update_can();
+  // control core: enabled is the last read_can() result
+  void update_active_aero(int32_t set_current, float max_current, bool brake_pressed,
+                          ActiveAeroEnabled enabled);
+  Command get_command() const { return command; }
+
+  // CAN I/O core: the received enable / the command to transmit
+  ActiveAeroEnabled read_can() const;
+  void update_can(const Command& sent);
 
-  ActiveAeroState state = ActiveAeroState::kClosed;
-  ActiveAeroEnabled enabled = ActiveAeroEnabled::kEnabled;
-  int16_t position;
+ private:
+  Command command;
 
   VirtualTimerGroup& timers;
 
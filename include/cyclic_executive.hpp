@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// microsecond clock, wraps every ~71 minutes
+using ExecutiveClock = uint32_t (*)();
+
+// stand-in for micros() in native builds: time only moves when a test (or a task) advances it
+struct SimulatedClock {
+  static inline uint32_t now_us = 0;
+
+  static uint32_t now() { return now_us; }
+  static void advance(uint32_t us) { now_us += us; }
+};
+
+/**
+ * @brief Non-preemptive rate-monotonic cyclic executive. Tasks are kept in priority order
+ *        (shortest period first, registration order between equal periods) and every run_once()
+ *        pass runs each released task once, in that order, so the execution order only depends on
+ *        the clock.
+ *
+ *        A task is released every period from start(). A task that could not run for whole
+ *        periods skips those releases (counted) instead of running back to back to catch up.
+ */
+class CyclicExecutive {
+ public:
+  using TaskFn = void (*)();
+  static constexpr size_t kMaxTasks = 8;
+
+  struct TaskStats {
+    uint32_t runs = 0;
+    uint32_t overruns = 0;       // finished later than deadline_us after its release
+    uint32_t skipped = 0;        // releases dropped, the task was a period or more behind
+    uint32_t max_jitter_us = 0;  // start - release
+    uint32_t max_exec_us = 0;
+    uint32_t last_exec_us = 0;
+  };
+
+  explicit CyclicExecutive(ExecutiveClock clock) : clock(clock) {}
+
+  // deadline_us 0: the period. False if full, or for a zero period
+  bool add_task(const char* name, uint32_t period_us, TaskFn fn, uint32_t deadline_us = 0);
+
+  // first release of every task is now
+  void start();
+  // one pass of the main loop: runs the released tasks, returns how many ran
+  size_t run_once();
+
+  // the first multiple of base_period_us at or above period_us: a lower rate task decimated from
+  // the base task, released in the same passes, after it
+  static constexpr uint32_t decimated_period(uint32_t base_period_us, uint32_t period_us) {
+    return (period_us + base_period_us - 1) / base_period_us * base_period_us;
+  }
+
+  // nullptr for an unknown task
+  const TaskStats* stats(const char* name) const;
+  void reset_stats();
+
+  size_t num_tasks() const { return task_count; }
+
+ private:
+  struct Task {
+    const char* name = nullptr;
+    uint32_t period_us = 0;
+    uint32_t deadline_us = 0;
+    TaskFn fn = nullptr;
+    uint32_t next_release_us = 0;
+    TaskStats stats{};
+  };
+
+  ExecutiveClock clock;
+  Task tasks[kMaxTasks];
+  size_t task_count = 0;
+
+  void run_task(Task& task, uint32_t start_us);
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "flat_lut.hpp"
+
+/**
+ * @brief FlatLUT expanded to one precomputed value per integer key in [0, Size). A lookup inside
+ *        that domain is a single indexed load; keys outside it fall back to the source FlatLUT,
+ *        so results always match the interpolating lookup exactly.
+ *
+ *        The source table must outlive the DenseLUT and build() must be called again whenever the
+ *        source's contents change.
+ */
+template <size_t Size>
+class DenseLUT {
+ public:
+  void build(const FlatLUT& lut) {
+    source = &lut;
+    for (size_t i = 0; i < Size; i++) {
+      values[i] = lut.lookup(static_cast<int16_t>(i));
+    }
+  }
+
+  float lookup(int16_t key) const {
+    if (key >= 0 && static_cast<size_t>(key) < Size) {
+      return values[key];
+    }
+    return source != nullptr ? source->lookup(key) : 0.0f;
+  }
+
+ private:
+  float values[Size] = {};
+  const FlatLUT* source = nullptr;
+};
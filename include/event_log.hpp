@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#ifdef ESP32
+#include "esp_timer.h"
+#else
+#include <chrono>
+#endif
+
+// what a LogRecord says, the format of each is in event_log.cpp
+enum class LogEvent : uint16_t {
+  kTransitionOffToN = 0,
+  kTransitionNToDrive,
+  kTransitionNToOff,
+  kTransitionDriveToN,
+  kTransitionDriveToOff,
+  kBrakeImplausibility,
+  kAPPSsInvalidImplausibility,
+  kAPPSsDisagreementImplausibility,
+  kPedalAcquisitionFailed,
+  kStatusSwitches,  // drive state, TS active, brake pressed, ready to drive (state, switch)
+  kStatusTiming,    // cycle, max cycle, pedal to command, max pedal to command (us), ADC overruns
+  kStatusInterrupts,
+  kThrottleInfo,  // APPS1 / APPS2 counts
+  kInverterInfo,  // requested accel / regen current
+  kCount
+};
+
+// one event as the hot path leaves it: no text, formatted later by the log task
+struct LogRecord {
+  static constexpr size_t kMaxArgs = 5;
+
+  uint32_t timestamp_us = 0;
+  LogEvent event = LogEvent::kCount;
+  uint8_t num_args = 0;
+  int32_t args[kMaxArgs] = {};
+};
+
+/**
+ * @brief Deferred logger: log() copies a fixed-size LogRecord into a bounded lock-free ring and
+ *        returns, it never formats, allocates or waits on the UART. A background task pops the
+ *        records and formats and prints them (see log_task() in fsm.cpp).
+ *
+ *        Any number of producers on either core, one consumer. A full ring drops the new record
+ *        and counts it in overruns() instead of blocking the writer.
+ */
+class EventLog {
+ public:
+  static constexpr size_t kCapacity = 64;  // records, a power of two
+
+  EventLog();
+
+  // hot path: false (counted) if the ring was full
+  template <typename... Args>
+  bool log(LogEvent event, Args... args) {
+    static_assert(sizeof...(Args) <= LogRecord::kMaxArgs, "too many log arguments");
+    const int32_t values[] = {static_cast<int32_t>(args)..., 0};
+    return push(event, values, sizeof...(Args));
+  }
+
+  // consumer side: oldest record, false if there is none
+  bool pop(LogRecord& record);
+
+  uint32_t overruns() const { return dropped.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief One line of text for a record, without a line ending: the timestamp and the event's
+   *        format with the arguments. Truncated to fit, like snprintf.
+   *
+   * @return size_t -- length of the full line
+   */
+  static size_t format(const LogRecord& record, char* buffer, size_t size);
+
+#ifdef ESP32
+  static uint32_t now_us() { return static_cast<uint32_t>(esp_timer_get_time()); }
+#else
+  static uint32_t now_us() {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+  }
+#endif
+
+ private:
+  static constexpr uint32_t kIndexMask = kCapacity - 1;
+  static_assert((kCapacity & kIndexMask) == 0, "kCapacity must be a power of two");
+
+  // a slot is free for position p when sequence == p, holds the record of p when sequence == p + 1
+  struct Slot {
+    std::atomic<uint32_t> sequence{0};
+    LogRecord record;
+  };
+
+  bool push(LogEvent event, const int32_t* values, size_t num_args);
+
+  Slot slots[kCapacity];
+  std::atomic<uint32_t> head{0};  // next position to write, shared by the producers
+  uint32_t tail = 0;              // next position to read, consumer only
+  std::atomic<uint32_t> dropped{0};
+};
+
+// the firmware's log, drained by the log task, see event_log.cpp
+extern EventLog event_log;
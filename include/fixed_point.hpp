@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Q15 fixed point used by the integer torque pipeline: kQ15One represents 1.0.
+// Held in an int32_t so 1.0 itself and products of two Q15 values fit without overflow.
+using q15_t = int32_t;
+
+constexpr int32_t kQ15Shift = 15;
+constexpr q15_t kQ15One = static_cast<q15_t>(1) << kQ15Shift;
+constexpr int32_t kQ15Half = kQ15One / 2;
+
+/**
+ * @brief Convert a float to Q15, rounding half away from zero (same as roundf)
+ */
+constexpr q15_t float_to_q15(float value) {
+  return static_cast<q15_t>(value * static_cast<float>(kQ15One) + (value < 0.0f ? -0.5f : 0.5f));
+}
+
+constexpr float q15_to_float(q15_t value) {
+  return static_cast<float>(value) / static_cast<float>(kQ15One);
+}
+
+/**
+ * @brief Q15 * Q15 -> Q15, rounded to nearest. Intended for modifiers in [0, 1].
+ */
+constexpr q15_t q15_mul(q15_t a, q15_t b) { return (a * b + kQ15Half) >> kQ15Shift; }
+
+/**
+ * @brief num / den rounded half away from zero, den must be positive
+ */
+constexpr int32_t div_round(int64_t num, int32_t den) {
+  return static_cast<int32_t>(num >= 0 ? (num + den / 2) / den : (num - den / 2) / den);
+}
+
+/**
+ * @brief Scale a Q15 modifier to an integer range: integer equivalent of Lookup::scale()
+ */
+constexpr int32_t q15_scale(q15_t value, int32_t max) {
+  return div_round(static_cast<int64_t>(value) * max, kQ15One);
+}
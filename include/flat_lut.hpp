@@ -0,0 +1,357 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <utility>
+
+#include "fixed_point.hpp"
+
+// how a table fills in between its points (sent with DAQ LUT uploads)
+enum class InterpType : uint8_t { LINEAR = 0, SMOOTH_STEP = 1 };
+
+// max number of (key, value) points a LUT can hold -- sized for the 30 pair DAQ upload
+constexpr size_t kMaxLUTPoints = 32;
+
+/**
+ * @brief Remembers which segment a table was last read from, so a slowly changing input (rpm,
+ *        temperatures) usually skips the search. Keep one per call site, the table itself is
+ *        const and may live in flash. Clamped keys are not counted.
+ */
+struct LUTCursor {
+  uint8_t segment = 0;
+  uint32_t hits = 0;    // found in the cached segment or one of its neighbours
+  uint32_t misses = 0;  // needed a full search
+};
+
+/**
+ * @brief Where a key falls in a table: its segment and the key clamped to the table's range.
+ *        Found once with FlatLUT::locate(), it can be evaluated in every table with the same keys.
+ */
+struct LUTPosition {
+  uint8_t segment = 0;
+  int16_t key = 0;
+};
+
+// SMOOTH_STEP segment i: value = values[i] + t * (c1 + t * (c2 + t * c3)), t = key - keys[i]
+struct CubicSegment {
+  float c1 = 0.0f;
+  float c2 = 0.0f;
+  float c3 = 0.0f;
+};
+
+// same polynomial in Q15 over u = t / span (Q15, from span_recip), so the terms stay in range
+struct CubicSegmentQ15 {
+  int32_t c1 = 0;
+  int32_t c2 = 0;
+  int32_t c3 = 0;
+  uint32_t span_recip = 0;  // 2^31 / span
+};
+
+/**
+ * @brief Every segment's coefficients for one SMOOTH_STEP table, ~900 B. Kept by whoever holds
+ *        the table (a calibration bank keeps a couple), not in the table, so linear tables don't
+ *        carry them. See FlatLUT::bind_cubics().
+ */
+struct CubicSegments {
+  CubicSegment segments[kMaxLUTPoints] = {};
+  CubicSegmentQ15 segments_q15[kMaxLUTPoints] = {};
+};
+
+/**
+ * @brief Sorted, fixed-capacity lookup table stored as two flat arrays (keys, values).
+ *        Keys below the first point / above the last point clamp to the end values, keys in
+ *        between are linearly interpolated. Same behavior as the old std::map based lookup.
+ *        Segment slopes are computed once at construction, so interpolating is a single
+ *        multiply-add with no division. Tables whose keys (or a leading run of them) sit on a
+ *        uniform grid find their segment with one multiply instead of a search.
+ *
+ *        SMOOTH_STEP tables use a monotone cubic Hermite curve instead (tangents per Fritsch and
+ *        Butland, so the curve never overshoots the points). Bound to a CubicSegments, evaluating
+ *        a segment is a 3 term Horner step. Unbound, the segment's polynomial is worked out from
+ *        its neighbouring points on every call.
+ *
+ *        Construction from an initializer list is constexpr, so a `static constexpr FlatLUT`
+ *        is built by the compiler and lives in .rodata (flash on the ESP32). A table is ~600 B,
+ *        every bank and store slot holds one per table ID, so keep an eye on the size check below.
+ */
+class FlatLUT {
+ public:
+  constexpr FlatLUT() = default;
+
+  constexpr FlatLUT(std::initializer_list<std::pair<int16_t, float>> pairs,
+                    InterpType interp_type = InterpType::LINEAR)
+      : interp(interp_type) {
+    for (const auto& pair : pairs) {
+      insert(pair.first, pair.second);
+    }
+    compute_segments();
+  }
+
+  explicit FlatLUT(const std::map<int16_t, float>& lut,
+                   InterpType interp_type = InterpType::LINEAR)
+      : interp(interp_type) {
+    for (const auto& pair : lut) {
+      insert(pair.first, pair.second);
+    }
+    compute_segments();
+  }
+
+  // n points from parallel arrays, e.g. a table assembled from CAN frames
+  FlatLUT(const int16_t* point_keys, const float* point_values, size_t n,
+          InterpType interp_type = InterpType::LINEAR)
+      : interp(interp_type) {
+    for (size_t i = 0; i < n; i++) {
+      insert(point_keys[i], point_values[i]);
+    }
+    compute_segments();
+  }
+
+  /**
+   * @brief Axis for a 2-D table: key i maps to value i, so lookup(key) is the key's fractional
+   *        position along the axis (segment index + offset within it).
+   */
+  static constexpr FlatLUT axis(std::initializer_list<int16_t> axis_keys) {
+    FlatLUT lut;
+    float position = 0.0f;
+    for (int16_t key : axis_keys) {
+      lut.insert(key, position);
+      position += 1.0f;
+    }
+    lut.compute_segments();
+    return lut;
+  }
+
+  float lookup(int16_t key) const;
+  // integer-only lookup: same clamping, interpolates the Q15 copy of the values
+  q15_t lookup_q15(int16_t key) const;
+
+  // same results, but tries cursor's segment and its neighbours before searching
+  float lookup(int16_t key, LUTCursor& cursor) const;
+  q15_t lookup_q15(int16_t key, LUTCursor& cursor) const;
+
+  // clamp + segment search only, see LUTPosition
+  LUTPosition locate(int16_t key) const;
+  LUTPosition locate(int16_t key, LUTCursor& cursor) const;
+
+  // value at a position from locate() on this table or one with same_keys(), same as lookup(key)
+  float lookup(const LUTPosition& position) const {
+    return interpolate(position.segment, position.key);
+  }
+  q15_t lookup_q15(const LUTPosition& position) const {
+    return interpolate_q15(position.segment, position.key);
+  }
+
+  /**
+   * @brief Evaluate n keys into out[0 .. n), for host tools (log replay, calibration sweeps).
+   *        Built with AVX2 (-mavx2) this looks up 16 keys per step, picking each lane's segment
+   *        coefficients from registers with permutes and blends (no gathers). With SSE2 it does
+   *        the segment search for 8 keys per step and interpolates per lane, otherwise it is
+   *        lookup_batch_scalar(). Same results as lookup().
+   */
+  void lookup_batch(const int16_t* keys_in, float* out, size_t n) const;
+  // reference for the vector paths: lookup() on each key
+  void lookup_batch_scalar(const int16_t* keys_in, float* out, size_t n) const;
+
+  /**
+   * @brief Precompute every segment of a SMOOTH_STEP table into storage, which must outlive the
+   *        binding and not be reused while bound. Copies of the table share the storage; a copy
+   *        put somewhere else (another bank, a stored image) is unbound first.
+   */
+  void bind_cubics(CubicSegments& storage) {
+    compute_cubics(storage);
+    cubics = &storage;
+  }
+  void unbind_cubics() { cubics = nullptr; }
+  bool has_cubics() const { return cubics != nullptr; }
+  void compute_cubics(CubicSegments& storage) const;
+
+  constexpr size_t size() const { return count; }
+  constexpr int16_t key_at(size_t i) const { return keys[i]; }
+  constexpr float value_at(size_t i) const { return values[i]; }
+  constexpr q15_t value_q15_at(size_t i) const { return values_q15[i]; }
+  constexpr InterpType interp_type() const { return interp; }
+
+  constexpr bool operator==(const FlatLUT& other) const {
+    if (count != other.count || interp != other.interp) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (keys[i] != other.keys[i] || values[i] != other.values[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+  constexpr bool operator!=(const FlatLUT& other) const { return !(*this == other); }
+
+  // true if positions from one table can be used on the other
+  constexpr bool same_keys(const FlatLUT& other) const {
+    if (count != other.count) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (keys[i] != other.keys[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Calibration table invariants: at least 2 points, points given in strictly increasing
+   *        key order with none dropped, every value in [0, 1]. Meant for static_assert.
+   */
+  constexpr bool is_valid() const {
+    if (count < 2 || !in_order) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (values[i] < 0.0f || values[i] > 1.0f) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  int16_t keys[kMaxLUTPoints] = {};
+  float values[kMaxLUTPoints] = {};
+  q15_t values_q15[kMaxLUTPoints] = {};
+  // segment i runs from keys[i] to keys[i + 1]: value = values[i] + slopes[i] * (key - keys[i])
+  float slopes[kMaxLUTPoints] = {};
+  // Q15 slope per key, with kSlopeFracBits extra fractional bits
+  int32_t slopes_q15[kMaxLUTPoints] = {};
+  // points 0 .. grid_points - 1 are on a uniform grid (0 if the table has no such run)
+  uint8_t grid_points = 0;
+  // segments per key on the grid, with kGridRecipBits fractional bits
+  uint32_t grid_recip = 0;
+  uint8_t count = 0;
+  // false once a point arrives out of order, duplicated, or past capacity
+  bool in_order = true;
+  // anything other than SMOOTH_STEP (e.g. an unknown value off the bus) interpolates linearly
+  InterpType interp = InterpType::LINEAR;
+
+  // SMOOTH_STEP only: precomputed segments (bind_cubics()), null to work each one out per call
+  const CubicSegments* cubics = nullptr;
+
+  /**
+   * @brief Insert a point keeping keys sorted. Like std::map::insert, a duplicate key keeps the
+   *        value that was inserted first. Points past kMaxLUTPoints are dropped.
+   */
+  constexpr void insert(int16_t key, float value) {
+    if (count >= kMaxLUTPoints) {
+      in_order = false;
+      return;
+    }
+
+    size_t i = count;
+    while (i > 0 && keys[i - 1] > key) {
+      i--;
+    }
+    if (i != count) {
+      in_order = false;
+    }
+    if (i > 0 && keys[i - 1] == key) {
+      in_order = false;
+      return;
+    }
+
+    for (size_t j = count; j > i; j--) {
+      keys[j] = keys[j - 1];
+      values[j] = values[j - 1];
+      values_q15[j] = values_q15[j - 1];
+    }
+    keys[i] = key;
+    values[i] = value;
+    values_q15[i] = float_to_q15(value);
+    count++;
+  }
+
+  static constexpr int32_t kSlopeFracBits = 15;
+
+  static constexpr int32_t kGridRecipBits = 16;
+
+  constexpr void compute_segments() {
+    for (size_t i = 0; i + 1 < count; i++) {
+      int32_t key_span = keys[i + 1] - keys[i];
+      slopes[i] = (values[i + 1] - values[i]) / static_cast<float>(key_span);
+      slopes_q15[i] = div_round(
+          static_cast<int64_t>(values_q15[i + 1] - values_q15[i]) * (1 << kSlopeFracBits),
+          key_span);
+    }
+    compute_grid();
+  }
+
+  constexpr bool smooth() const { return interp == InterpType::SMOOTH_STEP; }
+
+  // Fritsch-Butland tangent at point i, see cubic_segment()
+  float tangent(size_t i) const;
+  // segment i's Hermite coefficients, all zero for the last point
+  CubicSegment cubic_segment(size_t i) const;
+  CubicSegmentQ15 cubic_segment_q15(size_t i) const;
+
+  /**
+   * @brief Find the longest run of points from the start whose keys are evenly spaced, allowing
+   *        for keys rounded to the nearest integer (key_i == key_0 + round(i * span / segments)).
+   *        Covers e.g. every 10 degC, every ~102.35 throttle counts, or 0 - 2600 rpm in front of a
+   *        10000 rpm tail point. Needs at least 2 segments.
+   */
+  constexpr void compute_grid() {
+    grid_points = 0;
+    grid_recip = 0;
+    for (size_t n = count; n >= 3; n--) {
+      int32_t span = keys[n - 1] - keys[0];
+      int32_t segments = static_cast<int32_t>(n - 1);
+      bool uniform = true;
+      for (size_t i = 1; i + 1 < n && uniform; i++) {
+        int32_t offset = (2 * static_cast<int32_t>(i) * span + segments) / (2 * segments);
+        uniform = keys[i] == keys[0] + offset;
+      }
+      if (uniform) {
+        grid_points = static_cast<uint8_t>(n);
+        grid_recip = (static_cast<uint32_t>(segments) << kGridRecipBits) / span;
+        return;
+      }
+    }
+  }
+
+  size_t find_segment(int16_t key) const;
+  size_t find_segment(int16_t key, LUTCursor& cursor) const;
+
+  float interpolate(size_t i, int16_t key) const {
+    float offset = static_cast<float>(key - keys[i]);
+    if (smooth()) {
+      const CubicSegment cubic = cubics != nullptr ? cubics->segments[i] : cubic_segment(i);
+      return values[i] + offset * (cubic.c1 + offset * (cubic.c2 + offset * cubic.c3));
+    }
+    return values[i] + slopes[i] * offset;
+  }
+
+  q15_t interpolate_q15(size_t i, int16_t key) const {
+    int32_t key_offset = key - keys[i];
+    if (smooth()) {
+      return interpolate_cubic_q15(i, key_offset);
+    }
+    // |slope * offset| stays below the segment's value span << kSlopeFracBits, fits in 32 bits
+    return values_q15[i] +
+           ((slopes_q15[i] * key_offset + (1 << (kSlopeFracBits - 1))) >> kSlopeFracBits);
+  }
+
+  q15_t interpolate_cubic_q15(size_t i, int32_t key_offset) const {
+    const CubicSegmentQ15 cubic =
+        cubics != nullptr ? cubics->segments_q15[i] : cubic_segment_q15(i);
+    // key_offset < span, so the product stays below 2^31 + span
+    int64_t u = (static_cast<uint32_t>(key_offset) * cubic.span_recip + (1u << 15)) >> 16;
+    // coefficients can reach a few times kQ15One, keep the products in 64 bits
+    int64_t acc = cubic.c3;
+    acc = cubic.c2 + ((acc * u + kQ15Half) >> kQ15Shift);
+    acc = cubic.c1 + ((acc * u + kQ15Half) >> kQ15Shift);
+    return values_q15[i] + static_cast<q15_t>((acc * u + kQ15Half) >> kQ15Shift);
+  }
+};
+
+// five kMaxLUTPoints arrays (keys, values, values_q15, slopes, slopes_q15), the grid fields and
+// the cubics pointer; anything bigger is multiplied by every table in every bank and store slot
+static_assert(sizeof(FlatLUT) <= 600, "FlatLUT grew, check the bank and LUT store sizes");
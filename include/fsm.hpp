@@ -1,17 +1,19 @@
 #pragma once
 #include <Arduino.h>
 
+#include <atomic>
+
 #include "LUT.hpp"
+#include "active_aero.hpp"
+#include "cyclic_executive.hpp"
 #include "esp_can.h"
 #include "inverter_driver.hpp"
+#include "spsc_snapshot.hpp"
 #include "throttle_brake_driver.hpp"
+#include "vehicle_snapshot.hpp"
 #include "virtualTimer.h"
 
 // enum definitions
-enum class BMSState { kShutdown = 0, kPrecharge = 1, kActive = 2, kCharging = 3, kFault = 4 };
-
-enum class BMSFault { kNoExtFault = 0, kExtFault = 1 };
-
 enum class BMSCommand { PrechargeAndCloseContactors = 0, Shutdown = 1 };
 
 enum class TSActive { Active = 0, Inactive = 1 };
@@ -22,12 +24,69 @@ enum class Brake_State { NotPressed = 0, PressedInNeutral = 1 };
 
 enum class State { OFF = 0, N = 1, DRIVE = 2 };
 
+// sense -> torque -> command rate: 100 Hz, or 1 kHz with -D ECU_CONTROL_1KHZ. The rest of the
+// periodic work keeps its own rate, decimated from this one
+#ifdef ECU_CONTROL_1KHZ
+constexpr uint32_t kControlPeriodUs = 1000;
+#ifndef ECU_CONTROL_BUDGET_US
+#define ECU_CONTROL_BUDGET_US 400
+#endif
+#else
+constexpr uint32_t kControlPeriodUs = 10000;
+#ifndef ECU_CONTROL_BUDGET_US
+#define ECU_CONTROL_BUDGET_US 2000
+#endif
+#endif
+// worst case time of update() (-D ECU_CONTROL_BUDGET_US=...): its deadline in the executive and
+// what the WCET harness checks
+constexpr uint32_t kControlBudgetUs = ECU_CONTROL_BUDGET_US;
+static_assert(kControlBudgetUs <= kControlPeriodUs, "the control budget exceeds its period");
+// the inverter gets zero torque when no new request came for this long: three control periods,
+// at least the 10 ms torque fallback period
+constexpr uint32_t kCommandTimeoutUs =
+    3 * kControlPeriodUs > Inverter::kTorqueFallbackPeriodUs ? 3 * kControlPeriodUs
+                                                              : Inverter::kTorqueFallbackPeriodUs;
+
+// control task -> CAN I/O task: what to transmit
+struct BusOutputs {
+  // snapshot the commands were computed from
+  uint32_t sequence = 0;
+  uint32_t sample_timestamp_us = 0;
+  State drive_state = State::OFF;
+  BMSCommand bms_command = BMSCommand::Shutdown;
+  std::pair<int32_t, int32_t> torque_reqs{0, 0};
+  uint8_t pump_duty_cycle = 0;
+  uint8_t fan_duty_cycle = 0;
+  // for the CAN signals the drivers keep, only written by the CAN I/O task
+  ThrottleBrake::CANValues throttle_brake{};
+  ActiveAero::Command aero{};
+  Lookup::StatusCAN lookup_status{};
+};
+
 // instantiate CAN bus
 extern ESPCAN drive_bus;
 
 // instantiate timer group
 extern VirtualTimerGroup timers;
 
+// periodic tasks, run from loop()
+extern CyclicExecutive executive;
+
+// the two cores only share these, each has one writer
+extern SnapshotBuffer<BusInputs> bus_to_control;
+extern SnapshotBuffer<BusOutputs> control_to_bus;
+// written by sample_vehicle() only, at the start of each control cycle
+extern VehicleSnapshot vehicle;
+// pedal sample -> torque request frames queued to the inverter, measured on the CAN I/O task
+extern std::atomic<uint32_t> pedal_to_command_us;
+extern std::atomic<uint32_t> max_pedal_to_command_us;
+
+// handshake for a calibration save, which stalls both cores (see update_CAN_LUTs()). The CAN I/O
+// task requests, the control task grants only in OFF with TS inactive and then holds OFF until
+// the CAN I/O task has saved and set it back to kIdle
+enum class CalibrationSave : uint8_t { kIdle, kRequested, kGranted };
+extern std::atomic<CalibrationSave> calibration_save;
+
 // instantiate throttle/brake timers
 extern VirtualTimer
     APPSs_disagree_timer;  // this timer needs to call
@@ -49,9 +108,26 @@ extern Inverter inverter;
 // instantiate Lookup object
 extern Lookup lookup;
 
+// persistent copy of the uploaded tables
+extern LUTStore lut_store;
+
+// temperature derived values of the current tick (derating, pump / fan duty)
+extern Lookup::ThermalFrame thermal_frame;
+
 // function forward initializations
 void fsm_init();
+void bus_task(void* params);
+void log_task(void* params);
+void service_bus();
+void sample_vehicle();
 void update();
+void update_thermal();
+void update_status();
+void update_CAN_LUTs();
+#ifdef ECU_PROFILING
+void update_profiler_CAN();
+#endif
+bool hold_off_for_calibration_save();
 void change_state();
 void process_state();
 void ready_to_drive_callback();
@@ -63,6 +139,11 @@ void APPSs_invalid_timer_callback();
 void print_fsm();
 void print_all();
 void tick_timers();
+#ifdef ECU_WCET_HARNESS
+// runs update() on adversarial inputs against kControlBudgetUs and prints the results, instead of
+// driving (see control_wcet.cpp)
+bool run_control_wcet();
+#endif
 
 // global state variables
 extern TSActive tsactive_switch;  // physical status of the tsactive dashboard switch
@@ -70,6 +151,9 @@ extern Ready_To_Drive_State
     ready_to_drive_switch;  // physical status of the ready to drive dashboard switch
 extern Ready_To_Drive_State ready_to_drive;  // goes to drive when the when the brake is held while
                                              // the ready_to_drive switch is flipped
+// control side state, sent as Drive_State / BMS_Command by the CAN I/O task
+extern State drive_state;
+extern BMSCommand bms_command;
 
 // CAN signals
 extern CANSignal<BMSState, 0, 8, CANTemplateConvertFloat(1), CANTemplateConvertFloat(0), false>
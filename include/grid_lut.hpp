@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "flat_lut.hpp"
+
+/**
+ * @brief 2-D lookup table with bilinear interpolation between grid points. Cells are stored row
+ *        major, so a lookup reads two adjacent pairs from two consecutive rows. Each axis is a
+ *        FlatLUT::axis(), which gives the key's fractional row / column (with the usual clamping,
+ *        uniform grid indexing and segment cursor).
+ *
+ *        Cells are filled at runtime with set(), e.g. by baking a chain of 1-D tables into one
+ *        grid. Rows and Cols must match the number of points on each axis, and the axes must
+ *        outlive the GridLUT (they are usually static constexpr tables in flash).
+ */
+template <size_t Rows, size_t Cols>
+class GridLUT {
+ public:
+  static_assert(Rows >= 2 && Cols >= 2, "a GridLUT needs at least 2 points per axis");
+
+  constexpr GridLUT(const FlatLUT& row_axis, const FlatLUT& col_axis)
+      : row_axis(row_axis), col_axis(col_axis) {}
+
+  constexpr size_t rows() const { return Rows; }
+  constexpr size_t cols() const { return Cols; }
+  constexpr int16_t row_key(size_t row) const { return row_axis.key_at(row); }
+  constexpr int16_t col_key(size_t col) const { return col_axis.key_at(col); }
+
+  void set(size_t row, size_t col, float value) { cells[row * Cols + col] = value; }
+  float at(size_t row, size_t col) const { return cells[row * Cols + col]; }
+
+  float lookup(int16_t row_key, int16_t col_key) const {
+    return interpolate(row_axis.lookup(row_key), col_axis.lookup(col_key));
+  }
+
+  float lookup(int16_t row_key, int16_t col_key, LUTCursor& row_cursor,
+               LUTCursor& col_cursor) const {
+    return interpolate(row_axis.lookup(row_key, row_cursor), col_axis.lookup(col_key, col_cursor));
+  }
+
+ private:
+  const FlatLUT& row_axis;
+  const FlatLUT& col_axis;
+  float cells[Rows * Cols] = {};
+
+  float interpolate(float row_pos, float col_pos) const {
+    // positions are never negative, truncating through int32_t is cheaper than through size_t
+    int32_t row = static_cast<int32_t>(row_pos);
+    int32_t col = static_cast<int32_t>(col_pos);
+    // the last point of an axis interpolates from the segment before it
+    row = row < static_cast<int32_t>(Rows - 1) ? row : static_cast<int32_t>(Rows - 2);
+    col = col < static_cast<int32_t>(Cols - 1) ? col : static_cast<int32_t>(Cols - 2);
+    float row_frac = row_pos - static_cast<float>(row);
+    float col_frac = col_pos - static_cast<float>(col);
+
+    const float* upper = &cells[row * Cols + col];
+    const float* lower = upper + Cols;
+    float upper_value = upper[0] + (upper[1] - upper[0]) * col_frac;
+    float lower_value = lower[0] + (lower[1] - lower[0]) * col_frac;
+    return upper_value + (lower_value - upper_value) * row_frac;
+  }
+};
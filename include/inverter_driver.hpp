@@ -5,15 +5,38 @@
 #endif
 #include "can_interface.h"
 #include "throttle_brake_driver.hpp"
+#include "torque_tx_schedule.hpp"
 
 class Inverter {
  public:
-  Inverter(ICAN& can_interface_, VirtualTimerGroup& timer_group, ThrottleBrake& throttle_brake_)
-      : can_interface(can_interface_), timers(timer_group), throttle_brake(throttle_brake_) {};
+  // command_timeout_us: without a new torque request for this long, see TorqueTXSchedule
+  Inverter(ICAN& can_interface_, VirtualTimerGroup& timer_group, ThrottleBrake& throttle_brake_,
+           uint32_t command_timeout_us)
+      : can_interface(can_interface_),
+        timers(timer_group),
+        throttle_brake(throttle_brake_),
+        torque_tx(kTorqueFallbackPeriodUs, command_timeout_us) {};
+  // values from the inverter's frames
+  struct Readings {
+    int32_t motor_rpm = 0;
+    int16_t IGBT_temp = 0;
+    int16_t motor_temp = 0;
+  };
+
+  // a torque request is re-sent this often while no new one comes
+  static constexpr uint32_t kTorqueFallbackPeriodUs = 10000;
+
   void initialize();
-  void read_inverter_CAN();
-  void send_inverter_CAN();
+  // CAN side: the received signals / the torque request to transmit
+  Readings read_inverter_CAN() const;
+  TorqueTXSchedule::Send send_inverter_CAN(uint32_t sequence,
+                                           std::pair<int32_t, int32_t> torque_reqs,
+                                           uint32_t sample_timestamp_us, uint32_t now_us);
+  const TorqueTXSchedule::Stats& get_tx_stats() const;
+  // control side
+  void update_readings(const Readings& readings);
   void request_torque(std::pair<int32_t, int32_t> torque_reqs);
+  std::pair<int32_t, int32_t> get_torque_reqs() const;
   void print_inverter_info();
 
   int32_t get_motor_rpm() const;
@@ -32,19 +55,21 @@ class Inverter {
   int32_t requested_torque_throttle;
   int32_t requested_torque_brake;
 
+  TorqueTXSchedule torque_tx;
+
   const uint16_t kTransmissionIDSetCurrent = 0x200;           // CAN msg address, get this from DBC
   const uint16_t kTransmissionIDSetCurrentBrake = 0x201;      // CAN msg address, get this from DBC
   const uint16_t kTransmissionIDInverterMotorStatus = 0x281;  // CAN msg address, get this from DBC
   const uint16_t kTransmissionIDInverterTempStatus = 0x282;   // CAN msg address, get this from DBC
 
+  // no TX timers: sent by send_inverter_CAN()
   CANSignal<int32_t, 0, 32, CANTemplateConvertFloat(1), CANTemplateConvertFloat(0), true>
       Set_Current{};
-  CANTXMessage<1> ECU_Set_Current{can_interface, kTransmissionIDSetCurrent, 4, 10, timers,
-                                  Set_Current};
+  CANTXMessage<1> ECU_Set_Current{can_interface, kTransmissionIDSetCurrent, 4, 10, Set_Current};
   CANSignal<int32_t, 0, 32, CANTemplateConvertFloat(1), CANTemplateConvertFloat(0), true>
       Set_Current_Brake{};
-  CANTXMessage<1> ECU_Set_Current_Brake{
-      can_interface, kTransmissionIDSetCurrentBrake, 4, 10, timers, Set_Current_Brake};
+  CANTXMessage<1> ECU_Set_Current_Brake{can_interface, kTransmissionIDSetCurrentBrake, 4, 10,
+                                        Set_Current_Brake};
 
   // rx: from inverter: motor temp, motor rpm, inverter/fet temp
   CANSignal<int16_t, 0, 16, CANTemplateConvertFloat(1), CANTemplateConvertFloat(0), true> RPM{};
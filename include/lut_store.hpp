@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#ifdef ESP32
+#include "esp_partition.h"
+#endif
+#include "flat_lut.hpp"
+
+// tables a stored image can hold, every table of every drive profile
+constexpr size_t kMaxStoredLUTs = 36;
+
+// one table exactly as the lookup engine holds it at runtime, derived slopes included. The cubic
+// segments of a SMOOTH_STEP table are not, they are rebuilt when it is installed again
+struct StoredLUT {
+  uint8_t table = 0;    // Lookup::TableID
+  uint8_t profile = 0;  // Lookup::DriveProfile
+  uint8_t lut_id = 0;
+  uint8_t reserved = 0;
+  FlatLUT lut;
+};
+
+struct LUTStoreHeader {
+  uint32_t magic = 0;
+  uint16_t version = 0;
+  // sizeof(StoredLUT): a FlatLUT layout change without a version bump still reads as invalid
+  uint16_t entry_size = 0;
+  uint32_t sequence = 0;  // bumped by every save, the newer valid slot is loaded
+  uint8_t num_luts = 0;
+  uint8_t reserved[3] = {};
+  uint32_t crc = 0;  // LUTStore::crc32() over the header up to here and luts[0 .. num_luts)
+};
+
+// one slot: header, then the tables
+struct LUTStoreImage {
+  LUTStoreHeader header;
+  StoredLUT luts[kMaxStoredLUTs];
+};
+
+/**
+ * @brief Calibration tables kept across power cycles, in the same binary layout the lookup
+ *        engine uses, so loading is a check of the header and CRC followed by handing out a
+ *        pointer to the image: nothing is parsed or rebuilt.
+ *
+ *        Two slots. A save goes to the slot not holding the newest valid image and writes the
+ *        header last, so a power loss mid-write leaves the previous image in place. On the ESP32
+ *        the slots live in the "lut_bank" data partition (see partitions.csv) and are read
+ *        through a flash mapping, native builds keep them in a file.
+ */
+class LUTStore {
+ public:
+  static constexpr uint32_t kMagic = 0x4C555442;  // "LUTB"
+  // bump whenever StoredLUT / FlatLUT change meaning, not just size
+  static constexpr uint16_t kVersion = 3;
+  static constexpr size_t kNumSlots = 2;
+#ifdef ESP32
+  // slots start on flash sectors so each can be erased on its own
+  static constexpr size_t kSlotSize =
+      (sizeof(LUTStoreImage) + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+#else
+  static constexpr size_t kSlotSize = sizeof(LUTStoreImage);
+#endif
+
+  static_assert(std::is_trivially_copyable<StoredLUT>::value,
+                "tables are stored and loaded as raw bytes");
+  static_assert(sizeof(StoredLUT) <= UINT16_MAX, "entry_size is 16 bits");
+
+  // ESP32: data partition label, native: file path. An image is only valid if every table has a
+  // table ID below num_tables and a profile below num_profiles (Lookup::kNumTables / kNumProfiles)
+  LUTStore(const char* location, uint8_t num_tables, uint8_t num_profiles)
+      : location(location), num_tables(num_tables), num_profiles(num_profiles) {}
+
+  /**
+   * @brief Newest valid image, nullptr if neither slot holds one. Points into the flash mapping
+   *        (or the native read buffer) and stays valid until the next save().
+   */
+  const LUTStoreImage* load();
+
+  // luts[i] points at each table to store, in order. False if they don't fit or the write fails,
+  // the previous image is kept either way
+  bool save(const StoredLUT* const* luts, size_t n);
+
+  // header, CRC, and every table in range and well formed
+  bool is_valid(const LUTStoreImage& image) const;
+  // CRC-32 (IEEE 802.3: reflected 0x04C11DB7, init and final xor 0xFFFFFFFF)
+  static uint32_t crc32(const LUTStoreHeader& header, const StoredLUT* luts);
+
+ private:
+  const char* location;
+  uint8_t num_tables;
+  uint8_t num_profiles;
+  // slot / sequence of the newest valid image, -1 / 0 when there is none
+  int newest_slot = -1;
+  uint32_t newest_sequence = 0;
+
+  const LUTStoreImage* read_slot(size_t slot);
+  // tables first, header last
+  bool write_slot(size_t slot, const LUTStoreHeader& header, const StoredLUT* const* luts);
+
+#ifdef ESP32
+  const esp_partition_t* partition = nullptr;
+  const void* mapping = nullptr;
+  spi_flash_mmap_handle_t mapping_handle = 0;
+
+  bool map_partition();
+  void unmap_partition();
+#else
+  LUTStoreImage slots[kNumSlots];
+#endif
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "flat_lut.hpp"
+
+enum class FileStatus : uint8_t {
+  FILE_PRESENT_AND_VALID = 0,
+  FILE_NOT_PRESENT = 1,
+  INVALID_KEY_PHRASE = 2,
+  LOGGING_ERROR = 3,
+  FILE_OPEN_ERROR = 4
+};
+
+// tables addressable by an upload (4 bit table field, Lookup::TableID numbering)
+constexpr size_t kMaxUploadTables = 16;
+
+// header frame: announces an upload of one table and what its segments must add up to
+struct LUTUploadHeader {
+  uint8_t table = 0;
+  uint8_t sequence = 0;  // 0 - 15, changes with every new upload of the table
+  FileStatus file_status = FileStatus::FILE_NOT_PRESENT;
+  InterpType interp_type = InterpType::LINEAR;
+  uint8_t num_pairs = 0;
+  uint8_t lut_id = 0;
+  uint8_t payload_length = 0;  // encoded bytes carried by the segments
+  uint16_t crc = 0;            // LUTUploadReceiver::crc16() over header and payload
+};
+
+// one table point, value in hundredths
+struct LUTUploadPoint {
+  int16_t key = 0;
+  int16_t value = 0;
+};
+
+// commit event: one complete, CRC checked table (or the DAQ reporting it has no file for it)
+struct LUTUpload {
+  uint8_t table = 0;
+  FileStatus file_status = FileStatus::FILE_NOT_PRESENT;
+  InterpType interp_type = InterpType::LINEAR;
+  uint8_t lut_id = 0;
+  uint8_t num_points = 0;
+  LUTUploadPoint points[kMaxLUTPoints] = {};
+
+  FlatLUT lut() const;
+};
+
+/**
+ * @brief Reassembles segmented table uploads, any number of tables at once, into fixed buffers
+ *        (no heap use).
+ *
+ *        An upload is a header frame followed by ceil(payload_length / kSegmentBytes) segment
+ *        frames. Every frame carries the table and the upload's 4 bit sequence number, so
+ *        uploads of different tables can interleave and a segment of an older upload of the
+ *        same table is dropped instead of being stitched in. Segments may arrive in any order
+ *        and may be repeated. Once all of them are in and the CRC matches, the table's points are
+ *        decoded and committed, exactly once; committed() returns it until release().
+ *
+ *        Payload: the first point is zigzag varint key, zigzag varint value. Every following
+ *        point is varint (key - previous key - 1), zigzag varint (value - previous value).
+ *        Calibration curves are smooth, so most points take 2 - 3 bytes instead of 4.
+ */
+class LUTUploadReceiver {
+ public:
+  static constexpr size_t kSegmentBytes = 6;
+  // 3 varint bytes per key and per value at worst
+  static constexpr size_t kMaxPayload = kMaxLUTPoints * 6;
+  static constexpr size_t kMaxSegments = (kMaxPayload + kSegmentBytes - 1) / kSegmentBytes;
+  static_assert(kMaxPayload <= UINT8_MAX, "payload_length is 8 bits");
+  static_assert(kMaxSegments <= 32, "received_segments has one bit per segment");
+
+  struct Stats {
+    uint32_t commits = 0;
+    uint32_t stale_segments = 0;  // segment for an upload that is not being received
+    uint32_t crc_errors = 0;
+    uint32_t bad_uploads = 0;  // header out of range, or payload that does not decode
+    uint32_t sequence_reuses = 0;  // a new header with its table's last sequence, not received
+  };
+
+  void on_header(const LUTUploadHeader& header);
+  void on_segment(uint8_t table, uint8_t sequence, uint8_t segment,
+                  const uint8_t (&data)[kSegmentBytes]);
+
+  // a committed upload not yet released (lowest table first), nullptr if none
+  const LUTUpload* committed() const;
+  void release(uint8_t table) { pending_tables &= static_cast<uint16_t>(~(1u << table)); }
+
+  // an upload refused for reusing its table's last sequence, to NAK (lowest table first). False
+  // if there is none
+  bool take_rejected(uint8_t& table, uint8_t& lut_id);
+
+  const Stats& stats() const { return upload_stats; }
+
+  /**
+   * @brief Sender side of the payload format. Keys must be strictly increasing.
+   *
+   * @return bytes written, 0 if the points can't be encoded or don't fit in capacity
+   */
+  static size_t encode(const LUTUploadPoint* points, size_t n, uint8_t* out, size_t capacity);
+  // false unless exactly n points decode from exactly length bytes
+  static bool decode(const uint8_t* payload, size_t length, LUTUploadPoint* points, size_t n);
+
+  /**
+   * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over table, sequence, file_status,
+   *        interp_type, num_pairs, lut_id, payload_length, then the payload bytes. payload may
+   *        be nullptr when payload_length is 0
+   */
+  static uint16_t crc16(const LUTUploadHeader& header, const uint8_t* payload);
+
+ private:
+  struct Transfer {
+    LUTUploadHeader header{};
+    bool has_sequence = false;  // a header has been seen, header.sequence is meaningful
+    bool receiving = false;     // from a new header until its upload is committed or rejected
+    uint32_t received_segments = 0;
+    uint8_t payload[kMaxPayload] = {};
+
+    size_t segments_needed() const {
+      return (header.payload_length + kSegmentBytes - 1) / kSegmentBytes;
+    }
+  };
+  Transfer transfers[kMaxUploadTables];
+  LUTUpload uploads[kMaxUploadTables];
+  uint16_t pending_tables = 0;  // bit per table with a committed upload
+  uint16_t rejected_tables = 0;  // bit per table with a refused upload not yet taken
+  uint8_t rejected_lut_ids[kMaxUploadTables] = {};
+  Stats upload_stats{};
+
+  static_assert(kMaxUploadTables <= 16, "pending_tables has one bit per table");
+
+  static bool same_header(const LUTUploadHeader& a, const LUTUploadHeader& b);
+  void try_commit(Transfer& transfer);
+  void commit(const Transfer& transfer);
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef ESP32
+#include "driver/spi_master.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+#include "spsc_snapshot.hpp"
+
+// order of the conversions in a sample and of PedalADCBlock::counts
+enum class PedalChannel : uint8_t { APPS1 = 0, APPS2 = 1, FRONT_BRAKE = 2, REAR_BRAKE = 3 };
+constexpr size_t kNumPedalChannels = 4;
+
+// one oversampled read of the pedal box: per channel, the mean of `samples` conversions
+struct PedalADCBlock {
+  int16_t counts[kNumPedalChannels] = {};
+  uint16_t samples = 0;       // 0 until the first block is published
+  uint32_t sequence = 0;      // bumped for every block
+  uint32_t timestamp_us = 0;  // last conversion of the window
+};
+
+#ifndef ESP32
+// native stand-in for the four ADCs: a level per channel plus uniform noise of +-noise counts
+struct SimulatedPedalADC {
+  int16_t levels[kNumPedalChannels] = {};
+  int16_t noise = 0;
+  uint32_t state = 0x2545F491;  // xorshift32, never 0
+
+  void convert(int16_t (&counts)[kNumPedalChannels]);
+};
+#endif
+
+/**
+ * @brief Samples APPS1, APPS2, front and rear brake continuously in the background and publishes
+ *        the mean of every `oversample` conversions as one PedalADCBlock. The control loop takes
+ *        the newest block with latest(), which never waits on the SPI bus.
+ *
+ *        On the ESP32 a periodic timer wakes a task pinned to the CAN I/O core at the sample rate.
+ *        The task queues one SPI transaction per ADC on the spi_master driver and sleeps until the
+ *        hardware has clocked them out. Native builds have no timer or task: whoever drives the
+ *        simulation calls sample_simulated() once per sample period.
+ */
+class PedalAcquisition {
+ public:
+  static constexpr uint32_t kMaxSampleRateHz = 10000;
+
+  struct Config {
+    uint32_t sample_rate_hz = 4000;  // conversions of all four channels per second
+    uint16_t oversample = 8;         // conversions per block: 2 ms blocks at the defaults
+    uint32_t spi_clock_hz = 1000000;
+  };
+
+  // written by the acquisition side only
+  struct Stats {
+    uint32_t conversions = 0;
+    uint32_t blocks = 0;
+    uint32_t overruns = 0;  // sample periods lost, the previous conversion was still running
+    uint32_t errors = 0;    // conversions dropped after an SPI error
+  };
+
+  // false for a rate of 0 or above kMaxSampleRateHz, no oversampling, a failed SPI / task setup or
+  // a failed first conversion
+  bool begin(const Config& config_);
+  bool begin() { return begin(Config{}); }
+
+  // no conversions after the one in progress: add_sample() is then free for a test harness to feed
+  void stop();
+
+  // control side: newest block, samples == 0 before the first one. Same rules as
+  // SnapshotBuffer::latest()
+  const PedalADCBlock& latest() { return blocks.latest(); }
+
+  /**
+   * @brief Acquisition side: adds one conversion of every channel to the running window and
+   *        publishes the block once the window holds `oversample` conversions.
+   */
+  void add_sample(const int16_t (&counts)[kNumPedalChannels], uint32_t now_us);
+
+  // one 16 bit ADC frame to signed counts: 12 bits after three leading bits, sign extended
+  static int16_t decode(uint16_t frame);
+
+  const Config& get_config() const { return config; }
+  const Stats& get_stats() const { return stats; }
+
+#ifndef ESP32
+  SimulatedPedalADC simulated_adc;
+
+  // one conversion of the simulated ADCs, what the acquisition task does once per sample period
+  void sample_simulated(uint32_t now_us);
+#endif
+
+ private:
+  Config config;
+  Stats stats;
+
+  // running window, acquisition side only
+  int32_t sums[kNumPedalChannels] = {};
+  uint16_t window_samples = 0;
+  uint32_t block_sequence = 0;
+
+  SnapshotBuffer<PedalADCBlock> blocks;
+
+#ifdef ESP32
+  static constexpr spi_host_device_t kHost = SPI3_HOST;
+  static constexpr BaseType_t kTaskCore = 0;  // next to CAN I/O, off the control core
+  static constexpr uint32_t kTaskStackBytes = 2048;
+  static constexpr UBaseType_t kTaskPriority = 3;  // above CAN I/O: sampling is time critical
+
+  spi_device_handle_t devices[kNumPedalChannels] = {};
+  spi_transaction_t transactions[kNumPedalChannels] = {};
+  esp_timer_handle_t timer = nullptr;
+  TaskHandle_t task = nullptr;
+
+  static void on_timer(void* arg);
+  static void task_entry(void* arg);
+  void run();
+  // one transaction per ADC, queued back to back. False (counts unset) if any failed
+  bool convert(int16_t (&counts)[kNumPedalChannels]);
+#endif
+};
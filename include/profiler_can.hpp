@@ -0,0 +1,38 @@
+#pragma once
+
+#include "can_interface.h"
+#include "esp_can.h"
+#include "stage_profiler.hpp"
+#include "virtualTimer.h"
+
+/**
+ * @brief Stage timings for DAQ, one stage per frame in turn (see StageProfiler).
+ *        0x20E: stage (8), min / mean / max in us (16 each, saturated), log2 histogram bucket of
+ *               the 99th percentile in ticks (8)
+ */
+class ProfilerCan {
+ public:
+  ProfilerCan(ICAN& can_interface, VirtualTimerGroup& timers)
+      : can_bus(can_interface), timers(timers) {};
+
+  // the next stage with samples into the signals, once per frame period on the CAN I/O task
+  void update(const StageProfiler& profiler);
+
+ private:
+  ICAN& can_bus;
+  VirtualTimerGroup& timers;
+
+  uint8_t next_stage = 0;
+
+  static uint16_t to_us(uint32_t ticks);
+
+  MakeUnsignedCANSignal(uint8_t, 0, 8, 1, 0) profile_stage {};
+  MakeUnsignedCANSignal(uint16_t, 8, 16, 1, 0) profile_min_us {};
+  MakeUnsignedCANSignal(uint16_t, 24, 16, 1, 0) profile_mean_us {};
+  MakeUnsignedCANSignal(uint16_t, 40, 16, 1, 0) profile_max_us {};
+  MakeUnsignedCANSignal(uint8_t, 56, 8, 1, 0) profile_p99_bucket {};
+  CANTXMessage<5> ecu_stage_profile{can_bus,         0x20E,           8,
+                                    100,             timers,          profile_stage,
+                                    profile_min_us,  profile_mean_us, profile_max_us,
+                                    profile_p99_bucket};
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Latest-value channel from one producer to one consumer running on another core or
+ *        thread: a triple buffer, lock and wait free on both sides.
+ *
+ *        publish() copies a value into the producer's buffer and swaps it with the shared middle
+ *        one. latest() swaps the middle buffer in only when something new was published, so the
+ *        consumer always reads a complete value that nobody writes to. Values published between
+ *        two latest() calls are skipped: this is for state, not for events.
+ */
+template <typename T>
+class SnapshotBuffer {
+ public:
+  // producer side
+  void publish(const T& value) {
+    buffers[back] = value;
+    // release: the copy above is visible before the buffer is; acquire: the consumer is done with
+    // the buffer handed back
+    back = middle.exchange(static_cast<uint8_t>(back | kFresh), std::memory_order_acq_rel) &
+           kIndexMask;
+  }
+
+  /**
+   * @brief Consumer side: the newest published value, T{} before the first publish(). The
+   *        reference stays valid and unchanged until the next latest() call.
+   */
+  const T& latest() {
+    if ((middle.load(std::memory_order_relaxed) & kFresh) != 0) {
+      front = middle.exchange(front, std::memory_order_acq_rel) & kIndexMask;
+    }
+    return buffers[front];
+  }
+
+ private:
+  static constexpr uint8_t kIndexMask = 0x3;
+  static constexpr uint8_t kFresh = 0x4;  // middle holds a value latest() has not taken yet
+
+  T buffers[3] = {};
+  uint8_t back = 0;                // producer only
+  std::atomic<uint8_t> middle{1};  // buffer index | kFresh
+  uint8_t front = 2;               // consumer only
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef ESP32
+#include "sdkconfig.h"
+#include "xtensa/hal.h"
+#else
+#include <chrono>
+#endif
+
+// stages of the control loop (and of the CAN I/O task) that get timed, nested scopes are inclusive
+enum class ProfileStage : uint8_t {
+  kControlCycle = 0,  // all of update()
+  kUpdateSensorValues,
+  kCheckImplausibilities,
+  kProcessState,
+  kTorqueLookup,  // Lookup::get_torque_reqs, inside kProcessState
+  kChangeState,
+  kThermalLookup,  // Lookup::calculate_thermal_frame
+  kReadInverterCAN,
+  kBusTick,  // drive_bus.Tick()
+  kCount
+};
+
+/**
+ * @brief Execution time statistics per ProfileStage: min / max / mean and a log2 histogram, in
+ *        fixed arrays. Ticks are CPU cycles on the ESP32 (per core, stages don't migrate) and
+ *        nanoseconds natively.
+ *
+ *        Each stage has one writer, the task that runs it. Readers on the other core may see a
+ *        stage one sample out of date or half updated, fine for diagnostics.
+ *
+ *        Timing is only compiled in with -D ECU_PROFILING: PROFILE_STAGE() expands to nothing
+ *        otherwise.
+ */
+class StageProfiler {
+ public:
+  static constexpr size_t kNumStages = static_cast<size_t>(ProfileStage::kCount);
+  // bucket b > 0 holds [2^(b-1), 2^b) ticks, the last one everything above
+  static constexpr size_t kNumBuckets = 32;
+
+  struct StageStats {
+    uint32_t count = 0;
+    uint32_t min_ticks = UINT32_MAX;
+    uint32_t max_ticks = 0;
+    uint64_t total_ticks = 0;
+    uint32_t histogram[kNumBuckets] = {};
+
+    uint32_t mean_ticks() const;
+    // histogram bucket the given percentile of samples falls in, 0 without samples
+    uint8_t percentile_bucket(uint8_t percent) const;
+  };
+
+#ifdef ESP32
+  static uint32_t now_ticks() { return xthal_get_ccount(); }
+  static constexpr uint32_t kTicksPerUs = CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ;
+#else
+  static uint32_t now_ticks() {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+  }
+  static constexpr uint32_t kTicksPerUs = 1000;
+#endif
+
+  void record(ProfileStage stage, uint32_t ticks);
+  const StageStats& stats(ProfileStage stage) const {
+    return stages[static_cast<size_t>(stage)];
+  }
+  void reset();
+
+  static uint8_t bucket(uint32_t ticks);
+  static const char* stage_name(ProfileStage stage);
+
+  /**
+   * @brief One line per stage with samples: count, min / mean / max in us and the non-empty
+   *        histogram buckets. Truncated to fit, like snprintf.
+   *
+   * @return size_t -- length of the full report
+   */
+  size_t write_report(char* buffer, size_t size) const;
+
+ private:
+  StageStats stages[kNumStages];
+};
+
+// times the enclosing scope into one stage
+class ProfileScope {
+ public:
+  ProfileScope(StageProfiler& profiler, ProfileStage stage)
+      : profiler(profiler), stage(stage), start(StageProfiler::now_ticks()) {}
+  ~ProfileScope() { profiler.record(stage, StageProfiler::now_ticks() - start); }
+
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  StageProfiler& profiler;
+  ProfileStage stage;
+  uint32_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ECU_PROFILING
+// the firmware's profiler, see stage_profiler.cpp
+extern StageProfiler stage_profiler;
+#define PROFILE_STAGE(stage) \
+  ProfileScope PROFILE_CONCAT(profile_scope_, __LINE__) { stage_profiler, ProfileStage::stage }
+#else
+#define PROFILE_STAGE(stage) static_cast<void>(0)
+#endif
@@ -2,6 +2,7 @@
 
 #include "can_interface.h"
 #include "esp_can.h"
+#include "pedal_acquisition.hpp"
 #include "virtualTimer.h"
 
 // change specific bounds after testing with sensors in pedalbox:
@@ -63,8 +64,28 @@ class ThrottleBrake {
   // we'll have a callback function fires when the timer reaches its limit (ie. 100ms)
   // this callback will set a corresponding implausibility flag in a private struct containting all
   // the implausibilities
-  void initialize();                // initialize CS pins, SPI, and implausibility states
-  void update_sensor_values();      // read from SPI ADCs and update throttle/brake values
+  // one read of the pedal box: oversampled ADC counts (12 bit) and values scaled
+  // 0 - SENSOR_SCALED_MAX
+  struct PedalSample {
+    int16_t APPS1_adc = 0;
+    int16_t APPS2_adc = 0;
+    int16_t front_brake_adc = 0;
+    int16_t rear_brake_adc = 0;
+    int16_t APPS1_throttle_scaled = 0;
+    int16_t APPS2_throttle_scaled = 0;
+    int16_t front_brake_scaled = 0;
+    int16_t rear_brake_scaled = 0;
+    bool brake_pressed = false;
+    uint32_t timestamp_us = 0;  // end of the acquisition window
+  };
+
+  // no new ADC block for this long counts as invalid APPSs (blocks come every 2 ms by default)
+  static constexpr uint32_t kMaxSampleAgeUs = 5000;
+
+  // start the ADC acquisition, reset implausibility states
+  void initialize(const PedalAcquisition::Config& sampling = PedalAcquisition::Config{});
+  // take the newest ADC block and update throttle/brake values, once per control cycle
+  PedalSample update_sensor_values();
   int16_t get_throttle() const;     // return scaled throttle value
   int16_t get_front_brake() const;  // return scaled front brake value
   void set_is_APPSs_disagreement_implausibility_present_to_true();       // callback
@@ -73,8 +94,25 @@ class ThrottleBrake {
   void check_for_implausibilities();
   bool is_implausibility_present() const;
   bool is_brake_pressed() const;
-  void update_throttle_brake_CAN_signals();
+  // what the throttle, brake and implausibility frames carry, taken on the control core
+  struct CANValues {
+    int16_t APPS1_throttle = 0;
+    int16_t APPS2_throttle = 0;
+    int16_t front_brake = 0;
+    int16_t rear_brake = 0;
+    bool brake_pressed = false;
+    bool implausibility_present = false;
+    bool APPSs_disagreement = false;
+    bool BPPC = false;
+    bool brake_invalid = false;
+    bool APPSs_invalid = false;
+  };
+  CANValues get_CAN_values() const;
+  // CAN I/O core: the signals are only written where their frames are encoded
+  void update_throttle_brake_CAN_signals(const CANValues& values);
   void print_throttle_info();
+  const PedalAcquisition::Stats& get_acquisition_stats() const;
+  PedalAcquisition& get_acquisition();
 
  private:
   ICAN& can_interface;
@@ -100,12 +138,13 @@ class ThrottleBrake {
   bool brake_shorted_or_opened_implausibility_present;
   bool APPSs_invalid_implausibility_present;
 
-  void read_from_SPI_ADCs();
+  PedalAcquisition acquisition;
+  uint32_t sample_timestamp_us = 0;
+  bool sample_stale = true;  // the newest ADC block is older than kMaxSampleAgeUs
 
-  bool brake_pressed;
+  void read_ADCs();
 
-  void initialize_CS_pin(uint8_t CS_pin);
-  void initialize_CS_pins();
+  bool brake_pressed;
 
   int16_t get_safe_RAW(int16_t RAW, int16_t projected_min, int16_t projected_max);
 
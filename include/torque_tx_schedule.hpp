@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * @brief When the inverter's torque request frames go out. A new command is sent right away, so
+ *        it reaches the bus as soon as the control cycle that computed it is done instead of on
+ *        the next tick of a free running TX timer. While no new command comes the last one is
+ *        re-sent every fallback period, the inverter's timeout sees a live bus either way.
+ *
+ *        The frames outlive the control core, so they must not keep a stalled one's last torque
+ *        alive: once no new command has come for the command timeout, or the newest was computed
+ *        from a pedal sample older than that, the request drops to zero until a fresh one comes.
+ *
+ *        Also measures pedal sample -> frames queued, the latency the driver feels.
+ */
+class TorqueTXSchedule {
+ public:
+  struct Stats {
+    uint32_t event_sends = 0;
+    uint32_t fallback_sends = 0;
+    uint32_t timeouts = 0;         // drops to zero torque
+    uint32_t last_latency_us = 0;  // sample_timestamp_us -> now_us of the last event send
+    uint32_t max_latency_us = 0;
+  };
+
+  // what to put on the bus for the control task's newest output
+  enum class Send {
+    kNone,
+    kCommand,  // the new command, now
+    kResend,   // the last frames again, fallback period
+    kZero,     // zero torque, now: the commands stopped or went stale
+  };
+
+  TorqueTXSchedule(uint32_t fallback_period_us, uint32_t command_timeout_us)
+      : fallback_period_us(fallback_period_us), command_timeout_us(command_timeout_us) {}
+
+  /**
+   * @brief Call on every pass of the bus task with the newest control output: the sequence the
+   *        control task bumps every cycle and the time of the pedal sample it used. Counts the
+   *        sends like on_command() / fallback_due().
+   */
+  Send next(uint32_t sequence, uint32_t sample_timestamp_us, uint32_t now_us);
+
+  // a new command is being sent now, computed from the pedal sample taken at sample_timestamp_us
+  void on_command(uint32_t sample_timestamp_us, uint32_t now_us);
+
+  // no new command: true when the last one (zero torque before the first) is due again, counted
+  // as sent
+  bool fallback_due(uint32_t now_us);
+
+  const Stats& get_stats() const { return stats; }
+  void reset_stats() { stats = Stats{}; }
+
+ private:
+  uint32_t fallback_period_us;
+  uint32_t command_timeout_us;
+  uint32_t last_send_us = 0;
+  uint32_t last_sequence = 0;
+  uint32_t last_command_us = 0;  // a new sequence came
+  bool zeroed = true;            // nothing commanded yet / timed out
+  Stats stats;
+};
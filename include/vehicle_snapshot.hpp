@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+#include "active_aero.hpp"
+#include "inverter_driver.hpp"
+#include "spsc_snapshot.hpp"
+#include "throttle_brake_driver.hpp"
+
+enum class BMSState { kShutdown = 0, kPrecharge = 1, kActive = 2, kCharging = 3, kFault = 4 };
+
+enum class BMSFault { kNoExtFault = 0, kExtFault = 1 };
+
+// CAN I/O task -> control task: the received values the control path uses
+struct BusInputs {
+  BMSState bms_state = BMSState::kShutdown;
+  BMSFault external_kill_fault = BMSFault::kNoExtFault;
+  float battery_temperature = 0.0f;
+  float before_motor_temperature = 0.0f;
+  float wheel_speeds[4] = {};  // FL, FR, BL, BR
+  Inverter::Readings inverter{};
+  ActiveAeroEnabled aero_enabled = ActiveAeroEnabled::kEnabled;
+};
+
+// one control cycle's view of the car, taken once at the start of the cycle and only read after
+struct VehicleSnapshot {
+  uint32_t timestamp_us = 0;  // pedal box sample time
+  uint32_t sequence = 0;
+  ThrottleBrake::PedalSample pedals{};
+  BusInputs bus{};
+};
+
+/**
+ * @brief The sense stage without the drivers: the cycle's pedal sample and a copy of the newest
+ *        bus inputs. Bus inputs published after this land in the next cycle's snapshot.
+ */
+inline void take_vehicle_snapshot(VehicleSnapshot& vehicle,
+                                  const ThrottleBrake::PedalSample& pedals,
+                                  SnapshotBuffer<BusInputs>& bus_inputs) {
+  vehicle.sequence++;
+  vehicle.pedals = pedals;
+  vehicle.timestamp_us = pedals.timestamp_us;
+  vehicle.bus = bus_inputs.latest();
+}
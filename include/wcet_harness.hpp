@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "cyclic_executive.hpp"
+
+/**
+ * @brief Worst case execution time check. Each scenario puts adversarial inputs in place
+ *        (prepare, not timed) and then runs the code under test (run, timed), many times over;
+ *        the longest run has to fit the scenario's budget.
+ *
+ *        Measured, not proven: the result is only as bad as the worst input the scenarios reach.
+ *        Times come from the same clock as the executive's.
+ */
+class WcetHarness {
+ public:
+  // iteration: which adversarial input to set up / which run this is
+  using StepFn = void (*)(uint32_t iteration);
+  static constexpr size_t kMaxScenarios = 8;
+
+  struct Result {
+    uint32_t runs = 0;
+    uint32_t max_us = 0;
+    uint32_t worst_iteration = 0;  // the run that took max_us
+    uint64_t total_us = 0;
+    bool within_budget = true;
+
+    uint32_t mean_us() const { return runs == 0 ? 0 : static_cast<uint32_t>(total_us / runs); }
+  };
+
+  explicit WcetHarness(ExecutiveClock clock) : clock(clock) {}
+
+  // prepare may be nullptr. False if full or without run
+  bool add_scenario(const char* name, StepFn prepare, StepFn run, uint32_t budget_us);
+
+  // iterations runs of every scenario, in order. True if all fit their budget
+  bool run(uint32_t iterations);
+
+  size_t num_scenarios() const { return scenario_count; }
+  const char* name(size_t scenario) const { return scenarios[scenario].name; }
+  uint32_t budget_us(size_t scenario) const { return scenarios[scenario].budget_us; }
+  const Result& result(size_t scenario) const { return scenarios[scenario].result; }
+
+ private:
+  struct Scenario {
+    const char* name = nullptr;
+    StepFn prepare = nullptr;
+    StepFn run = nullptr;
+    uint32_t budget_us = 0;
+    Result result{};
+  };
+
+  ExecutiveClock clock;
+  Scenario scenarios[kMaxScenarios];
+  size_t scenario_count = 0;
+};
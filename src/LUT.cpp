@@ -1,39 +1,434 @@
 #include "LUT.hpp"
 
+#include <algorithm>
 #include <cmath>
-#include <map>
 
+/**
+ * @brief Switch to a requested profile, then take every committed upload and publish them
+ *        together into the active profile. Uploads for tables that don't exist are answered
+ *        kInvalid and dropped, an invalid table is dropped (the one in use is kept), and while
+ *        the spare bank is busy everything waits for the next call.
+ */
 void Lookup::updateCANLUTs() {
-  RXLUT rxLUT = lut_can.processCAN();
-  if (rxLUT.fileStatus == FileStatus::FILE_PRESENT_AND_VALID) {
-    AccelThrottle2Modifier_LUT = rxLUT.lut;
-    lut_can.setLUTIDResponse(rxLUT.LUTId);
-  } else {
-    lut_can.setLUTIDResponse(0);
-    AccelThrottle2Modifier_LUT = DefaultAccelThrottle2Modifier_LUT;
+  uint8_t profile;
+  if (lut_can.take_profile_request(profile)) {
+    request_profile(static_cast<DriveProfile>(profile));
+  }
+  profile = requested_profile.exchange(kNoProfileRequest, std::memory_order_acq_rel);
+  if (profile != kNoProfileRequest && !select_profile(static_cast<DriveProfile>(profile))) {
+    // tried again next call, unless a newer request came in
+    uint8_t none = kNoProfileRequest;
+    requested_profile.compare_exchange_strong(none, profile, std::memory_order_acq_rel);
+  }
+
+  // nothing to do between uploads
+  if (lut_can.committed_upload() != nullptr &&
+      begin_calibration_update() != InstallResult::kBusy) {
+    const LUTUpload* upload;
+    while ((upload = lut_can.committed_upload()) != nullptr) {
+      InstallResult result = InstallResult::kInvalid;
+      if (upload->table < kNumTables) {
+        TableID id = static_cast<TableID>(upload->table);
+        result = upload->file_status == FileStatus::FILE_PRESENT_AND_VALID
+                     ? stage_LUT(id, upload->lut(), upload->lut_id)
+                     : stage_LUT(id, default_table(id), 0);
+      }
+      lut_can.set_upload_response(upload->table, upload->lut_id, static_cast<uint8_t>(result));
+      lut_can.release_upload(upload->table);
+    }
+    publish_calibration_update();
+  }
+  uint8_t rejected_table;
+  uint8_t rejected_id;
+  while (lut_can.take_rejected_upload(rejected_table, rejected_id)) {
+    lut_can.set_upload_response(rejected_table, rejected_id,
+                                static_cast<uint8_t>(InstallResult::kSequenceReused));
+  }
+  lut_can.setLUTIDResponse(LUT_id(TableID::kAccelThrottle2Modifier));
+  lut_can.set_profile_response(static_cast<uint8_t>(current_profile));
+}
+
+void Lookup::request_profile(DriveProfile profile) {
+  if (static_cast<size_t>(profile) < kNumProfiles) {
+    requested_profile.store(static_cast<uint8_t>(profile), std::memory_order_release);
+  }
+}
+
+Lookup::DriveProfile Lookup::active_profile() const { return current_profile; }
+
+/**
+ * @brief The profile's bank is complete and never written while it belongs to the profile, so
+ *        switching is building its throttle tables (if it has none) and a single index store.
+ *        A control tick already running finishes on the bank it pinned, while it does the
+ *        switch after this one waits for its throttle slot.
+ */
+bool Lookup::select_profile(DriveProfile profile) {
+  if (static_cast<size_t>(profile) >= kNumProfiles || updating) {
+    return true;
+  }
+  uint8_t bank = profile_banks[static_cast<size_t>(profile)];
+  if (banks[bank].throttle_tables == nullptr) {
+    uint8_t slot = free_throttle_slot(bank);
+    if (slot == kNoSlot) {
+      return false;
+    }
+    attach_throttle_tables(bank, slot);
+  }
+  current_profile = profile;
+  active_bank.store(bank, std::memory_order_seq_cst);
+  return true;
+}
+
+Lookup::InstallResult Lookup::install_LUT(TableID id, const FlatLUT& lut, uint8_t lut_id) {
+  if (!lut.is_valid()) {
+    return InstallResult::kInvalid;
+  }
+  InstallResult result = begin_calibration_update();
+  if (result == InstallResult::kBusy) {
+    return result;
+  }
+  result = stage_LUT(id, lut, lut_id);
+  publish_calibration_update();
+  return result;
+}
+
+Lookup::InstallResult Lookup::begin_calibration_update() {
+  return begin_calibration_update(current_profile);
+}
+
+/**
+ * @brief Copy a profile's calibration into the spare bank. Single writer: only called from the
+ *        CAN upload path (or boot, or tests), never concurrently with itself.
+ *        The control path pins the bank it reads (pin_calibration()), the spare bank is only
+ *        rebuilt when it is not pinned, so a reader never sees a half written calibration.
+ */
+Lookup::InstallResult Lookup::begin_calibration_update(DriveProfile profile) {
+  if (static_cast<size_t>(profile) >= kNumProfiles) {
+    return InstallResult::kInvalid;
   }
+  // a control call that started before the last flip may still be reading the spare bank
+  if (pinned_bank.load(std::memory_order_seq_cst) == spare_bank) {
+    return InstallResult::kBusy;
+  }
+  // and the bank an update of the active profile replaces keeps its throttle tables
+  if (profile == current_profile && free_throttle_slot(spare_bank) == kNoSlot) {
+    return InstallResult::kBusy;
+  }
+  // only the tables, everything derived from them is rebuilt by publish_calibration_update()
+  const CalibrationBank& source = banks[profile_banks[static_cast<size_t>(profile)]];
+  CalibrationBank& bank = banks[spare_bank];
+  for (size_t i = 0; i < kNumTables; i++) {
+    bank.tables[i] = source.tables[i];
+    bank.tables[i].lut.unbind_cubics();
+  }
+  detach_throttle_tables(spare_bank);
+  updating = true;
+  updating_profile = profile;
+  staged_tables = 0;
+  return InstallResult::kInstalled;
+}
+
+Lookup::InstallResult Lookup::stage_LUT(TableID id, const FlatLUT& lut, uint8_t lut_id) {
+  size_t index = static_cast<size_t>(id);
+  if (!updating || index >= kNumTables || !lut.is_valid()) {
+    return InstallResult::kInvalid;
+  }
+  CalibrationBank& bank = banks[spare_bank];
+  if (bank.tables[index].lut_id == lut_id && bank.tables[index].lut == lut) {
+    return InstallResult::kUnchanged;
+  }
+  bank.tables[index].lut = lut;
+  bank.tables[index].lut.unbind_cubics();
+  bank.tables[index].lut_id = lut_id;
+  staged_tables++;
+  return InstallResult::kInstalled;
 }
 
-float Lookup::lookup(int16_t key, const std::map<int16_t, float>& lut) {
-  auto it = lut.lower_bound(key);
-  // if key is smaller than the smallest key, return the first value
-  if (it == lut.begin()) {
-    return it->second;
+/**
+ * @brief Rebuild what depends on the staged tables and hand the spare bank to the profile, its old
+ *        bank becomes the spare. Nothing is published when every staged table was unchanged.
+ */
+void Lookup::publish_calibration_update() {
+  if (!updating) {
+    return;
+  }
+  updating = false;
+  if (staged_tables == 0) {
+    return;
   }
-  // if key is larger than the largest key, return the last value
-  if (it == lut.end()) {
-    return std::prev(it)->second;
+  uint8_t updated = spare_bank;
+  CalibrationBank& bank = banks[updated];
+  bank.generation = ++last_generation;
+  build_derived(bank);
+
+  size_t profile = static_cast<size_t>(updating_profile);
+  spare_bank = profile_banks[profile];
+  profile_banks[profile] = updated;
+  // another profile's bank gets its throttle tables when it is selected
+  if (updating_profile == current_profile) {
+    attach_throttle_tables(updated, free_throttle_slot(updated));
+    active_bank.store(updated, std::memory_order_seq_cst);
   }
-  // if key is exactly found in the LUT, return its value
-  if (it->first == key) {
-    return it->second;
+  unsaved_calibration = true;
+}
+
+/**
+ * @brief Stage every stored table that came from an upload into its profile. Tables stored with
+ *        ID 0 are the defaults of the firmware that saved them and are skipped, so new firmware
+ *        defaults aren't masked by old ones.
+ */
+bool Lookup::load_calibration(LUTStore& store) {
+  const LUTStoreImage* image = store.load();
+  if (image == nullptr) {
+    return false;
   }
-  // if we're here, key is btwn 2 entries in the LUT, interpolate
-  auto upper = it;
-  auto lower = std::prev(it);
+  for (size_t profile = 0; profile < kNumProfiles; profile++) {
+    if (begin_calibration_update(static_cast<DriveProfile>(profile)) == InstallResult::kBusy) {
+      return false;
+    }
+    for (size_t i = 0; i < image->header.num_luts; i++) {
+      const StoredLUT& stored = image->luts[i];
+      if (stored.profile == profile && stored.lut_id != 0 && stored.table < kNumTables) {
+        stage_LUT(static_cast<TableID>(stored.table), stored.lut, stored.lut_id);
+      }
+    }
+    publish_calibration_update();
+  }
+  unsaved_calibration = false;
+  return true;
+}
+
+/**
+ * @brief Single writer, same as the updates: no profile's bank can change underneath the save.
+ *        Stalls both cores for up to seconds on flash (see LUTStore::write_slot()), call it with
+ *        the car held in OFF.
+ */
+bool Lookup::save_calibration(LUTStore& store) {
+  if (!unsaved_calibration) {
+    return false;
+  }
+  const StoredLUT* luts[kNumTables * kNumProfiles];
+  for (size_t profile = 0; profile < kNumProfiles; profile++) {
+    for (size_t i = 0; i < kNumTables; i++) {
+      luts[profile * kNumTables + i] = &banks[profile_banks[profile]].tables[i];
+    }
+  }
+  if (!store.save(luts, kNumTables * kNumProfiles)) {
+    return false;
+  }
+  unsaved_calibration = false;
+  return true;
+}
+
+/**
+ * @brief Pin the active bank for one control call: publish the pin, then re-check the index so a
+ *        flip in between is never missed (hazard pointer). Two atomic loads and two stores per
+ *        call (with the release in ~PinnedCalibration) whether or not an upload is in progress.
+ *        Nested pins (a control call made from another) reuse the outer one's bank.
+ */
+const Lookup::CalibrationBank& Lookup::pin_calibration() {
+  if (pin_depth++ > 0) {
+    return *pinned_calibration;
+  }
+  uint8_t bank = active_bank.load(std::memory_order_seq_cst);
+  while (true) {
+    pinned_bank.store(bank, std::memory_order_seq_cst);
+    uint8_t confirmed = active_bank.load(std::memory_order_seq_cst);
+    if (confirmed == bank) {
+      pinned_calibration = &banks[bank];
+      return *pinned_calibration;
+    }
+    bank = confirmed;
+  }
+}
+
+void Lookup::unpin_calibration() {
+  if (--pin_depth == 0) {
+    pinned_calibration = nullptr;
+    pinned_bank.store(kNoBank, std::memory_order_release);
+  }
+}
+
+uint8_t Lookup::LUT_id(TableID id) const {
+  return banks[active_bank.load(std::memory_order_acquire)].lut_id(id);
+}
+
+const FlatLUT& Lookup::default_table(TableID id) {
+  switch (id) {
+    case TableID::kIGBTTemp2Modifier:
+      return IGBTTemp2Modifier_LUT;
+    case TableID::kBatteryTemp2Modifier:
+      return BatteryTemp2Modifier_LUT;
+    case TableID::kMotorTemp2Modifier:
+      return MotorTemp2Modifier_LUT;
+    case TableID::kRPM2Throttle:
+      return RPM2Throttle_LUT;
+    case TableID::kAccelThrottle2Modifier:
+      return DefaultAccelThrottle2Modifier_LUT;
+    case TableID::kRegenThrottle2Modifier:
+      return RegenThrottle2Modifier_LUT;
+    case TableID::kMotorRPM2RegenMax:
+      return MotorRPM2RegenMax_LUT;
+    case TableID::kMotorTemp2PumpDutyCycle:
+      return MotorTemp2PumpDutyCycle_LUT;
+    case TableID::kIGBTTemp2PumpDutyCycle:
+      return IGBTTemp2PumpDutyCycle_LUT;
+    case TableID::kBatteryTemp2PumpDutyCycle:
+      return BatteryTemp2PumpDutyCycle_LUT;
+    case TableID::kCoolantTemp2FanDutyCycle:
+    default:
+      return CoolantTemp2FanDutyCycle_LUT;
+  }
+}
+
+void Lookup::load_defaults(CalibrationBank& bank, DriveProfile profile) {
+  for (size_t i = 0; i < kNumTables; i++) {
+    bank.tables[i].table = static_cast<uint8_t>(i);
+    bank.tables[i].profile = static_cast<uint8_t>(profile);
+    bank.tables[i].lut_id = 0;
+    bank.tables[i].lut = default_table(static_cast<TableID>(i));
+  }
+  bank.generation = ++last_generation;
+  build_derived(bank);
+}
+
+void Lookup::build_derived(CalibrationBank& bank) {
+  size_t smooth_tables = 0;
+  for (StoredLUT& stored : bank.tables) {
+    stored.lut.unbind_cubics();
+    if (stored.lut.interp_type() == InterpType::SMOOTH_STEP && smooth_tables < kMaxSmoothTables) {
+      stored.lut.bind_cubics(bank.cubics[smooth_tables++]);
+    }
+  }
+  bank.pump_keys_shared =
+      bank.table(TableID::kMotorTemp2PumpDutyCycle)
+          .same_keys(bank.table(TableID::kMotorTemp2Modifier)) &&
+      bank.table(TableID::kIGBTTemp2PumpDutyCycle)
+          .same_keys(bank.table(TableID::kIGBTTemp2Modifier)) &&
+      bank.table(TableID::kBatteryTemp2PumpDutyCycle)
+          .same_keys(bank.table(TableID::kBatteryTemp2Modifier));
+}
+
+/**
+ * @brief The slot of a bank that is neither active nor pinned can be rebuilt: a control call only
+ *        pins the active bank and re-checks it after (see pin_calibration()). The active bank
+ *        and the pinned one hold at most two slots, so with both taken by other banks this is
+ *        only kNoSlot until the pinned call is done.
+ */
+uint8_t Lookup::free_throttle_slot(uint8_t bank) const {
+  uint8_t active = active_bank.load(std::memory_order_relaxed);
+  uint8_t pinned = pinned_bank.load(std::memory_order_seq_cst);
+  uint8_t free_slot = kNoSlot;
+  for (uint8_t slot = 0; slot < kNumThrottleSlots; slot++) {
+    uint8_t owner = throttle_slot_banks[slot];
+    if (owner == bank) {
+      return slot;
+    }
+    if (free_slot == kNoSlot && (owner == kNoBank || (owner != active && owner != pinned))) {
+      free_slot = slot;
+    }
+  }
+  return free_slot;
+}
+
+void Lookup::attach_throttle_tables(uint8_t bank, uint8_t slot) {
+  uint8_t owner = throttle_slot_banks[slot];
+  if (owner != kNoBank) {
+    banks[owner].throttle_tables = nullptr;
+  }
+  throttle_slot_banks[slot] = bank;
+  build_throttle_tables(throttle_slots[slot], banks[bank]);
+  banks[bank].throttle_tables = &throttle_slots[slot];
+}
+
+void Lookup::detach_throttle_tables(uint8_t bank) {
+  for (uint8_t& owner : throttle_slot_banks) {
+    if (owner == bank) {
+      owner = kNoBank;
+    }
+  }
+  banks[bank].throttle_tables = nullptr;
+}
+
+/**
+ * @brief The dense copies take ~16 KB a slot and the torque map ~3.5 KB, so a slot only holds the
+ *        ones the current mode reads. Tables left from another mode would go stale with the next
+ *        update, so anything else is dropped.
+ */
+void Lookup::build_throttle_tables(ThrottleTables& tables, const CalibrationBank& bank) {
+  switch (throttle_LUT_mode) {
+    case ThrottleLUTMode::kDense: {
+      auto& dense = tables.emplace<DenseThrottleLUTs>();
+      dense.accel.build(bank.table(TableID::kAccelThrottle2Modifier));
+      dense.regen.build(bank.table(TableID::kRegenThrottle2Modifier));
+      break;
+    }
+    case ThrottleLUTMode::kTorqueMap: {
+      auto& torque_map = tables.emplace<TorqueMap>(TorqueMapRPMAxis, TorqueMapPedalAxis);
+      build_torque_map(torque_map, bank);
+      break;
+    }
+    case ThrottleLUTMode::kInterpolated:
+    default:
+      tables.emplace<std::monostate>();
+      break;
+  }
+}
+
+/**
+ * @brief Bake the bank's pedal pipeline into its torque map: at each (rpm, pedal) grid point take
+ *        the zero torque point, rescale the pedal around it and apply the accel or regen curve.
+ *        Regen is stored negative. Uses the uncached lookups so the cache stats only count the
+ *        control loop.
+ */
+void Lookup::build_torque_map(TorqueMap& torque_map, const CalibrationBank& bank) {
+  const FlatLUT& rpm2throttle = bank.table(TableID::kRPM2Throttle);
+  const FlatLUT& accel = bank.table(TableID::kAccelThrottle2Modifier);
+  const FlatLUT& regen = bank.table(TableID::kRegenThrottle2Modifier);
+  int16_t throttle_max = static_cast<int16_t>(Bounds::SENSOR_SCALED_MAX);
+  for (size_t row = 0; row < torque_map.rows(); row++) {
+    int16_t zero_dot = scale(rpm2throttle.lookup(torque_map.row_key(row)), throttle_max);
+    for (size_t col = 0; col < torque_map.cols(); col++) {
+      int16_t throttle_index =
+          get_throttle_index_from_zero_dot(torque_map.col_key(col), throttle_max, zero_dot);
+      float torque_mod = 0.0f;
+      if (throttle_index > 0) {
+        torque_mod = accel.lookup(throttle_index);
+      } else if (throttle_index < 0) {
+        torque_mod = -regen.lookup(-throttle_index);
+      }
+      torque_map.set(row, col, torque_mod);
+    }
+  }
+}
+
+/**
+ * @brief Switching to kInterpolated keeps the tables of the last mode, so switching back to it
+ *        rebuilds nothing unless a slot was rebuilt in between.
+ */
+void Lookup::set_throttle_LUT_mode(ThrottleLUTMode mode) {
+  throttle_LUT_mode = mode;
+  for (uint8_t slot = 0; slot < kNumThrottleSlots; slot++) {
+    uint8_t bank = throttle_slot_banks[slot];
+    if (bank != kNoBank && !banks[bank].has_throttle_tables(mode)) {
+      build_throttle_tables(throttle_slots[slot], banks[bank]);
+    }
+  }
+}
+
+float Lookup::lookup(int16_t key, const FlatLUT& lut) { return lut.lookup(key); }
+
+float Lookup::lookup(int16_t key, const FlatLUT& lut, LUTCursor& cursor) {
+  return lut.lookup(key, cursor);
+}
 
-  return lower->second + (upper->second - lower->second) * static_cast<float>(key - lower->first) /
-                             static_cast<float>(upper->first - lower->first);
+Lookup::LUTCacheStats Lookup::get_LUT_cache_stats() const {
+  LUTCacheStats stats{0, 0};
+  for (const LUTCursor& lut_cursor : lut_cursors) {
+    stats.hits += lut_cursor.hits;
+    stats.misses += lut_cursor.misses;
+  }
+  return stats;
 }
 
 template <typename IntT>
@@ -41,12 +436,10 @@ IntT Lookup::scale(float value, IntT max) {
   return static_cast<IntT>(roundf(value * static_cast<float>(max)));
 }
 
-int16_t Lookup::get_throttle_index(int16_t real_throttle, int16_t throttle_max, int16_t motor_rpm) {
+int16_t Lookup::get_throttle_index_from_zero_dot(int16_t real_throttle, int16_t throttle_max,
+                                                 int16_t zero_dot) {
   int16_t throttle_index = 0;
 
-  float zero_dot_float = lookup(motor_rpm, RPM2Throttle_LUT);
-  int16_t zero_dot = scale(zero_dot_float, throttle_max);
-
   int32_t throttle_diff = (real_throttle - zero_dot) * throttle_max;
 
   if (zero_dot > 0) {
@@ -64,21 +457,39 @@ int16_t Lookup::get_throttle_index(int16_t real_throttle, int16_t throttle_max,
   return static_cast<int16_t>(throttle_index);
 }
 
+int16_t Lookup::get_throttle_index(int16_t real_throttle, int16_t throttle_max, int16_t motor_rpm) {
+  PinnedCalibration cal(*this);
+  float zero_dot_float = lookup(motor_rpm, cal->table(TableID::kRPM2Throttle),
+                                cursor(LUTCursorID::kRPM2Throttle));
+  int16_t zero_dot = scale(zero_dot_float, throttle_max);
+
+  return get_throttle_index_from_zero_dot(real_throttle, throttle_max, zero_dot);
+}
+
 // <accel_mod, regen_mod>
 std::pair<float, float> Lookup::get_torque_mods(int16_t real_throttle, int16_t throttle_max,
                                                 int16_t motor_rpm, bool brake_pressed) {
+  if (throttle_LUT_mode == ThrottleLUTMode::kTorqueMap) {
+    return get_torque_mods_from_map(real_throttle, throttle_max, motor_rpm, brake_pressed);
+  }
+
+  PinnedCalibration cal(*this);
   int16_t throttle_index = get_throttle_index(real_throttle, throttle_max, motor_rpm);
 
   float accel_mod = 0.0f;
   float regen_mod = 0.0f;
 
   if (throttle_index > 0 && !brake_pressed) {
-    accel_mod = lookup(throttle_index, AccelThrottle2Modifier_LUT);
+    accel_mod = (throttle_LUT_mode == ThrottleLUTMode::kDense)
+                    ? cal->dense().accel.lookup(throttle_index)
+                    : lookup(throttle_index, cal->table(TableID::kAccelThrottle2Modifier));
     regen_mod = 0.0f;
     can_data.torque_status = Lookup::TorqueStatusType::kAccel;
   } else if (throttle_index < 0 && !brake_pressed) {
     accel_mod = 0.0f;
-    regen_mod = lookup(-throttle_index, RegenThrottle2Modifier_LUT);
+    regen_mod = (throttle_LUT_mode == ThrottleLUTMode::kDense)
+                    ? cal->dense().regen.lookup(-throttle_index)
+                    : lookup(-throttle_index, cal->table(TableID::kRegenThrottle2Modifier));
     can_data.torque_status = Lookup::TorqueStatusType::kRegen;
   } else {
     accel_mod = 0.0f;
@@ -89,6 +500,38 @@ std::pair<float, float> Lookup::get_torque_mods(int16_t real_throttle, int16_t t
   return std::make_pair(accel_mod, regen_mod);
 }
 
+int16_t Lookup::map_pedal(int16_t real_throttle, int16_t throttle_max) {
+  if (throttle_max != static_cast<int16_t>(Bounds::SENSOR_SCALED_MAX) && throttle_max > 0) {
+    return static_cast<int16_t>(static_cast<int32_t>(real_throttle) *
+                                static_cast<int32_t>(Bounds::SENSOR_SCALED_MAX) / throttle_max);
+  }
+  return real_throttle;
+}
+
+// <accel_mod, regen_mod> from a single torque map lookup
+std::pair<float, float> Lookup::get_torque_mods_from_map(int16_t real_throttle,
+                                                         int16_t throttle_max, int16_t motor_rpm,
+                                                         bool brake_pressed) {
+  int16_t pedal = map_pedal(real_throttle, throttle_max);
+
+  PinnedCalibration cal(*this);
+  float torque_mod = brake_pressed ? 0.0f
+                                   : cal->torque_map().lookup(motor_rpm, pedal,
+                                                             cursor(LUTCursorID::kTorqueMapRPM),
+                                                             cursor(LUTCursorID::kTorqueMapPedal));
+
+  if (torque_mod > 0.0f) {
+    can_data.torque_status = Lookup::TorqueStatusType::kAccel;
+    return std::make_pair(torque_mod, 0.0f);
+  }
+  if (torque_mod < 0.0f) {
+    can_data.torque_status = Lookup::TorqueStatusType::kRegen;
+    return std::make_pair(0.0f, -torque_mod);
+  }
+  can_data.torque_status = Lookup::TorqueStatusType::kZero;
+  return std::make_pair(0.0f, 0.0f);
+}
+
 Lookup::TempLimitingType Lookup::is_temp_limiting(float temp_mod) {
   if (temp_mod < 1.0f) {
     return Lookup::TempLimitingType::kLimiting;
@@ -97,32 +540,74 @@ Lookup::TempLimitingType Lookup::is_temp_limiting(float temp_mod) {
   }
 }
 
-float Lookup::calculate_temp_mod(int16_t igbt_temp, int16_t batt_temp, int16_t motor_temp) {
-  float igbt_mod = lookup(igbt_temp, IGBTTemp2Modifier_LUT);
-  float batt_mod = lookup(batt_temp, BatteryTemp2Modifier_LUT);
-  float motor_temp_mod = lookup(motor_temp, MotorTemp2Modifier_LUT);
-  std::vector<float> temp_mods{igbt_mod, batt_mod, motor_temp_mod};
-
-  for (int i = 0; i < temp_mods.size(); i++) {
-    Lookup::TempLimitingType temp_limiting_status = is_temp_limiting(temp_mods.at(i));
-    can_data.temp_limiting_statuses.at(i) = temp_limiting_status;
+void Lookup::set_temp_limiting_statuses(const TempLimitingType (&statuses)[kNumTempMods]) {
+  for (size_t i = 0; i < kNumTempMods; i++) {
+    can_data.temp_limiting_statuses[i] = statuses[i];
   }
+}
 
-  return igbt_mod * batt_mod * motor_temp_mod;
+template <typename ModT>
+ModT Lookup::store_temp_mod(TempModCache<ModT>& cache, int16_t igbt_temp, int16_t batt_temp,
+                            int16_t motor_temp, uint32_t generation, ModT temp_mod) {
+  cache.valid = true;
+  cache.generation = generation;
+  cache.igbt_temp = igbt_temp;
+  cache.batt_temp = batt_temp;
+  cache.motor_temp = motor_temp;
+  cache.temp_mod = temp_mod;
+  set_temp_limiting_statuses(cache.statuses);
+  return temp_mod;
 }
 
-void Lookup::update_status_CAN() {
-  Torque_Status = static_cast<uint8_t>(can_data.torque_status);
+float Lookup::calculate_temp_mod(int16_t igbt_temp, int16_t batt_temp, int16_t motor_temp) {
+  PinnedCalibration cal(*this);
+  // temperatures move slowly, most ticks see the same three readings (and tables) as the last one
+  if (temp_mod_cache.matches(igbt_temp, batt_temp, motor_temp, cal->generation)) {
+    set_temp_limiting_statuses(temp_mod_cache.statuses);
+    return temp_mod_cache.temp_mod;
+  }
+
+  float igbt_mod = lookup(igbt_temp, cal->table(TableID::kIGBTTemp2Modifier),
+                          cursor(LUTCursorID::kIGBTTemp2Modifier));
+  float batt_mod = lookup(batt_temp, cal->table(TableID::kBatteryTemp2Modifier),
+                          cursor(LUTCursorID::kBatteryTemp2Modifier));
+  float motor_temp_mod = lookup(motor_temp, cal->table(TableID::kMotorTemp2Modifier),
+                                cursor(LUTCursorID::kMotorTemp2Modifier));
+
+  temp_mod_cache.statuses[kIGBTTempMod] = is_temp_limiting(igbt_mod);
+  temp_mod_cache.statuses[kBatteryTempMod] = is_temp_limiting(batt_mod);
+  temp_mod_cache.statuses[kMotorTempMod] = is_temp_limiting(motor_temp_mod);
 
-  IGBT_Temp_Limiting = static_cast<bool>(can_data.temp_limiting_statuses.at(0));
-  Battery_Temp_Limiting = static_cast<bool>(can_data.temp_limiting_statuses.at(1));
-  Motor_Temp_Limiting = static_cast<bool>(can_data.temp_limiting_statuses.at(2));
+  return store_temp_mod(temp_mod_cache, igbt_temp, batt_temp, motor_temp, cal->generation,
+                        igbt_mod * batt_mod * motor_temp_mod);
+}
+
+Lookup::StatusCAN Lookup::get_status_CAN() const {
+  StatusCAN status;
+  status.torque_status = static_cast<uint8_t>(can_data.torque_status);
+  status.IGBT_temp_limiting = static_cast<bool>(can_data.temp_limiting_statuses[kIGBTTempMod]);
+  status.battery_temp_limiting =
+      static_cast<bool>(can_data.temp_limiting_statuses[kBatteryTempMod]);
+  status.motor_temp_limiting = static_cast<bool>(can_data.temp_limiting_statuses[kMotorTempMod]);
+  status.regen_max = can_data.regen_max_value;
+  status.cache_stats = get_LUT_cache_stats();
+  return status;
+}
 
-  Regen_Max_Value = can_data.regen_max_value;
+void Lookup::update_status_CAN(const StatusCAN& status) {
+  Torque_Status = status.torque_status;
+  IGBT_Temp_Limiting = status.IGBT_temp_limiting;
+  Battery_Temp_Limiting = status.battery_temp_limiting;
+  Motor_Temp_Limiting = status.motor_temp_limiting;
+  Regen_Max_Value = status.regen_max;
+  LUT_Cache_Hits = status.cache_stats.hits;
+  LUT_Cache_Misses = status.cache_stats.misses;
 }
 
 int32_t Lookup::get_regen_max(int16_t motor_rpm) {
-  float regen_max_float = lookup(motor_rpm, MotorRPM2RegenMax_LUT);
+  PinnedCalibration cal(*this);
+  float regen_max_float = lookup(motor_rpm, cal->table(TableID::kMotorRPM2RegenMax),
+                                 cursor(LUTCursorID::kMotorRPM2RegenMax));
   return scale(regen_max_float, static_cast<int32_t>(Lookup::TorqueReqLimit::kRegenMax));
 }
 
@@ -142,9 +627,13 @@ std::pair<int32_t, int32_t> Lookup::calculate_torque_reqs(int16_t motor_rpm, flo
 
 uint8_t Lookup::calculate_pump_duty_cycle(int16_t motor_temp, int16_t igbt_temp,
                                           int16_t batt_temp) {
-  float motor_dc = lookup(motor_temp, MotorTemp2PumpDutyCycle_LUT);
-  float igbt_dc = lookup(igbt_temp, IGBTTemp2PumpDutyCycle_LUT);
-  float batt_dc = lookup(batt_temp, BatteryTemp2PumpDutyCycle_LUT);
+  PinnedCalibration cal(*this);
+  float motor_dc = lookup(motor_temp, cal->table(TableID::kMotorTemp2PumpDutyCycle),
+                          cursor(LUTCursorID::kMotorTemp2PumpDutyCycle));
+  float igbt_dc = lookup(igbt_temp, cal->table(TableID::kIGBTTemp2PumpDutyCycle),
+                         cursor(LUTCursorID::kIGBTTemp2PumpDutyCycle));
+  float batt_dc = lookup(batt_temp, cal->table(TableID::kBatteryTemp2PumpDutyCycle),
+                         cursor(LUTCursorID::kBatteryTemp2PumpDutyCycle));
 
   float dc_float = std::max(std::max(motor_dc, igbt_dc), batt_dc);
 
@@ -154,7 +643,330 @@ uint8_t Lookup::calculate_pump_duty_cycle(int16_t motor_temp, int16_t igbt_temp,
 uint8_t Lookup::calculate_fan_duty_cycle(float coolant_temp) {
   int16_t coolant_temp_int = static_cast<int16_t>(roundf(coolant_temp));
 
-  float coolant_dc = lookup(coolant_temp_int, CoolantTemp2FanDutyCycle_LUT);
+  PinnedCalibration cal(*this);
+  float coolant_dc = lookup(coolant_temp_int, cal->table(TableID::kCoolantTemp2FanDutyCycle),
+                            cursor(LUTCursorID::kCoolantTemp2FanDutyCycle));
 
   return scale(coolant_dc, static_cast<uint8_t>(PWMLimit::kFanMax));
 }
+
+Lookup::ThermalFrame Lookup::calculate_thermal_frame(int16_t motor_temp, int16_t igbt_temp,
+                                                     int16_t batt_temp, float coolant_temp) {
+  PinnedCalibration cal(*this);
+  // the fan table is keyed on whole degrees too
+  int16_t coolant_key = static_cast<int16_t>(roundf(coolant_temp));
+  ThermalFrameCache& cache = thermal_frame_cache;
+  if (cache.matches(motor_temp, igbt_temp, batt_temp, coolant_key, cal->generation)) {
+    set_temp_limiting_statuses(cache.statuses);
+    return cache.frame;
+  }
+
+  const FlatLUT& igbt_mod_lut = cal->table(TableID::kIGBTTemp2Modifier);
+  const FlatLUT& batt_mod_lut = cal->table(TableID::kBatteryTemp2Modifier);
+  const FlatLUT& motor_mod_lut = cal->table(TableID::kMotorTemp2Modifier);
+  const FlatLUT& motor_pump_lut = cal->table(TableID::kMotorTemp2PumpDutyCycle);
+  const FlatLUT& igbt_pump_lut = cal->table(TableID::kIGBTTemp2PumpDutyCycle);
+  const FlatLUT& batt_pump_lut = cal->table(TableID::kBatteryTemp2PumpDutyCycle);
+  LUTPosition igbt = igbt_mod_lut.locate(igbt_temp, cursor(LUTCursorID::kIGBTTemp2Modifier));
+  LUTPosition batt = batt_mod_lut.locate(batt_temp, cursor(LUTCursorID::kBatteryTemp2Modifier));
+  LUTPosition motor = motor_mod_lut.locate(motor_temp, cursor(LUTCursorID::kMotorTemp2Modifier));
+
+  ThermalFrame frame{};
+#ifdef LUT_FIXED_POINT
+  q15_t igbt_mod = igbt_mod_lut.lookup_q15(igbt);
+  q15_t batt_mod = batt_mod_lut.lookup_q15(batt);
+  q15_t motor_temp_mod = motor_mod_lut.lookup_q15(motor);
+  frame.temp_mod_q15 = q15_mul(q15_mul(igbt_mod, batt_mod), motor_temp_mod);
+  frame.temp_mod = q15_to_float(frame.temp_mod_q15);
+  auto limiting = [](q15_t mod) {
+    return mod < kQ15One ? TempLimitingType::kLimiting : TempLimitingType::kNotLimiting;
+  };
+  cache.statuses[kIGBTTempMod] = limiting(igbt_mod);
+  cache.statuses[kBatteryTempMod] = limiting(batt_mod);
+  cache.statuses[kMotorTempMod] = limiting(motor_temp_mod);
+
+  q15_t motor_dc;
+  q15_t igbt_dc;
+  q15_t batt_dc;
+  if (cal->pump_keys_shared) {
+    motor_dc = motor_pump_lut.lookup_q15(motor);
+    igbt_dc = igbt_pump_lut.lookup_q15(igbt);
+    batt_dc = batt_pump_lut.lookup_q15(batt);
+  } else {
+    // an uploaded pump table with its own keys
+    motor_dc = motor_pump_lut.lookup_q15(motor_temp, cursor(LUTCursorID::kMotorTemp2PumpDutyCycle));
+    igbt_dc = igbt_pump_lut.lookup_q15(igbt_temp, cursor(LUTCursorID::kIGBTTemp2PumpDutyCycle));
+    batt_dc = batt_pump_lut.lookup_q15(batt_temp, cursor(LUTCursorID::kBatteryTemp2PumpDutyCycle));
+  }
+  frame.pump_duty_cycle = static_cast<uint8_t>(q15_scale(
+      std::max(std::max(motor_dc, igbt_dc), batt_dc), static_cast<int32_t>(PWMLimit::kPumpMax)));
+  q15_t coolant_dc = cal->table(TableID::kCoolantTemp2FanDutyCycle)
+                         .lookup_q15(coolant_key, cursor(LUTCursorID::kCoolantTemp2FanDutyCycle));
+  frame.fan_duty_cycle =
+      static_cast<uint8_t>(q15_scale(coolant_dc, static_cast<int32_t>(PWMLimit::kFanMax)));
+#else
+  float igbt_mod = igbt_mod_lut.lookup(igbt);
+  float batt_mod = batt_mod_lut.lookup(batt);
+  float motor_temp_mod = motor_mod_lut.lookup(motor);
+  frame.temp_mod = igbt_mod * batt_mod * motor_temp_mod;
+  cache.statuses[kIGBTTempMod] = is_temp_limiting(igbt_mod);
+  cache.statuses[kBatteryTempMod] = is_temp_limiting(batt_mod);
+  cache.statuses[kMotorTempMod] = is_temp_limiting(motor_temp_mod);
+
+  if (cal->pump_keys_shared) {
+    float motor_dc = motor_pump_lut.lookup(motor);
+    float igbt_dc = igbt_pump_lut.lookup(igbt);
+    float batt_dc = batt_pump_lut.lookup(batt);
+    frame.pump_duty_cycle = scale(std::max(std::max(motor_dc, igbt_dc), batt_dc),
+                                  static_cast<uint8_t>(PWMLimit::kPumpMax));
+  } else {
+    // an uploaded pump table with its own keys
+    frame.pump_duty_cycle = calculate_pump_duty_cycle(motor_temp, igbt_temp, batt_temp);
+  }
+  frame.fan_duty_cycle = calculate_fan_duty_cycle(coolant_temp);
+#endif
+
+  frame.igbt_limiting = cache.statuses[kIGBTTempMod] == TempLimitingType::kLimiting;
+  frame.batt_limiting = cache.statuses[kBatteryTempMod] == TempLimitingType::kLimiting;
+  frame.motor_limiting = cache.statuses[kMotorTempMod] == TempLimitingType::kLimiting;
+  set_temp_limiting_statuses(cache.statuses);
+
+  cache.valid = true;
+  cache.motor_temp = motor_temp;
+  cache.igbt_temp = igbt_temp;
+  cache.batt_temp = batt_temp;
+  cache.coolant_temp = coolant_key;
+  cache.generation = cal->generation;
+  cache.frame = frame;
+  return frame;
+}
+
+std::pair<int32_t, int32_t> Lookup::get_torque_reqs(int16_t real_throttle, int16_t throttle_max,
+                                                    int16_t motor_rpm, bool brake_pressed,
+                                                    const ThermalFrame& thermal) {
+#ifdef LUT_FIXED_POINT
+  std::pair<q15_t, q15_t> torque_mods =
+      get_torque_mods_fixed(real_throttle, throttle_max, motor_rpm, brake_pressed);
+  return calculate_torque_reqs_fixed(motor_rpm, thermal.temp_mod_q15, torque_mods);
+#else
+  std::pair<float, float> torque_mods =
+      get_torque_mods(real_throttle, throttle_max, motor_rpm, brake_pressed);
+  return calculate_torque_reqs(motor_rpm, thermal.temp_mod, torque_mods);
+#endif
+}
+
+std::pair<int32_t, int32_t> Lookup::get_torque_reqs(int16_t real_throttle, int16_t throttle_max,
+                                                    int16_t motor_rpm, bool brake_pressed,
+                                                    int16_t igbt_temp, int16_t batt_temp,
+                                                    int16_t motor_temp) {
+#ifdef LUT_FIXED_POINT
+  return get_torque_reqs_fixed(real_throttle, throttle_max, motor_rpm, brake_pressed, igbt_temp,
+                               batt_temp, motor_temp);
+#else
+  return get_torque_reqs_float(real_throttle, throttle_max, motor_rpm, brake_pressed, igbt_temp,
+                               batt_temp, motor_temp);
+#endif
+}
+
+std::pair<int32_t, int32_t> Lookup::get_torque_reqs_float(int16_t real_throttle,
+                                                          int16_t throttle_max, int16_t motor_rpm,
+                                                          bool brake_pressed, int16_t igbt_temp,
+                                                          int16_t batt_temp, int16_t motor_temp) {
+  std::pair<float, float> torque_mods =
+      get_torque_mods(real_throttle, throttle_max, motor_rpm, brake_pressed);
+  float temp_mod = calculate_temp_mod(igbt_temp, batt_temp, motor_temp);
+  return calculate_torque_reqs(motor_rpm, temp_mod, torque_mods);
+}
+
+std::pair<int32_t, int32_t> Lookup::get_torque_reqs_fixed(int16_t real_throttle,
+                                                          int16_t throttle_max, int16_t motor_rpm,
+                                                          bool brake_pressed, int16_t igbt_temp,
+                                                          int16_t batt_temp, int16_t motor_temp) {
+  std::pair<q15_t, q15_t> torque_mods =
+      get_torque_mods_fixed(real_throttle, throttle_max, motor_rpm, brake_pressed);
+  q15_t temp_mod = calculate_temp_mod_fixed(igbt_temp, batt_temp, motor_temp);
+  return calculate_torque_reqs_fixed(motor_rpm, temp_mod, torque_mods);
+}
+
+int16_t Lookup::get_throttle_index_fixed(int16_t real_throttle, int16_t throttle_max,
+                                         int16_t motor_rpm) {
+  PinnedCalibration cal(*this);
+  q15_t zero_dot_q15 =
+      cal->table(TableID::kRPM2Throttle).lookup_q15(motor_rpm, cursor(LUTCursorID::kRPM2Throttle));
+  int16_t zero_dot = static_cast<int16_t>(q15_scale(zero_dot_q15, throttle_max));
+
+  return get_throttle_index_from_zero_dot(real_throttle, throttle_max, zero_dot);
+}
+
+/**
+ * @brief <accel_mod, regen_mod>, read the same way as get_torque_mods() for each
+ *        ThrottleLUTMode. The dense copies and the torque map hold floats, so those modes convert
+ *        the one value they read to Q15; the curves themselves are looked up in Q15.
+ */
+std::pair<q15_t, q15_t> Lookup::get_torque_mods_fixed(int16_t real_throttle, int16_t throttle_max,
+                                                      int16_t motor_rpm, bool brake_pressed) {
+  if (throttle_LUT_mode == ThrottleLUTMode::kTorqueMap) {
+    std::pair<float, float> torque_mods =
+        get_torque_mods_from_map(real_throttle, throttle_max, motor_rpm, brake_pressed);
+    return std::make_pair(float_to_q15(torque_mods.first), float_to_q15(torque_mods.second));
+  }
+
+  PinnedCalibration cal(*this);
+  int16_t throttle_index = get_throttle_index_fixed(real_throttle, throttle_max, motor_rpm);
+
+  q15_t accel_mod = 0;
+  q15_t regen_mod = 0;
+
+  if (throttle_index > 0 && !brake_pressed) {
+    accel_mod = (throttle_LUT_mode == ThrottleLUTMode::kDense)
+                    ? float_to_q15(cal->dense().accel.lookup(throttle_index))
+                    : cal->table(TableID::kAccelThrottle2Modifier).lookup_q15(throttle_index);
+    can_data.torque_status = Lookup::TorqueStatusType::kAccel;
+  } else if (throttle_index < 0 && !brake_pressed) {
+    regen_mod = (throttle_LUT_mode == ThrottleLUTMode::kDense)
+                    ? float_to_q15(cal->dense().regen.lookup(-throttle_index))
+                    : cal->table(TableID::kRegenThrottle2Modifier).lookup_q15(-throttle_index);
+    can_data.torque_status = Lookup::TorqueStatusType::kRegen;
+  } else {
+    can_data.torque_status = Lookup::TorqueStatusType::kZero;
+  }
+
+  return std::make_pair(accel_mod, regen_mod);
+}
+
+q15_t Lookup::calculate_temp_mod_fixed(int16_t igbt_temp, int16_t batt_temp, int16_t motor_temp) {
+  PinnedCalibration cal(*this);
+  if (temp_mod_fixed_cache.matches(igbt_temp, batt_temp, motor_temp, cal->generation)) {
+    set_temp_limiting_statuses(temp_mod_fixed_cache.statuses);
+    return temp_mod_fixed_cache.temp_mod;
+  }
+
+  q15_t igbt_mod = cal->table(TableID::kIGBTTemp2Modifier)
+                       .lookup_q15(igbt_temp, cursor(LUTCursorID::kIGBTTemp2Modifier));
+  q15_t batt_mod = cal->table(TableID::kBatteryTemp2Modifier)
+                       .lookup_q15(batt_temp, cursor(LUTCursorID::kBatteryTemp2Modifier));
+  q15_t motor_temp_mod = cal->table(TableID::kMotorTemp2Modifier)
+                             .lookup_q15(motor_temp, cursor(LUTCursorID::kMotorTemp2Modifier));
+
+  auto limiting = [](q15_t mod) {
+    return mod < kQ15One ? TempLimitingType::kLimiting : TempLimitingType::kNotLimiting;
+  };
+  temp_mod_fixed_cache.statuses[kIGBTTempMod] = limiting(igbt_mod);
+  temp_mod_fixed_cache.statuses[kBatteryTempMod] = limiting(batt_mod);
+  temp_mod_fixed_cache.statuses[kMotorTempMod] = limiting(motor_temp_mod);
+
+  return store_temp_mod(temp_mod_fixed_cache, igbt_temp, batt_temp, motor_temp, cal->generation,
+                        q15_mul(q15_mul(igbt_mod, batt_mod), motor_temp_mod));
+}
+
+int32_t Lookup::get_regen_max_fixed(int16_t motor_rpm) {
+  PinnedCalibration cal(*this);
+  q15_t regen_max_q15 = cal->table(TableID::kMotorRPM2RegenMax)
+                            .lookup_q15(motor_rpm, cursor(LUTCursorID::kMotorRPM2RegenMax));
+  return q15_scale(regen_max_q15, static_cast<int32_t>(Lookup::TorqueReqLimit::kRegenMax));
+}
+
+std::pair<int32_t, int32_t> Lookup::calculate_torque_reqs_fixed(
+    int16_t motor_rpm, q15_t temp_mod, std::pair<q15_t, q15_t> torque_mods) {
+  q15_t accel_mod_product = q15_mul(temp_mod, torque_mods.first);
+  q15_t regen_mod_product = q15_mul(temp_mod, torque_mods.second);
+
+  int32_t accel_torque =
+      q15_scale(accel_mod_product, static_cast<int32_t>(Lookup::TorqueReqLimit::kAccelMax));
+
+  int32_t regen_max = get_regen_max_fixed(motor_rpm);
+  int32_t regen_torque = q15_scale(regen_mod_product, regen_max);
+
+  return std::make_pair(accel_torque, regen_torque);
+}
+
+const FlatLUT& Lookup::table(TableID id) const {
+  return banks[active_bank.load(std::memory_order_acquire)].table(id);
+}
+
+void Lookup::lookup_batch(TableID id, const int16_t* keys, float* out, size_t n) const {
+  table(id).lookup_batch(keys, out, n);
+}
+
+/**
+ * @brief Batch version of get_torque_reqs_float(). Inputs are processed in chunks: each table is
+ *        looked up for the whole chunk at once (vectorized on x86 hosts), the integer steps in
+ *        between are plain loops. In kTorqueMap mode the map replaces the throttle curves and is
+ *        looked up per input. Results match the scalar pipeline exactly, in every mode.
+ */
+void Lookup::get_torque_reqs_batch(const TorqueInputs* inputs, std::pair<int32_t, int32_t>* out,
+                                   size_t n) {
+  constexpr size_t kChunk = 64;
+  int16_t motor_rpm[kChunk];
+  int16_t igbt_temp[kChunk];
+  int16_t batt_temp[kChunk];
+  int16_t motor_temp[kChunk];
+  int16_t accel_index[kChunk];
+  int16_t regen_index[kChunk];
+  float zero_dot[kChunk];
+  float accel_mod[kChunk];
+  float regen_mod[kChunk];
+  float igbt_mod[kChunk];
+  float batt_mod[kChunk];
+  float motor_temp_mod[kChunk];
+  float regen_max[kChunk];
+
+  // one calibration for the whole batch
+  PinnedCalibration cal(*this);
+  for (size_t start = 0; start < n; start += kChunk) {
+    size_t chunk = std::min(kChunk, n - start);
+    const TorqueInputs* in = inputs + start;
+
+    for (size_t i = 0; i < chunk; i++) {
+      motor_rpm[i] = in[i].motor_rpm;
+      igbt_temp[i] = in[i].igbt_temp;
+      batt_temp[i] = in[i].batt_temp;
+      motor_temp[i] = in[i].motor_temp;
+    }
+
+    if (throttle_LUT_mode == ThrottleLUTMode::kTorqueMap) {
+      // signed modifier per input, split like get_torque_mods_from_map(). The index is only a
+      // request flag here
+      for (size_t i = 0; i < chunk; i++) {
+        float torque_mod =
+            in[i].brake_pressed
+                ? 0.0f
+                : cal->torque_map().lookup(motor_rpm[i],
+                                         map_pedal(in[i].real_throttle, in[i].throttle_max));
+        accel_mod[i] = torque_mod > 0.0f ? torque_mod : 0.0f;
+        regen_mod[i] = torque_mod < 0.0f ? -torque_mod : 0.0f;
+        accel_index[i] = torque_mod > 0.0f ? 1 : 0;
+        regen_index[i] = torque_mod < 0.0f ? 1 : 0;
+      }
+    } else {
+      // the dense copies hold the curves' values at every index, the curves give the same
+      cal->table(TableID::kRPM2Throttle).lookup_batch(motor_rpm, zero_dot, chunk);
+      for (size_t i = 0; i < chunk; i++) {
+        int16_t throttle_index = get_throttle_index_from_zero_dot(
+            in[i].real_throttle, in[i].throttle_max, scale(zero_dot[i], in[i].throttle_max));
+        bool brake_pressed = in[i].brake_pressed;
+        accel_index[i] = (throttle_index > 0 && !brake_pressed) ? throttle_index : 0;
+        regen_index[i] = (throttle_index < 0 && !brake_pressed) ? -throttle_index : 0;
+      }
+
+      cal->table(TableID::kAccelThrottle2Modifier).lookup_batch(accel_index, accel_mod, chunk);
+      cal->table(TableID::kRegenThrottle2Modifier).lookup_batch(regen_index, regen_mod, chunk);
+    }
+    cal->table(TableID::kIGBTTemp2Modifier).lookup_batch(igbt_temp, igbt_mod, chunk);
+    cal->table(TableID::kBatteryTemp2Modifier).lookup_batch(batt_temp, batt_mod, chunk);
+    cal->table(TableID::kMotorTemp2Modifier).lookup_batch(motor_temp, motor_temp_mod, chunk);
+    cal->table(TableID::kMotorRPM2RegenMax).lookup_batch(motor_rpm, regen_max, chunk);
+
+    for (size_t i = 0; i < chunk; i++) {
+      float temp_mod = igbt_mod[i] * batt_mod[i] * motor_temp_mod[i];
+      // index 0 means no request, whatever the curve's first point is
+      float accel_mod_product = accel_index[i] > 0 ? temp_mod * accel_mod[i] : 0.0f;
+      float regen_mod_product = regen_index[i] > 0 ? temp_mod * regen_mod[i] : 0.0f;
+      int32_t regen_max_mA =
+          scale(regen_max[i], static_cast<int32_t>(Lookup::TorqueReqLimit::kRegenMax));
+      out[start + i] = std::make_pair(
+          scale(accel_mod_product, static_cast<int32_t>(Lookup::TorqueReqLimit::kAccelMax)),
+          scale(regen_mod_product, regen_max_mA));
+    }
+  }
+}
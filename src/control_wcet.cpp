@@ -0,0 +1,158 @@
+#include "fsm.hpp"
+
+#ifdef ECU_WCET_HARNESS
+
+#include <Arduino.h>
+
+#include "pedal_acquisition.hpp"
+#include "wcet_harness.hpp"
+
+// update() on the worst inputs we can think of, against kControlBudgetUs. Built with
+// -D ECU_WCET_HARNESS: fsm_init() doesn't start the CAN I/O task, this feeds the control side
+namespace {
+
+constexpr uint32_t kIterations = 2000;
+
+// APPS counts at, next to and past the ends of their ranges (clamped), and mid travel
+constexpr int16_t kAPPS1Counts[] = {0, 179, 180, 181, 507, 834, 835, 836, 2047, -2048};
+constexpr int16_t kAPPS2Counts[] = {1264, 1265, 1266, 1596, 1926, 1927, 1928, 0, 2047};
+// not pressed, either side of the pressed threshold, full scale
+constexpr int16_t kBrakeCounts[] = {0, 399, 400, 4095};
+// rpm / temperatures at the table ends and beyond, both signs
+constexpr int16_t kMotorRpms[] = {-32768, -1, 0, 1, 2500, 5500, 6000, 6001, 32767};
+constexpr int16_t kTemperatures[] = {-40, 0, 25, 50, 60, 80, 100, 150, 300};
+
+template <typename T, size_t N>
+constexpr size_t count_of(const T (&)[N]) {
+  return N;
+}
+
+// every input list walks at its own rate, so the iterations cover the combinations
+template <typename T, size_t N>
+T pick(const T (&values)[N], uint32_t iteration, uint32_t stride) {
+  return values[(iteration / stride) % N];
+}
+
+// a fresh oversampled block, as if the acquisition task had just published it
+void feed_pedals(int16_t APPS1, int16_t APPS2, int16_t brake) {
+  const int16_t counts[kNumPedalChannels] = {APPS1, APPS2, brake, brake};
+  PedalAcquisition& acquisition = throttle_brake.get_acquisition();
+  for (uint16_t i = 0; i < acquisition.get_config().oversample; i++) {
+    acquisition.add_sample(counts, micros());
+  }
+}
+
+void feed_bus(int16_t motor_rpm, int16_t temperature) {
+  BusInputs inputs;
+  inputs.bms_state = BMSState::kActive;
+  inputs.external_kill_fault = BMSFault::kNoExtFault;
+  inputs.battery_temperature = temperature;
+  inputs.before_motor_temperature = temperature;
+  inputs.inverter.motor_rpm = motor_rpm;
+  inputs.inverter.IGBT_temp = temperature;
+  inputs.inverter.motor_temp = temperature;
+  bus_to_control.publish(inputs);
+}
+
+// DRIVE is the state that runs the torque lookups
+void hold_drive() {
+  tsactive_switch = TSActive::Active;
+  ready_to_drive = Ready_To_Drive_State::Drive;
+  drive_state = State::DRIVE;
+}
+
+void prepare_boundaries(uint32_t iteration) {
+  feed_pedals(pick(kAPPS1Counts, iteration, 1), pick(kAPPS2Counts, iteration, 1),
+              pick(kBrakeCounts, iteration, 1));
+  feed_bus(pick(kMotorRpms, iteration, count_of(kAPPS1Counts)),
+           pick(kTemperatures, iteration, count_of(kAPPS1Counts) * count_of(kMotorRpms)));
+  // derating from the previous cycle's snapshot, like the thermal task
+  update_thermal();
+  hold_drive();
+}
+
+// a table swapped in before every cycle: new bank, cold segment caches
+void prepare_upload(uint32_t iteration) {
+  static const FlatLUT kTables[2] = {FlatLUT{{0, 0.0f}, {1000, 0.5f}, {2047, 1.0f}},
+                                     FlatLUT{{0, 0.0f}, {1000, 0.25f}, {2047, 1.0f}}};
+  lookup.install_LUT(Lookup::TableID::kAccelThrottle2Modifier, kTables[iteration % 2],
+                     static_cast<uint8_t>(1 + iteration % 2));
+  prepare_boundaries(iteration);
+}
+
+// running and already expired, so the next tick_timers() fires it
+void expire(VirtualTimer& timer) {
+  timer.Disable();
+  timer.Enable();
+  timer.Start(millis() - 1000);
+}
+
+// APPSs out of range and disagreeing, brake pressed with throttle (BPPC), every timer due
+void prepare_implausibilities(uint32_t iteration) {
+  feed_pedals(pick(kAPPS1Counts, iteration, 1) == 0 ? 2047 : 0, 1596, 4095);
+  feed_bus(pick(kMotorRpms, iteration, 1), pick(kTemperatures, iteration, 1));
+  expire(APPSs_disagree_timer);
+  expire(brake_implausible_timer);
+  expire(APPSs_invalid_timer);
+  hold_drive();
+}
+
+void run_control(uint32_t) { update(); }
+
+// what runs in the executive pass of a control release
+void run_control_pass(uint32_t) {
+  tick_timers();
+  update();
+}
+
+// the pass where every decimated task is released with control: it has to end before the next
+// control release (the print task is left out, it is debug output)
+void run_decimated_pass(uint32_t) {
+  tick_timers();
+  update();
+  update_thermal();
+  update_status();
+}
+
+}  // namespace
+
+bool run_control_wcet() {
+  // from here on the harness is the only producer of pedal blocks
+  throttle_brake.get_acquisition().stop();
+  delay(5);
+
+  WcetHarness harness{[]() -> uint32_t { return micros(); }};
+  harness.add_scenario("lut_boundaries", prepare_boundaries, run_control, kControlBudgetUs);
+  harness.add_scenario("lut_upload", prepare_upload, run_control, kControlBudgetUs);
+  harness.add_scenario("decimated_pass", prepare_boundaries, run_decimated_pass,
+                       kControlPeriodUs);
+  // last: the implausibility flags latch
+  harness.add_scenario("implausibilities", prepare_implausibilities, run_control_pass,
+                       kControlBudgetUs);
+  // the harness build never drives: the test tables left installed are never used or saved
+  bool passed = harness.run(kIterations);
+
+  Serial.print("control period us: ");
+  Serial.print(kControlPeriodUs);
+  Serial.print(" budget us: ");
+  Serial.println(kControlBudgetUs);
+  for (size_t i = 0; i < harness.num_scenarios(); i++) {
+    const WcetHarness::Result& result = harness.result(i);
+    Serial.print(harness.name(i));
+    Serial.print(" runs: ");
+    Serial.print(result.runs);
+    Serial.print(" mean_us: ");
+    Serial.print(result.mean_us());
+    Serial.print(" max_us: ");
+    Serial.print(result.max_us);
+    Serial.print(" (iteration ");
+    Serial.print(result.worst_iteration);
+    Serial.print(") budget_us: ");
+    Serial.print(harness.budget_us(i));
+    Serial.println(result.within_budget ? " PASS" : " FAIL");
+  }
+  Serial.println(passed ? "WCET PASS" : "WCET FAIL");
+  return passed;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "cyclic_executive.hpp"
+
+#include <cstring>
+
+bool CyclicExecutive::add_task(const char* name, uint32_t period_us, TaskFn fn,
+                               uint32_t deadline_us) {
+  if (task_count >= kMaxTasks || period_us == 0 || fn == nullptr) {
+    return false;
+  }
+  // rate-monotonic: after every task with the same or a shorter period
+  size_t slot = task_count;
+  while (slot > 0 && tasks[slot - 1].period_us > period_us) {
+    tasks[slot] = tasks[slot - 1];
+    slot--;
+  }
+  Task& task = tasks[slot];
+  task = Task{};
+  task.name = name;
+  task.period_us = period_us;
+  task.deadline_us = deadline_us != 0 ? deadline_us : period_us;
+  task.fn = fn;
+  task_count++;
+  return true;
+}
+
+void CyclicExecutive::start() {
+  uint32_t now = clock();
+  for (size_t i = 0; i < task_count; i++) {
+    tasks[i].next_release_us = now;
+  }
+}
+
+size_t CyclicExecutive::run_once() {
+  size_t ran = 0;
+  uint32_t now = clock();
+  for (size_t i = 0; i < task_count; i++) {
+    Task& task = tasks[i];
+    // wrap safe: released once now is at or past the release time
+    if (static_cast<int32_t>(now - task.next_release_us) < 0) {
+      continue;
+    }
+    run_task(task, now);
+    now = clock();
+    ran++;
+  }
+  return ran;
+}
+
+void CyclicExecutive::run_task(Task& task, uint32_t start_us) {
+  uint32_t release = task.next_release_us;
+  task.fn();
+  uint32_t end = clock();
+
+  TaskStats& stats = task.stats;
+  stats.runs++;
+  stats.last_exec_us = end - start_us;
+  if (stats.last_exec_us > stats.max_exec_us) {
+    stats.max_exec_us = stats.last_exec_us;
+  }
+  if (start_us - release > stats.max_jitter_us) {
+    stats.max_jitter_us = start_us - release;
+  }
+  uint32_t response = end - release;
+  if (response > task.deadline_us) {
+    stats.overruns++;
+  }
+
+  // releases that came and went before the task finished are dropped, the phase is kept
+  uint32_t missed = response == 0 ? 0 : (response - 1) / task.period_us;
+  stats.skipped += missed;
+  task.next_release_us = release + (missed + 1) * task.period_us;
+}
+
+const CyclicExecutive::TaskStats* CyclicExecutive::stats(const char* name) const {
+  for (size_t i = 0; i < task_count; i++) {
+    if (std::strcmp(tasks[i].name, name) == 0) {
+      return &tasks[i].stats;
+    }
+  }
+  return nullptr;
+}
+
+void CyclicExecutive::reset_stats() {
+  for (size_t i = 0; i < task_count; i++) {
+    tasks[i].stats = TaskStats{};
+  }
+}
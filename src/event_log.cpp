@@ -0,0 +1,101 @@
+#include "event_log.hpp"
+
+#include <cstdio>
+#include <iterator>
+
+EventLog event_log;
+
+namespace {
+// indexed by LogEvent, up to LogRecord::kMaxArgs %ld conversions each
+constexpr const char* kFormats[] = {
+    "transition from OFF->N",
+    "transition from N->DRIVE",
+    "transition from N->OFF",
+    "transition from DRIVE->N",
+    "transition from DRIVE->OFF",
+    "Brake implausibility detected",
+    "APPSs invalid implausibility detected",
+    "APPSs disagreement implausibility detected",
+    "Pedal ADC acquisition failed to start",
+    "Drive State: %ld (0 OFF, 1 N, 2 DRIVE) TS active switch: %ld brake_pressed: %ld Ready to "
+    "Drive: %ld Ready to Drive Switch: %ld",
+    "cycle_us: %ld max_cycle_us: %ld pedal_to_cmd_us: %ld max_pedal_to_cmd_us: %ld adc_overruns: "
+    "%ld",
+    "test tsactive: %ld test ready to drive: %ld",
+    "APPS1_ADC: %ld APPS2_ADC: %ld",
+    "Set_Cur: %ld Set_Cur_Br: %ld",
+};
+static_assert(std::size(kFormats) == static_cast<size_t>(LogEvent::kCount),
+              "one format per LogEvent");
+}  // namespace
+
+EventLog::EventLog() {
+  for (uint32_t i = 0; i < kCapacity; i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+bool EventLog::push(LogEvent event, const int32_t* values, size_t num_args) {
+  uint32_t position = head.load(std::memory_order_relaxed);
+  Slot* slot;
+  for (;;) {
+    slot = &slots[position & kIndexMask];
+    uint32_t sequence = slot->sequence.load(std::memory_order_acquire);
+    int32_t lag = static_cast<int32_t>(sequence - position);
+    if (lag == 0) {
+      // the slot is free: claim the position, retry from the new head if another writer won
+      if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (lag < 0) {
+      // the consumer has not freed it yet: full
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = head.load(std::memory_order_relaxed);
+    }
+  }
+
+  LogRecord& record = slot->record;
+  record.timestamp_us = now_us();
+  record.event = event;
+  record.num_args = static_cast<uint8_t>(num_args);
+  for (size_t i = 0; i < LogRecord::kMaxArgs; i++) {
+    record.args[i] = i < num_args ? values[i] : 0;
+  }
+  // release: the record is complete before the consumer sees the slot as written
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+bool EventLog::pop(LogRecord& record) {
+  Slot& slot = slots[tail & kIndexMask];
+  // not written yet, or claimed and still being written
+  if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+    return false;
+  }
+  record = slot.record;
+  // release: done reading before a producer may reuse the slot, one lap later
+  slot.sequence.store(tail + kCapacity, std::memory_order_release);
+  tail++;
+  return true;
+}
+
+size_t EventLog::format(const LogRecord& record, char* buffer, size_t size) {
+  size_t event = static_cast<size_t>(record.event);
+  int prefix = std::snprintf(buffer, size, "%lu ", static_cast<unsigned long>(record.timestamp_us));
+  size_t length = prefix > 0 ? static_cast<size_t>(prefix) : 0;
+  char* rest = length < size ? buffer + length : nullptr;
+  size_t rest_size = length < size ? size - length : 0;
+
+  int written;
+  if (event >= static_cast<size_t>(LogEvent::kCount)) {
+    written = std::snprintf(rest, rest_size, "unknown event %u", static_cast<unsigned>(event));
+  } else {
+    const int32_t* args = record.args;
+    written = std::snprintf(rest, rest_size, kFormats[event], static_cast<long>(args[0]),
+                            static_cast<long>(args[1]), static_cast<long>(args[2]),
+                            static_cast<long>(args[3]), static_cast<long>(args[4]));
+  }
+  return length + (written > 0 ? static_cast<size_t>(written) : 0);
+}
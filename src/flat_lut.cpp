@@ -0,0 +1,215 @@
+#include "flat_lut.hpp"
+
+/**
+ * @brief Locate the segment holding key, must be called with keys[0] < key < keys[count - 1].
+ *        Keys on the uniform grid are indexed directly, anything else uses a branchless binary
+ *        search over the remaining points.
+ *
+ * @return index of the last key <= key
+ */
+size_t FlatLUT::find_segment(int16_t key) const {
+  size_t first = 0;
+  if (grid_points > 0) {
+    if (key < keys[grid_points - 1]) {
+      size_t i = (static_cast<uint32_t>(key - keys[0]) * grid_recip) >> kGridRecipBits;
+      if (i > grid_points - 2u) {
+        i = grid_points - 2u;
+      }
+      // grid keys are rounded to integers, so the estimate can be a segment off
+      while (keys[i] > key) {
+        i--;
+      }
+      while (keys[i + 1] <= key) {
+        i++;
+      }
+      return i;
+    }
+    first = grid_points - 1u;
+  }
+
+  const int16_t* base = keys + first;
+  size_t n = count - first;
+  while (n > 1) {
+    size_t half = n / 2;
+    // compiles to a conditional move, no data dependent branch
+    base = (base[half] <= key) ? base + half : base;
+    n -= half;
+  }
+  return static_cast<size_t>(base - keys);
+}
+
+/**
+ * @brief find_segment() that first checks the cursor's segment, then the segments on either
+ *        side of it. Must be called with keys[0] < key < keys[count - 1].
+ */
+size_t FlatLUT::find_segment(int16_t key, LUTCursor& cursor) const {
+  size_t i = cursor.segment;
+  if (i + 1 < count) {
+    if (keys[i] <= key) {
+      if (key < keys[i + 1]) {
+        cursor.hits++;
+        return i;
+      }
+      if (i + 2 < count && key < keys[i + 2]) {
+        cursor.hits++;
+        cursor.segment = static_cast<uint8_t>(i + 1);
+        return i + 1;
+      }
+    } else if (i > 0 && keys[i - 1] <= key) {
+      cursor.hits++;
+      cursor.segment = static_cast<uint8_t>(i - 1);
+      return i - 1;
+    }
+  }
+
+  cursor.misses++;
+  i = find_segment(key);
+  cursor.segment = static_cast<uint8_t>(i);
+  return i;
+}
+
+/**
+ * @brief A clamped key sits on the first or last point with a zero offset. The last point's
+ *        slope / cubic is never written and stays 0, so interpolating there gives its value.
+ */
+LUTPosition FlatLUT::locate(int16_t key) const {
+  if (count == 0 || key <= keys[0]) {
+    return {0, keys[0]};
+  }
+  if (key >= keys[count - 1]) {
+    return {static_cast<uint8_t>(count - 1), keys[count - 1]};
+  }
+  return {static_cast<uint8_t>(find_segment(key)), key};
+}
+
+LUTPosition FlatLUT::locate(int16_t key, LUTCursor& cursor) const {
+  if (count == 0 || key <= keys[0]) {
+    return {0, keys[0]};
+  }
+  if (key >= keys[count - 1]) {
+    return {static_cast<uint8_t>(count - 1), keys[count - 1]};
+  }
+  return {static_cast<uint8_t>(find_segment(key, cursor)), key};
+}
+
+float FlatLUT::lookup(int16_t key) const {
+  if (count == 0) {
+    return 0.0f;
+  }
+  // if key is smaller than the smallest key, return the first value
+  if (key <= keys[0]) {
+    return values[0];
+  }
+  // if key is larger than the largest key, return the last value
+  if (key >= keys[count - 1]) {
+    return values[count - 1];
+  }
+
+  // key is on or after point i and before point i + 1, interpolate (exact hits give values[i])
+  return interpolate(find_segment(key), key);
+}
+
+float FlatLUT::lookup(int16_t key, LUTCursor& cursor) const {
+  if (count == 0) {
+    return 0.0f;
+  }
+  if (key <= keys[0]) {
+    return values[0];
+  }
+  if (key >= keys[count - 1]) {
+    return values[count - 1];
+  }
+
+  return interpolate(find_segment(key, cursor), key);
+}
+
+q15_t FlatLUT::lookup_q15(int16_t key) const {
+  if (count == 0) {
+    return 0;
+  }
+  if (key <= keys[0]) {
+    return values_q15[0];
+  }
+  if (key >= keys[count - 1]) {
+    return values_q15[count - 1];
+  }
+
+  return interpolate_q15(find_segment(key), key);
+}
+
+q15_t FlatLUT::lookup_q15(int16_t key, LUTCursor& cursor) const {
+  if (count == 0) {
+    return 0;
+  }
+  if (key <= keys[0]) {
+    return values_q15[0];
+  }
+  if (key >= keys[count - 1]) {
+    return values_q15[count - 1];
+  }
+
+  return interpolate_q15(find_segment(key, cursor), key);
+}
+
+/**
+ * @brief Tangents at interior points are the weighted harmonic mean of the neighbouring secants
+ *        (0 at a local extremum), end tangents are the end secants. This keeps each segment
+ *        monotone between its two points.
+ */
+float FlatLUT::tangent(size_t i) const {
+  if (i == 0) {
+    return slopes[0];
+  }
+  if (i + 1 >= count) {
+    return slopes[count - 2];
+  }
+  float before = slopes[i - 1];
+  float after = slopes[i];
+  if (before * after <= 0.0f) {
+    return 0.0f;
+  }
+  float span_before = static_cast<float>(keys[i] - keys[i - 1]);
+  float span_after = static_cast<float>(keys[i + 1] - keys[i]);
+  float w_before = 2.0f * span_after + span_before;
+  float w_after = span_after + 2.0f * span_before;
+  return (w_before + w_after) / (w_before / before + w_after / after);
+}
+
+CubicSegment FlatLUT::cubic_segment(size_t i) const {
+  CubicSegment cubic;
+  if (i + 1 >= count) {
+    return cubic;
+  }
+  float span = static_cast<float>(keys[i + 1] - keys[i]);
+  float m0 = tangent(i);
+  float m1 = tangent(i + 1);
+  cubic.c1 = m0;
+  cubic.c2 = (3.0f * slopes[i] - 2.0f * m0 - m1) / span;
+  cubic.c3 = (m0 + m1 - 2.0f * slopes[i]) / (span * span);
+  return cubic;
+}
+
+// normalized: value = values[i] + u * (m0 * span + u * (...)), u in [0, 1)
+CubicSegmentQ15 FlatLUT::cubic_segment_q15(size_t i) const {
+  CubicSegmentQ15 cubic;
+  if (i + 1 >= count) {
+    return cubic;
+  }
+  float span = static_cast<float>(keys[i + 1] - keys[i]);
+  float rise = values[i + 1] - values[i];
+  float m0 = tangent(i);
+  float m1 = tangent(i + 1);
+  cubic.c1 = float_to_q15(m0 * span);
+  cubic.c2 = float_to_q15(3.0f * rise - (2.0f * m0 + m1) * span);
+  cubic.c3 = float_to_q15((m0 + m1) * span - 2.0f * rise);
+  uint32_t key_span = static_cast<uint32_t>(keys[i + 1] - keys[i]);
+  cubic.span_recip = ((static_cast<uint32_t>(1) << 31) + key_span / 2) / key_span;
+  return cubic;
+}
+
+void FlatLUT::compute_cubics(CubicSegments& storage) const {
+  for (size_t i = 0; i < kMaxLUTPoints; i++) {
+    storage.segments[i] = cubic_segment(i);
+    storage.segments_q15[i] = cubic_segment_q15(i);
+  }
+}
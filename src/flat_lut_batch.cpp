@@ -0,0 +1,164 @@
+#include "flat_lut.hpp"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+void FlatLUT::lookup_batch_scalar(const int16_t* keys_in, float* out, size_t n) const {
+  for (size_t i = 0; i < n; i++) {
+    out[i] = lookup(keys_in[i]);
+  }
+}
+
+#if defined(__AVX2__)
+
+namespace {
+
+// a kMaxLUTPoints entry table held in 4 registers
+struct RegisterTable {
+  __m256 part[kMaxLUTPoints / 8];
+
+  explicit RegisterTable(const float* table) {
+    for (size_t i = 0; i < kMaxLUTPoints / 8; i++) {
+      part[i] = _mm256_loadu_ps(table + 8 * i);
+    }
+  }
+
+  // table[index] per lane (index 0 - 31) with permutes and blends instead of a gather
+  __m256 select(__m256i index) const {
+    // permutevar8x32 reads bits 0 - 2, blendv reads the sign bit: shift bits 3 and 4 up to it
+    __m256 bit3 = _mm256_castsi256_ps(_mm256_slli_epi32(index, 28));
+    __m256 bit4 = _mm256_castsi256_ps(_mm256_slli_epi32(index, 27));
+    __m256 low = _mm256_blendv_ps(_mm256_permutevar8x32_ps(part[0], index),
+                                  _mm256_permutevar8x32_ps(part[1], index), bit3);
+    __m256 high = _mm256_blendv_ps(_mm256_permutevar8x32_ps(part[2], index),
+                                   _mm256_permutevar8x32_ps(part[3], index), bit3);
+    return _mm256_blendv_ps(low, high, bit4);
+  }
+};
+
+static_assert(kMaxLUTPoints == 32, "RegisterTable::select assumes 32 points");
+
+}  // namespace
+
+/**
+ * @brief 16 keys per step. Each lane's segment is the number of points after the first that are
+ *        at or below its (clamped) key, counted with 16 bit compares. The segment's coefficients
+ *        are then picked from tables held in registers. A clamped key lands on the first or last
+ *        point with a zero offset, the last point's slope / cubic is never written and stays 0.
+ */
+void FlatLUT::lookup_batch(const int16_t* keys_in, float* out, size_t n) const {
+  if (count < 2) {
+    lookup_batch_scalar(keys_in, out, n);
+    return;
+  }
+
+  float key_table[kMaxLUTPoints] = {};
+  float c1_table[kMaxLUTPoints] = {};
+  float c2_table[kMaxLUTPoints] = {};
+  float c3_table[kMaxLUTPoints] = {};
+  for (size_t i = 0; i < count; i++) {
+    key_table[i] = static_cast<float>(keys[i]);
+    if (smooth()) {
+      CubicSegment cubic = cubics != nullptr ? cubics->segments[i] : cubic_segment(i);
+      c1_table[i] = cubic.c1;
+      c2_table[i] = cubic.c2;
+      c3_table[i] = cubic.c3;
+    } else {
+      c1_table[i] = slopes[i];
+    }
+  }
+  const RegisterTable point_keys(key_table);
+  const RegisterTable point_values(values);
+  const RegisterTable c1(c1_table);
+  const RegisterTable c2(c2_table);
+  const RegisterTable c3(c3_table);
+
+  const __m256i first_key = _mm256_set1_epi16(keys[0]);
+  const __m256i last_key = _mm256_set1_epi16(keys[count - 1]);
+  const __m256i last_segment = _mm256_set1_epi16(static_cast<int16_t>(count - 1));
+
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys_in + i));
+    key = _mm256_max_epi16(_mm256_min_epi16(key, last_key), first_key);
+
+    __m256i segment = last_segment;
+    for (size_t j = 1; j < count; j++) {
+      // adds -1 for every point above the key
+      segment = _mm256_add_epi16(segment, _mm256_cmpgt_epi16(_mm256_set1_epi16(keys[j]), key));
+    }
+
+    for (int half = 0; half < 2; half++) {
+      __m128i key_half = half == 0 ? _mm256_castsi256_si128(key)
+                                   : _mm256_extracti128_si256(key, 1);
+      __m128i segment_half = half == 0 ? _mm256_castsi256_si128(segment)
+                                       : _mm256_extracti128_si256(segment, 1);
+      __m256i index = _mm256_cvtepi16_epi32(segment_half);
+      // exact: both are integers well inside float precision
+      __m256 offset = _mm256_sub_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(key_half)),
+                                    point_keys.select(index));
+
+      __m256 value;
+      if (smooth()) {
+        __m256 poly = _mm256_add_ps(c2.select(index), _mm256_mul_ps(offset, c3.select(index)));
+        poly = _mm256_add_ps(c1.select(index), _mm256_mul_ps(offset, poly));
+        value = _mm256_add_ps(point_values.select(index), _mm256_mul_ps(offset, poly));
+      } else {
+        value = _mm256_add_ps(point_values.select(index),
+                              _mm256_mul_ps(c1.select(index), offset));
+      }
+      _mm256_storeu_ps(out + i + 8 * half, value);
+    }
+  }
+
+  lookup_batch_scalar(keys_in + i, out + i, n - i);
+}
+
+#elif defined(__SSE2__)
+
+/**
+ * @brief 8 keys per step: the segment search runs in 16 bit lanes (count the points after the
+ *        first that are at or below each clamped key), SSE2 has no gather so the interpolation
+ *        itself is done per lane.
+ */
+void FlatLUT::lookup_batch(const int16_t* keys_in, float* out, size_t n) const {
+  if (count < 2) {
+    lookup_batch_scalar(keys_in, out, n);
+    return;
+  }
+
+  const __m128i first_key = _mm_set1_epi16(keys[0]);
+  const __m128i last_key = _mm_set1_epi16(keys[count - 1]);
+  const __m128i last_segment = _mm_set1_epi16(static_cast<int16_t>(count - 1));
+
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i key = _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys_in + i));
+    key = _mm_max_epi16(_mm_min_epi16(key, last_key), first_key);
+
+    __m128i segment = last_segment;
+    for (size_t j = 1; j < count; j++) {
+      // adds -1 for every point above the key
+      segment = _mm_add_epi16(segment, _mm_cmpgt_epi16(_mm_set1_epi16(keys[j]), key));
+    }
+
+    alignas(16) int16_t lane_segment[8];
+    alignas(16) int16_t lane_key[8];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane_segment), segment);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lane_key), key);
+    for (size_t lane = 0; lane < 8; lane++) {
+      out[i + lane] = interpolate(static_cast<size_t>(lane_segment[lane]), lane_key[lane]);
+    }
+  }
+
+  lookup_batch_scalar(keys_in + i, out + i, n - i);
+}
+
+#else
+
+void FlatLUT::lookup_batch(const int16_t* keys_in, float* out, size_t n) const {
+  lookup_batch_scalar(keys_in, out, n);
+}
+
+#endif
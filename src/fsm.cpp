@@ -2,11 +2,20 @@
 
 #include <Arduino.h>
 
+#include <atomic>
+
 #include "LUT.hpp"
 #include "active_aero.hpp"
+#include "cyclic_executive.hpp"
 #include "esp_can.h"
+#include "event_log.hpp"
 #include "inverter_driver.hpp"
 #include "pins.hpp"
+#ifdef ECU_PROFILING
+#include "profiler_can.hpp"
+#endif
+#include "spsc_snapshot.hpp"
+#include "stage_profiler.hpp"
 #include "throttle_brake_driver.hpp"
 #include "virtualTimer.h"
 
@@ -17,6 +26,17 @@ volatile int test_ready_to_drive_switch_interrupt = 1;  // 1 N, 0 D,
 TSActive tsactive_switch;
 Ready_To_Drive_State ready_to_drive;
 Ready_To_Drive_State ready_to_drive_switch;
+State drive_state;
+BMSCommand bms_command;
+
+// between the CAN I/O task and the control task
+SnapshotBuffer<BusInputs> bus_to_control;
+SnapshotBuffer<BusOutputs> control_to_bus;
+VehicleSnapshot vehicle{};
+
+std::atomic<uint32_t> pedal_to_command_us{0};
+std::atomic<uint32_t> max_pedal_to_command_us{0};
+std::atomic<CalibrationSave> calibration_save{CalibrationSave::kIdle};
 
 // instantiate CAN bus
 ESPCAN drive_bus{100U, GPIO_NUM_5, GPIO_NUM_4};
@@ -24,17 +44,55 @@ ESPCAN drive_bus{100U, GPIO_NUM_5, GPIO_NUM_4};
 // instantiate timer group
 VirtualTimerGroup timers;
 
+// runs every periodic task from loop()
+CyclicExecutive executive{[]() -> uint32_t { return micros(); }};
+
+// task periods (us), control's is in fsm.hpp. Same period: registration order. The slower tasks
+// are released in control's passes, after it, whatever the control rate
+constexpr uint32_t kImplausibilityTimerPeriodUs = 1000;
+constexpr uint32_t kThermalPeriodUs = CyclicExecutive::decimated_period(kControlPeriodUs, 10000);
+constexpr uint32_t kStatusPeriodUs = CyclicExecutive::decimated_period(kControlPeriodUs, 100000);
+constexpr uint32_t kPrintPeriodUs = CyclicExecutive::decimated_period(kControlPeriodUs, 1000000);
+
+// a fresh oversampled pedal block for every control cycle
+constexpr PedalAcquisition::Config kPedalSampling{4000, kControlPeriodUs >= 2000 ? 8 : 4,
+                                                  1000000};
+
+// CAN I/O runs on the core loop() doesn't (ARDUINO_RUNNING_CORE, 1), above the idle task
+constexpr BaseType_t kBusTaskCore = 0;
+constexpr uint32_t kBusTaskStackBytes = 4096;
+constexpr UBaseType_t kBusTaskPriority = 2;
+TaskHandle_t bus_task_handle = nullptr;
+
+// formatting and the UART wait on the same core, below CAN I/O: the log task only gets the time
+// the others leave
+constexpr BaseType_t kLogTaskCore = 0;
+constexpr uint32_t kLogTaskStackBytes = 4096;
+constexpr UBaseType_t kLogTaskPriority = 1;
+constexpr TickType_t kLogDrainPeriodTicks = pdMS_TO_TICKS(20);
+
 // instantiate throttle/brake
 ThrottleBrake throttle_brake{drive_bus, timers, APPSs_disagree_timer, brake_implausible_timer,
                              APPSs_invalid_timer};
 
 // instantiate inverter
-Inverter inverter{drive_bus, timers, throttle_brake};
+Inverter inverter{drive_bus, timers, throttle_brake, kCommandTimeoutUs};
 
 ActiveAero active_aero{drive_bus, timers};
 
 Lookup lookup{drive_bus, timers};
 
+// uploaded tables survive power cycles here
+LUTStore lut_store{"lut_bank", static_cast<uint8_t>(Lookup::TableID::kCount),
+                   static_cast<uint8_t>(Lookup::DriveProfile::kCount)};
+
+Lookup::ThermalFrame thermal_frame{};
+Lookup::StatusCAN lookup_status{};
+
+#ifdef ECU_PROFILING
+ProfilerCan profiler_can{drive_bus, timers};
+#endif
+
 void fsm_init() {
   Serial.begin(115200);
 
@@ -44,50 +102,218 @@ void fsm_init() {
   // initialize inverter class
   inverter.initialize();
 
-  // initialize throttle/brake class -- should set up SPI transaction and set pinModes
-  throttle_brake.initialize();
+  // initialize throttle/brake class -- starts the background pedal ADC sampling and sets pinModes
+  throttle_brake.initialize(kPedalSampling);
 
   // register BMS msg
   drive_bus.RegisterRXMessage(BMS_Status);
 
-  timers.AddTimer(10, update);
+  // uploaded tables from the last session, before the first control tick
+  lookup.load_calibration(lut_store);
 
-  // timer for print debugging msgs
-
-  timers.AddTimer(1000, print_fsm);
+  executive.add_task("implausibility_timers", kImplausibilityTimerPeriodUs, tick_timers);
+  // sense -> torque -> command
+  // the pedal -> torque command path must be done early in its period, not just within it
+  executive.add_task("control", kControlPeriodUs, update, kControlBudgetUs);
+  // derating, pump / fan duty, aero
+  executive.add_task("thermal", kThermalPeriodUs, update_thermal);
+  executive.add_task("status", kStatusPeriodUs, update_status);
+  // print debugging msgs
+  executive.add_task("print", kPrintPeriodUs, print_fsm);
 
   // initialize state variables
   tsactive_switch = TSActive::Inactive;
   ready_to_drive = Ready_To_Drive_State::Neutral;
   ready_to_drive_switch = Ready_To_Drive_State::Neutral;
-  Drive_State = State::OFF;
+  drive_state = State::OFF;
+  bms_command = BMSCommand::Shutdown;
 
   // initialize dash switches
   initialize_dash_switches();
+
+  // CAN LUT uploads are assembled and built on the CAN I/O core, off the control tick, and
+  // swapped in atomically
+  timers.AddTimer(100, update_CAN_LUTs);
+#ifdef ECU_PROFILING
+  timers.AddTimer(100, update_profiler_CAN);
+#endif
+  xTaskCreatePinnedToCore(log_task, "log", kLogTaskStackBytes, nullptr, kLogTaskPriority, nullptr,
+                          kLogTaskCore);
+#ifndef ECU_WCET_HARNESS
+  // the harness feeds the control side itself
+  xTaskCreatePinnedToCore(bus_task, "can_io", kBusTaskStackBytes, nullptr, kBusTaskPriority,
+                          &bus_task_handle, kBusTaskCore);
+#endif
+
+  executive.start();
+}
+
+// CAN I/O task: the only code touching drive_bus, CAN signals and the TX timers
+void bus_task(void*) {
+  for (;;) {
+    service_bus();
+    // woken right away by a new command from update(), otherwise serviced every tick
+    ulTaskNotifyTake(pdTRUE, 1);
+  }
+}
+
+// log task: the only Serial output after fsm_init(), apart from the WCET harness at boot
+void log_task(void*) {
+  static char line[192];
+  uint32_t reported_overruns = 0;
+#ifdef ECU_PROFILING
+  static char profile_report[1024];
+  TickType_t last_report = xTaskGetTickCount();
+#endif
+  for (;;) {
+    LogRecord record;
+    while (event_log.pop(record)) {
+      EventLog::format(record, line, sizeof(line));
+      Serial.println(line);
+    }
+    uint32_t overruns = event_log.overruns();
+    if (overruns != reported_overruns) {
+      reported_overruns = overruns;
+      Serial.print("log overruns: ");
+      Serial.println(overruns);
+    }
+#ifdef ECU_PROFILING
+    if (xTaskGetTickCount() - last_report >= pdMS_TO_TICKS(1000)) {
+      last_report = xTaskGetTickCount();
+      stage_profiler.write_report(profile_report, sizeof(profile_report));
+      Serial.print(profile_report);
+    }
+#endif
+    vTaskDelay(kLogDrainPeriodTicks);
+  }
 }
 
+void service_bus() {
+  const BusOutputs& outputs = control_to_bus.latest();
+  // every control cycle's torque request goes out as soon as the cycle is done, not on the next
+  // tick of a TX timer: two 4 byte frames per cycle, at 1 kHz about a third of the 500 kbit/s bus.
+  // A stalled control core stops the new requests, the inverter then gets zero torque
+  if (inverter.send_inverter_CAN(outputs.sequence, outputs.torque_reqs, outputs.sample_timestamp_us,
+                                 micros()) == TorqueTXSchedule::Send::kCommand) {
+    uint32_t latency = inverter.get_tx_stats().last_latency_us;
+    pedal_to_command_us.store(latency, std::memory_order_relaxed);
+    if (latency > max_pedal_to_command_us.load(std::memory_order_relaxed)) {
+      max_pedal_to_command_us.store(latency, std::memory_order_relaxed);
+    }
+  }
+  Drive_State = outputs.drive_state;
+  BMS_Command = outputs.bms_command;
+  Pump_Duty_Cycle = outputs.pump_duty_cycle;
+  Fan_Duty_Cycle = outputs.fan_duty_cycle;
+  throttle_brake.update_throttle_brake_CAN_signals(outputs.throttle_brake);
+  active_aero.update_can(outputs.aero);
+  lookup.update_status_CAN(outputs.lookup_status);
+
+  // the CAN TX timers
+  timers.Tick(millis());
+  {
+    PROFILE_STAGE(kBusTick);
+    drive_bus.Tick();
+  }
+
+  BusInputs inputs;
+  inputs.bms_state = BMS_State;
+  inputs.external_kill_fault = External_Kill_Fault;
+  inputs.battery_temperature = Battery_Temperature;
+  inputs.before_motor_temperature = Before_Motor_Temperature;
+  inputs.wheel_speeds[0] = FL_Speed;
+  inputs.wheel_speeds[1] = FR_Speed;
+  inputs.wheel_speeds[2] = BL_Speed;
+  inputs.wheel_speeds[3] = BR_Speed;
+  {
+    PROFILE_STAGE(kReadInverterCAN);
+    inputs.inverter = inverter.read_inverter_CAN();
+  }
+  inputs.aero_enabled = active_aero.read_can();
+  bus_to_control.publish(inputs);
+}
+
+// sense stage: the newest pedal ADC block and the newest bus inputs, one snapshot
+void sample_vehicle() {
+  ThrottleBrake::PedalSample pedals;
+  {
+    PROFILE_STAGE(kUpdateSensorValues);
+    pedals = throttle_brake.update_sensor_values();
+  }
+  take_vehicle_snapshot(vehicle, pedals, bus_to_control);
+  inverter.update_readings(vehicle.bus.inverter);
+}
+
+// control task: snapshot in, commands out to the CAN I/O task. Uses the thermal frame of the
+// previous pass
 void update() {
+  PROFILE_STAGE(kControlCycle);
+  sample_vehicle();
+  {
+    PROFILE_STAGE(kCheckImplausibilities);
+    throttle_brake.check_for_implausibilities();
+  }
+
+  // one calibration for the whole cycle, a profile switch lands on the next one
+  lookup.begin_control_cycle();
   process_state();
   change_state();
+  lookup.end_control_cycle();
+
+  BusOutputs outputs;
+  outputs.sequence = vehicle.sequence;
+  outputs.sample_timestamp_us = vehicle.timestamp_us;
+  outputs.drive_state = drive_state;
+  outputs.bms_command = bms_command;
+  outputs.torque_reqs = inverter.get_torque_reqs();
+  outputs.pump_duty_cycle = thermal_frame.pump_duty_cycle;
+  outputs.fan_duty_cycle = thermal_frame.fan_duty_cycle;
+  outputs.throttle_brake = throttle_brake.get_CAN_values();
+  outputs.aero = active_aero.get_command();
+  outputs.lookup_status = lookup_status;
+  control_to_bus.publish(outputs);
+  if (bus_task_handle != nullptr) {
+    xTaskNotifyGive(bus_task_handle);
+  }
+}
 
-  inverter.read_inverter_CAN();
-  inverter.send_inverter_CAN();
-
-  throttle_brake.update_sensor_values();
-  throttle_brake.check_for_implausibilities();
-  throttle_brake.update_throttle_brake_CAN_signals();
+void update_thermal() {
+  {
+    PROFILE_STAGE(kThermalLookup);
+    thermal_frame = lookup.calculate_thermal_frame(
+        vehicle.bus.inverter.motor_temp, vehicle.bus.inverter.IGBT_temp,
+        vehicle.bus.battery_temperature, vehicle.bus.before_motor_temperature);
+  }
 
   active_aero.update_active_aero(inverter.get_set_current(),
                                  static_cast<float>(Lookup::TorqueReqLimit::kAccelMax),
-                                 throttle_brake.is_brake_pressed());
-
-  Pump_Duty_Cycle = lookup.calculate_pump_duty_cycle(inverter.get_motor_temp(),
-                                                     inverter.get_IGBT_temp(), Battery_Temperature);
-  Fan_Duty_Cycle = lookup.calculate_fan_duty_cycle(Before_Motor_Temperature);
+                                 vehicle.pedals.brake_pressed, vehicle.bus.aero_enabled);
+}
 
-  // lookup.updateCANLUTs();
-  lookup.update_status_CAN();
-  drive_bus.Tick();
+// the CAN I/O task writes the status signals from the next BusOutputs
+void update_status() { lookup_status = lookup.get_status_CAN(); }
+
+#ifdef ECU_PROFILING
+// CAN I/O task
+void update_profiler_CAN() { profiler_can.update(stage_profiler); }
+#endif
+
+// CAN I/O task. A save erases and programs a whole slot: 6 sectors for the ~21.6 KB image, around
+// 0.3 s typical and a few seconds worst case on the flash parts we use, with the cache (and so
+// both cores) stalled throughout. It only runs once the control task has granted it, in OFF with TS
+// inactive, and the car is held in OFF until it is done
+void update_CAN_LUTs() {
+  lookup.updateCANLUTs();
+  if (!lookup.has_unsaved_calibration()) {
+    return;
+  }
+  CalibrationSave expected = CalibrationSave::kIdle;
+  if (calibration_save.compare_exchange_strong(expected, CalibrationSave::kRequested) ||
+      expected == CalibrationSave::kRequested) {
+    return;  // granted on a later tick, or once the car is back in OFF
+  }
+  lookup.save_calibration(lut_store);
+  calibration_save.store(CalibrationSave::kIdle);
 }
 
 // wrapper for APPSs disagreement timer function
@@ -117,7 +343,7 @@ void ready_to_drive_callback() {
 
   // if the ready to drive switch is flipped and the brake is pressed, set ready_to_drive to drive
   if (digitalRead(static_cast<uint8_t>(Pins::READY_TO_DRIVE_SWITCH)) == LOW &&
-      throttle_brake.is_brake_pressed()) {
+      vehicle.pedals.brake_pressed) {
     test_ready_to_drive_switch_interrupt = 0;
     ready_to_drive = Ready_To_Drive_State::Drive;
   } else {
@@ -130,14 +356,14 @@ void ready_to_drive_callback() {
 // currently, the switch is active low
 void tsactive_callback() {
   if (digitalRead((uint8_t)Pins::TS_ACTIVE_PIN) == LOW &&
-      External_Kill_Fault == BMSFault::kNoExtFault) {
+      vehicle.bus.external_kill_fault == BMSFault::kNoExtFault) {
     test_ts_active_switch_interrupt = 0;
     tsactive_switch = TSActive::Active;
-    BMS_Command = BMSCommand::PrechargeAndCloseContactors;
+    bms_command = BMSCommand::PrechargeAndCloseContactors;
   } else {
     test_ts_active_switch_interrupt = 1;
     tsactive_switch = TSActive::Inactive;
-    BMS_Command = BMSCommand::Shutdown;
+    bms_command = BMSCommand::Shutdown;
   }
 }
 
@@ -153,44 +379,60 @@ void initialize_dash_switches() {
                   tsactive_callback, CHANGE);
 }
 
+// OFF only: grants a requested calibration save while TS is inactive, true (stay in OFF) from then
+// until the save is done. With TS active the request waits and OFF is left as usual
+bool hold_off_for_calibration_save() {
+  CalibrationSave save = calibration_save.load();
+  if (save == CalibrationSave::kRequested && tsactive_switch == TSActive::Inactive) {
+    // only the control task grants, only the CAN I/O task sets it back to kIdle
+    calibration_save.store(CalibrationSave::kGranted);
+    return true;
+  }
+  return save == CalibrationSave::kGranted;
+}
+
 // this function will be used to change the state of the vehicle based on the current state and the
 // state of the switches
 void change_state() {
-  switch (Drive_State) {
+  PROFILE_STAGE(kChangeState);
+  switch (drive_state) {
     case State::OFF:
-      if (tsactive_switch == TSActive::Active && BMS_State == BMSState::kActive &&
-          External_Kill_Fault == BMSFault::kNoExtFault) {
-        Serial.println("transition from OFF->N");
-        Drive_State = State::N;
+      if (hold_off_for_calibration_save()) {
+        break;
+      }
+      if (tsactive_switch == TSActive::Active && vehicle.bus.bms_state == BMSState::kActive &&
+          vehicle.bus.external_kill_fault == BMSFault::kNoExtFault) {
+        event_log.log(LogEvent::kTransitionOffToN);
+        drive_state = State::N;
       }
       break;
 
     case State::N:
       if (ready_to_drive == Ready_To_Drive_State::Drive &&
-          External_Kill_Fault == BMSFault::kNoExtFault) {
-        Serial.println("transition from N->DRIVE");
-        Drive_State = State::DRIVE;
+          vehicle.bus.external_kill_fault == BMSFault::kNoExtFault) {
+        event_log.log(LogEvent::kTransitionNToDrive);
+        drive_state = State::DRIVE;
       }
-      if (tsactive_switch == TSActive::Inactive || BMS_State == BMSState::kFault ||
-          External_Kill_Fault == BMSFault::kExtFault) {
-        Serial.println("transition from N->OFF");
+      if (tsactive_switch == TSActive::Inactive || vehicle.bus.bms_state == BMSState::kFault ||
+          vehicle.bus.external_kill_fault == BMSFault::kExtFault) {
+        event_log.log(LogEvent::kTransitionNToOff);
         tsactive_switch = TSActive::Inactive;
-        BMS_Command = BMSCommand::Shutdown;
-        Drive_State = State::OFF;
+        bms_command = BMSCommand::Shutdown;
+        drive_state = State::OFF;
       }
       break;
 
     case State::DRIVE:
       if (ready_to_drive == Ready_To_Drive_State::Neutral) {
-        Serial.println("transition from DRIVE->N");
-        Drive_State = State::N;
+        event_log.log(LogEvent::kTransitionDriveToN);
+        drive_state = State::N;
       }
-      if (tsactive_switch == TSActive::Inactive || BMS_State == BMSState::kFault ||
-          External_Kill_Fault == BMSFault::kExtFault) {
-        Serial.println("transition from DRIVE->OFF");
+      if (tsactive_switch == TSActive::Inactive || vehicle.bus.bms_state == BMSState::kFault ||
+          vehicle.bus.external_kill_fault == BMSFault::kExtFault) {
+        event_log.log(LogEvent::kTransitionDriveToOff);
         tsactive_switch = TSActive::Inactive;
-        BMS_Command = BMSCommand::Shutdown;
-        Drive_State = State::OFF;
+        bms_command = BMSCommand::Shutdown;
+        drive_state = State::OFF;
       }
       break;
   }
@@ -198,20 +440,20 @@ void change_state() {
 
 // this function will be used to calculate torque based on LUTs and traction control when its time
 void process_state() {
-  throttle_brake.update_sensor_values();
-  switch (Drive_State) {
+  PROFILE_STAGE(kProcessState);
+  switch (drive_state) {
     case State::OFF:
       if (tsactive_switch == TSActive::Active) {
-        BMS_Command = BMSCommand::PrechargeAndCloseContactors;
+        bms_command = BMSCommand::PrechargeAndCloseContactors;
       } else {
-        BMS_Command = BMSCommand::Shutdown;
+        bms_command = BMSCommand::Shutdown;
       }
       ready_to_drive = Ready_To_Drive_State::Neutral;
       // BMS_Command = BMSCommand::Shutdown;
       inverter.request_torque({0, 0});
       break;
     case State::N:
-      BMS_Command =
+      bms_command =
           BMSCommand::PrechargeAndCloseContactors;  // maybe make prechargeandclosecontactors or
                                                     // NoAction here
       inverter.request_torque({0, 0});
@@ -221,33 +463,19 @@ void process_state() {
       if (throttle_brake.is_implausibility_present()) {
         torque_reqs = {0, 0};
       } else {
-        std::pair<float, float> torque_mods = lookup.get_torque_mods(
-            throttle_brake.get_throttle(), static_cast<int16_t>(Bounds::SENSOR_SCALED_MAX),
-            inverter.get_motor_rpm(), throttle_brake.is_brake_pressed());
-
-        float temp_mod = lookup.calculate_temp_mod(inverter.get_IGBT_temp(), Battery_Temperature,
-                                                   inverter.get_motor_temp());
-
-        torque_reqs = lookup.calculate_torque_reqs(inverter.get_motor_rpm(), temp_mod, torque_mods);
+        PROFILE_STAGE(kTorqueLookup);
+        // float or integer-only pipeline, picked at compile time (LUT_FIXED_POINT)
+        torque_reqs = lookup.get_torque_reqs(
+            vehicle.pedals.APPS1_throttle_scaled, static_cast<int16_t>(Bounds::SENSOR_SCALED_MAX),
+            vehicle.bus.inverter.motor_rpm, vehicle.pedals.brake_pressed, thermal_frame);
       }
       inverter.request_torque(torque_reqs);
       break;
   }
 }
 
+// logs the status as records, the log task formats and prints them off the control core
 void print_fsm() {
-  Serial.print("Drive State: ");
-  switch (Drive_State) {
-    case State::OFF:
-      Serial.print("OFF");
-      break;
-    case State::N:
-      Serial.print("N");
-      break;
-    case State::DRIVE:
-      Serial.print("DRIVE");
-      break;
-  }
   // Serial.print("Ready to Drive: ");
   // Serial.println(static_cast<int>(ready_to_drive));
   // Serial.print("TS Active: ");
@@ -256,45 +484,39 @@ void print_fsm() {
   // Serial.println(static_cast<int>(BMS_State));
   // Serial.print("BMS Command: ");
   // Serial.println(static_cast<int>(BMS_Command));
-  Serial.print(" TS active switch: ");
-  Serial.print(static_cast<int>(tsactive_switch));
-  Serial.print(" brake_pressed: ");
-  Serial.print(throttle_brake.is_brake_pressed());
-  Serial.print(" Ready to Drive: ");
-  Serial.print(static_cast<int>(ready_to_drive));
-  Serial.print(" Ready to Drive Switch: ");
-  Serial.print(static_cast<int>(ready_to_drive_switch));
+  event_log.log(LogEvent::kStatusSwitches, drive_state, tsactive_switch,
+                vehicle.pedals.brake_pressed, ready_to_drive, ready_to_drive_switch);
+  // control cycle time and how old the pedal sample is once its torque reaches the CAN signals
+  const CyclicExecutive::TaskStats* control = executive.stats("control");
+  event_log.log(LogEvent::kStatusTiming, control->last_exec_us, control->max_exec_us,
+                pedal_to_command_us.load(std::memory_order_relaxed),
+                max_pedal_to_command_us.load(std::memory_order_relaxed),
+                throttle_brake.get_acquisition_stats().overruns);
   // Serial.print(" Thrtl: ");
   // Serial.print(throttle_brake.get_throttle() / 4);
   throttle_brake.print_throttle_info();
 
   // inverter.print_inverter_info();
-  Serial.print(" test tsactive: ");
-  Serial.print(test_ts_active_switch_interrupt);
-  Serial.print(" test ready to drive: ");
-  Serial.print(test_ready_to_drive_switch_interrupt);
-
-  // inverter.print_inverter_info();
+  event_log.log(LogEvent::kStatusInterrupts, test_ts_active_switch_interrupt,
+                test_ready_to_drive_switch_interrupt);
 
   // Serial.print("BMS msg: ");
   // Serial.println(static_cast<int>(BMS_State));
-
-  Serial.println("");
 }
 
 void print_all() {
   print_fsm();
   inverter.print_inverter_info();
   throttle_brake.print_throttle_info();
-  Serial.println("");
 }
 
+// the implausibility timers tick here, on the control core. The CAN TX timers tick in
+// service_bus(), on the CAN I/O task
 void tick_timers() {
-  // Serial.println("tick timers");
-  APPSs_disagree_timer.Tick(millis());
-  brake_implausible_timer.Tick(millis());
-  APPSs_invalid_timer.Tick(millis());
-  timers.Tick(millis());
+  uint32_t now = millis();
+  APPSs_disagree_timer.Tick(now);
+  brake_implausible_timer.Tick(now);
+  APPSs_invalid_timer.Tick(now);
 }
 // implausibility timer definitions
 VirtualTimer APPSs_disagree_timer(
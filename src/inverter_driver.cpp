@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 
+#include "event_log.hpp"
 #include "pins.hpp"
 #include "throttle_brake_driver.hpp"
 
@@ -45,24 +46,70 @@ int16_t Inverter::get_motor_temp() const { return Inverter::motor_temp; }
  */
 int32_t Inverter::get_set_current() const { return Inverter::requested_torque_throttle; }
 /**
- * @brief Read CAN messages from Inverter and set class variables accordingly
+ * @brief Read CAN messages from Inverter, on the core that services the bus
  *
- * @return void
+ * @return Readings
  */
-void Inverter::read_inverter_CAN() {
-  Inverter::motor_rpm = Inverter::RPM;
-  Inverter::IGBT_temp = Inverter::IGBT_Temp;
-  Inverter::motor_temp = Inverter::Motor_Temp;
+Inverter::Readings Inverter::read_inverter_CAN() const {
+  Readings readings;
+  readings.motor_rpm = Inverter::RPM;
+  readings.IGBT_temp = Inverter::IGBT_Temp;
+  readings.motor_temp = Inverter::Motor_Temp;
+  return readings;
 }
 
 /**
- * @brief Send CAN messages to Inverter (set_current and set_current_brake)
+ * @brief Set class variables from readings taken by read_inverter_CAN()
  *
  * @return void
  */
-void Inverter::send_inverter_CAN() {
-  Inverter::Set_Current = Inverter::requested_torque_throttle;
-  Inverter::Set_Current_Brake = Inverter::requested_torque_brake;
+void Inverter::update_readings(const Readings& readings) {
+  Inverter::motor_rpm = readings.motor_rpm;
+  Inverter::IGBT_temp = readings.IGBT_temp;
+  Inverter::motor_temp = readings.motor_temp;
+}
+
+/**
+ * @brief Put the control task's newest torque request on the bus: at once when it is new, again
+ *        every kTorqueFallbackPeriodUs, zero once the requests stop or go stale. Call on every
+ *        pass of the bus task, on the core that services it
+ * @param sequence -- the control cycle that computed the request
+ * @param torque_reqs -- <accel, regen> torque in milliAmps
+ * @param sample_timestamp_us -- when the pedal sample it was computed from was taken
+ * @param now_us
+ * @return TorqueTXSchedule::Send -- what was sent
+ */
+TorqueTXSchedule::Send Inverter::send_inverter_CAN(uint32_t sequence,
+                                                   std::pair<int32_t, int32_t> torque_reqs,
+                                                   uint32_t sample_timestamp_us, uint32_t now_us) {
+  TorqueTXSchedule::Send send = Inverter::torque_tx.next(sequence, sample_timestamp_us, now_us);
+  switch (send) {
+    case TorqueTXSchedule::Send::kCommand:
+      Inverter::Set_Current = torque_reqs.first;
+      Inverter::Set_Current_Brake = torque_reqs.second;
+      break;
+    case TorqueTXSchedule::Send::kZero:
+      Inverter::Set_Current = 0;
+      Inverter::Set_Current_Brake = 0;
+      break;
+    case TorqueTXSchedule::Send::kResend:
+      break;
+    case TorqueTXSchedule::Send::kNone:
+    default:
+      return send;
+  }
+  Inverter::ECU_Set_Current.EncodeAndSend();
+  Inverter::ECU_Set_Current_Brake.EncodeAndSend();
+  return send;
+}
+
+/**
+ * @brief Torque request sends and pedal sample -> CAN latency
+ *
+ * @return const TorqueTXSchedule::Stats&
+ */
+const TorqueTXSchedule::Stats& Inverter::get_tx_stats() const {
+  return Inverter::torque_tx.get_stats();
 }
 
 /**
@@ -75,11 +122,18 @@ void Inverter::request_torque(std::pair<int32_t, int32_t> torque_reqs) {
   Inverter::requested_torque_brake = torque_reqs.second;
 }
 
+/**
+ * @brief Last requested torque
+ *
+ * @return std::pair<int32_t, int32_t> -- <accel, regen> torque in milliAmps
+ */
+std::pair<int32_t, int32_t> Inverter::get_torque_reqs() const {
+  return {Inverter::requested_torque_throttle, Inverter::requested_torque_brake};
+}
+
 void Inverter::print_inverter_info() {
-  Serial.print(" Set_Cur: ");
-  Serial.print(Inverter::requested_torque_throttle);
-  Serial.print(" Set_Cur_Br: ");
-  Serial.print(Inverter::requested_torque_brake);
+  event_log.log(LogEvent::kInverterInfo, Inverter::requested_torque_throttle,
+                Inverter::requested_torque_brake);
 
   // Serial.print(" RPM: ");
   // Serial.print(Inverter::motor_rpm);
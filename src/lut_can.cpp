@@ -2,96 +2,42 @@
 
 void LUTCan::setLUTIDResponse(uint8_t id) { accel_lut_id_response = id; }
 
-RXLUT LUTCan::processCAN() {
-  std::vector<int16_t> xPairs;
-  std::vector<float> yPairs;
+void LUTCan::set_profile_response(uint8_t profile) { active_profile_response = profile; }
 
-  // add x values to vector
-  xPairs.push_back(static_cast<int16_t>(this->x_zero));
-  xPairs.push_back(static_cast<int16_t>(this->x_one));
-  xPairs.push_back(static_cast<int16_t>(this->x_two));
-  xPairs.push_back(static_cast<int16_t>(this->x_three));
-  xPairs.push_back(static_cast<int16_t>(this->x_four));
-  xPairs.push_back(static_cast<int16_t>(this->x_five));
-  xPairs.push_back(static_cast<int16_t>(this->x_six));
-  xPairs.push_back(static_cast<int16_t>(this->x_seven));
-  xPairs.push_back(static_cast<int16_t>(this->x_eight));
-  xPairs.push_back(static_cast<int16_t>(this->x_nine));
-  xPairs.push_back(static_cast<int16_t>(this->x_ten));
-  xPairs.push_back(static_cast<int16_t>(this->x_eleven));
-  xPairs.push_back(static_cast<int16_t>(this->x_twelve));
-  xPairs.push_back(static_cast<int16_t>(this->x_thirteen));
-  xPairs.push_back(static_cast<int16_t>(this->x_fourteen));
-  xPairs.push_back(static_cast<int16_t>(this->x_fifteen));
-  xPairs.push_back(static_cast<int16_t>(this->x_sixteen));
-  xPairs.push_back(static_cast<int16_t>(this->x_seventeen));
-  xPairs.push_back(static_cast<int16_t>(this->x_eighteen));
-  xPairs.push_back(static_cast<int16_t>(this->x_nineteen));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty_one));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty_two));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty_three));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty_four));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty_five));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty_six));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty_seven));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty_eight));
-  xPairs.push_back(static_cast<int16_t>(this->x_twenty_nine));
+bool LUTCan::take_profile_request(uint8_t& profile) {
+  if (requested_profile == kNoProfileRequest) {
+    return false;
+  }
+  profile = requested_profile;
+  requested_profile = kNoProfileRequest;
+  return true;
+}
 
-  // Add y values to vector
-  yPairs.push_back(this->y_zero);
-  yPairs.push_back(this->y_one);
-  yPairs.push_back(this->y_two);
-  yPairs.push_back(this->y_three);
-  yPairs.push_back(this->y_four);
-  yPairs.push_back(this->y_five);
-  yPairs.push_back(this->y_six);
-  yPairs.push_back(this->y_seven);
-  yPairs.push_back(this->y_eight);
-  yPairs.push_back(this->y_nine);
-  yPairs.push_back(this->y_ten);
-  yPairs.push_back(this->y_eleven);
-  yPairs.push_back(this->y_twelve);
-  yPairs.push_back(this->y_thirteen);
-  yPairs.push_back(this->y_fourteen);
-  yPairs.push_back(this->y_fifteen);
-  yPairs.push_back(this->y_sixteen);
-  yPairs.push_back(this->y_seventeen);
-  yPairs.push_back(this->y_eighteen);
-  yPairs.push_back(this->y_nineteen);
-  yPairs.push_back(this->y_twenty);
-  yPairs.push_back(this->y_twenty_one);
-  yPairs.push_back(this->y_twenty_two);
-  yPairs.push_back(this->y_twenty_three);
-  yPairs.push_back(this->y_twenty_four);
-  yPairs.push_back(this->y_twenty_five);
-  yPairs.push_back(this->y_twenty_six);
-  yPairs.push_back(this->y_twenty_seven);
-  yPairs.push_back(this->y_twenty_eight);
-  yPairs.push_back(this->y_twenty_nine);
+void LUTCan::set_upload_response(uint8_t table, uint8_t id, uint8_t result) {
+  upload_table_response = table;
+  upload_lut_id_response = id;
+  upload_result_response = result;
+}
 
-  RXLUT lut;
-  lut.fileStatus = static_cast<FileStatus>(static_cast<uint8_t>(this->file_status));
-  lut.interpType = static_cast<InterpType>(static_cast<uint8_t>(this->interp_type));
-  lut.LUTId = static_cast<uint8_t>(this->lut_id);
-  lut.numPairs = static_cast<uint8_t>(this->num_lut_pairs);
-  std::map<int16_t, float> m;
-  for (int i = 0; i < lut.numPairs; i++) {
-    m.insert({xPairs.at(i), yPairs.at(i)});
-  }
-  // Serial.print("lut xpair 5: ");
-  // Serial.println(xPairs.at(5));
-  // Serial.print("lut ypair 5: ");
-  // Serial.println(yPairs.at(5));
-  // Serial.print("lut id: ");
-  // Serial.println(lut.LUTId);
-  // Serial.print("lut num pairs: ");
-  // Serial.println(lut.numPairs);
-  // Serial.print("lut file status: ");
-  // Serial.println(static_cast<uint8_t>(lut.fileStatus));
-  // Serial.print("lut interp type: ");
-  // Serial.println(static_cast<uint8_t>(lut.interpType));
+void LUTCan::on_header_frame() {
+  LUTUploadHeader header;
+  header.table = header_table;
+  header.sequence = header_sequence;
+  header.file_status = static_cast<FileStatus>(static_cast<uint8_t>(file_status));
+  header.interp_type = static_cast<InterpType>(static_cast<uint8_t>(interp_type));
+  header.num_pairs = num_lut_pairs;
+  header.lut_id = lut_id;
+  header.payload_length = payload_length;
+  header.crc = upload_crc;
+  receiver.on_header(header);
+}
 
-  lut.lut = m;
-  return lut;
-};
\ No newline at end of file
+void LUTCan::on_segment_frame() {
+  // frame bytes 2 - 7, little endian like every signal on the bus
+  uint64_t payload = segment_payload;
+  uint8_t data[LUTUploadReceiver::kSegmentBytes];
+  for (size_t i = 0; i < LUTUploadReceiver::kSegmentBytes; i++) {
+    data[i] = static_cast<uint8_t>(payload >> (8 * i));
+  }
+  receiver.on_segment(segment_table, segment_sequence, segment_index, data);
+}
@@ -0,0 +1,204 @@
+#include "lut_store.hpp"
+
+#include <cstddef>
+#include <cstring>
+#ifndef ESP32
+#include <cstdio>
+#endif
+
+namespace {
+
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return crc;
+}
+
+// the bytes that go to flash: a table's cubic pointer only means something in the RAM it came from
+StoredLUT unbound(const StoredLUT& stored) {
+  StoredLUT entry;
+  std::memcpy(&entry, &stored, sizeof(StoredLUT));
+  entry.lut.unbind_cubics();
+  return entry;
+}
+
+}  // namespace
+
+uint32_t LUTStore::crc32(const LUTStoreHeader& header, const StoredLUT* luts) {
+  uint32_t crc = 0xFFFFFFFFu;
+  crc = crc32_update(crc, &header, offsetof(LUTStoreHeader, crc));
+  crc = crc32_update(crc, luts, header.num_luts * sizeof(StoredLUT));
+  return crc ^ 0xFFFFFFFFu;
+}
+
+bool LUTStore::is_valid(const LUTStoreImage& image) const {
+  const LUTStoreHeader& header = image.header;
+  if (header.magic != kMagic || header.version != kVersion ||
+      header.entry_size != sizeof(StoredLUT) || header.num_luts > kMaxStoredLUTs) {
+    return false;
+  }
+  if (crc32(header, image.luts) != header.crc) {
+    return false;
+  }
+  for (size_t i = 0; i < header.num_luts; i++) {
+    // out of range IDs are rejected here, not left for the loader to skip
+    const StoredLUT& stored = image.luts[i];
+    if (stored.table >= num_tables || stored.profile >= num_profiles || !stored.lut.is_valid()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const LUTStoreImage* LUTStore::load() {
+  const LUTStoreImage* newest = nullptr;
+  newest_slot = -1;
+  newest_sequence = 0;
+  for (size_t slot = 0; slot < kNumSlots; slot++) {
+    const LUTStoreImage* image = read_slot(slot);
+    if (image == nullptr || !is_valid(*image)) {
+      continue;
+    }
+    if (newest == nullptr || image->header.sequence > newest_sequence) {
+      newest = image;
+      newest_slot = static_cast<int>(slot);
+      newest_sequence = image->header.sequence;
+    }
+  }
+  return newest;
+}
+
+bool LUTStore::save(const StoredLUT* const* luts, size_t n) {
+  if (n > kMaxStoredLUTs) {
+    return false;
+  }
+  // the newest image may have changed on disk / in flash since the last call
+  load();
+
+  LUTStoreHeader header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.entry_size = sizeof(StoredLUT);
+  header.sequence = newest_sequence + 1;
+  header.num_luts = static_cast<uint8_t>(n);
+  uint32_t crc = crc32_update(0xFFFFFFFFu, &header, offsetof(LUTStoreHeader, crc));
+  for (size_t i = 0; i < n; i++) {
+    StoredLUT entry = unbound(*luts[i]);
+    crc = crc32_update(crc, &entry, sizeof(StoredLUT));
+  }
+  header.crc = crc ^ 0xFFFFFFFFu;
+
+  size_t slot = newest_slot == 0 ? 1 : 0;
+  if (!write_slot(slot, header, luts)) {
+    return false;
+  }
+  newest_slot = static_cast<int>(slot);
+  newest_sequence = header.sequence;
+  return true;
+}
+
+#ifdef ESP32
+
+bool LUTStore::map_partition() {
+  if (mapping != nullptr) {
+    return true;
+  }
+  if (partition == nullptr) {
+    partition =
+        esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, location);
+    if (partition == nullptr || partition->size < kNumSlots * kSlotSize) {
+      partition = nullptr;
+      return false;
+    }
+  }
+  return esp_partition_mmap(partition, 0, kNumSlots * kSlotSize, SPI_FLASH_MMAP_DATA, &mapping,
+                            &mapping_handle) == ESP_OK;
+}
+
+void LUTStore::unmap_partition() {
+  if (mapping != nullptr) {
+    spi_flash_munmap(mapping_handle);
+    mapping = nullptr;
+  }
+}
+
+const LUTStoreImage* LUTStore::read_slot(size_t slot) {
+  if (!map_partition()) {
+    return nullptr;
+  }
+  return reinterpret_cast<const LUTStoreImage*>(static_cast<const uint8_t*>(mapping) +
+                                                slot * kSlotSize);
+}
+
+/**
+ * @brief Erase the slot's sectors, then write the tables and the header. The cache is off for
+ *        every erase and write, stalling both cores: for the ~21.6 KB image that is 6 sector
+ *        erases and ~85 page programs, around 0.3 s typical and seconds worst case. Only call it
+ *        with the car held in OFF (see update_CAN_LUTs()). luts must be in RAM.
+ */
+bool LUTStore::write_slot(size_t slot, const LUTStoreHeader& header,
+                          const StoredLUT* const* luts) {
+  if (!map_partition()) {
+    return false;
+  }
+  // load() pointers into the old contents end here
+  unmap_partition();
+  size_t offset = slot * kSlotSize;
+  if (esp_partition_erase_range(partition, offset, kSlotSize) != ESP_OK) {
+    return false;
+  }
+  for (size_t i = 0; i < header.num_luts; i++) {
+    size_t address = offset + offsetof(LUTStoreImage, luts) + i * sizeof(StoredLUT);
+    StoredLUT entry = unbound(*luts[i]);
+    if (esp_partition_write(partition, address, &entry, sizeof(StoredLUT)) != ESP_OK) {
+      return false;
+    }
+  }
+  return esp_partition_write(partition, offset, &header, sizeof(header)) == ESP_OK;
+}
+
+#else
+
+// the whole slot is read into a buffer, the native stand-in for the flash mapping
+const LUTStoreImage* LUTStore::read_slot(size_t slot) {
+  FILE* file = std::fopen(location, "rb");
+  if (file == nullptr) {
+    return nullptr;
+  }
+  bool read = std::fseek(file, static_cast<long>(slot * kSlotSize), SEEK_SET) == 0 &&
+              std::fread(&slots[slot], sizeof(LUTStoreImage), 1, file) == 1;
+  std::fclose(file);
+  return read ? &slots[slot] : nullptr;
+}
+
+bool LUTStore::write_slot(size_t slot, const LUTStoreHeader& header,
+                          const StoredLUT* const* luts) {
+  FILE* file = std::fopen(location, "r+b");
+  if (file == nullptr) {
+    file = std::fopen(location, "w+b");
+  }
+  if (file == nullptr) {
+    return false;
+  }
+  // like an erased sector: a slot that is cut short never reads as valid
+  static const LUTStoreImage kErased{};
+  long offset = static_cast<long>(slot * kSlotSize);
+  bool written = std::fseek(file, offset, SEEK_SET) == 0 &&
+                 std::fwrite(&kErased, sizeof(kErased), 1, file) == 1 &&
+                 std::fseek(file, offset + static_cast<long>(offsetof(LUTStoreImage, luts)),
+                            SEEK_SET) == 0;
+  for (size_t i = 0; written && i < header.num_luts; i++) {
+    StoredLUT entry = unbound(*luts[i]);
+    written = std::fwrite(&entry, sizeof(StoredLUT), 1, file) == 1;
+  }
+  written = written && std::fseek(file, offset, SEEK_SET) == 0 &&
+            std::fwrite(&header, sizeof(header), 1, file) == 1;
+  return std::fclose(file) == 0 && written;
+}
+
+#endif
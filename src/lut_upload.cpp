@@ -0,0 +1,277 @@
+#include "lut_upload.hpp"
+
+namespace {
+
+uint16_t crc16_update(uint16_t crc, uint8_t byte) {
+  crc ^= static_cast<uint16_t>(byte) << 8;
+  for (int bit = 0; bit < 8; bit++) {
+    crc = (crc & 0x8000u) ? static_cast<uint16_t>((crc << 1) ^ 0x1021u)
+                          : static_cast<uint16_t>(crc << 1);
+  }
+  return crc;
+}
+
+uint32_t zigzag(int32_t value) {
+  return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+int32_t unzigzag(uint32_t value) {
+  return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1u);
+}
+
+// LEB128: 7 bits per byte, low bits first, high bit set on every byte but the last
+bool put_varint(uint32_t value, uint8_t* out, size_t capacity, size_t& pos) {
+  do {
+    if (pos >= capacity) {
+      return false;
+    }
+    uint8_t byte = static_cast<uint8_t>(value & 0x7Fu);
+    value >>= 7;
+    out[pos++] = static_cast<uint8_t>(byte | (value != 0 ? 0x80u : 0u));
+  } while (value != 0);
+  return true;
+}
+
+// at most 3 bytes (21 bits), enough for any 16 bit key, delta or zigzag value
+bool get_varint(const uint8_t* in, size_t length, size_t& pos, uint32_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 21; shift += 7) {
+    if (pos >= length) {
+      return false;
+    }
+    uint8_t byte = in[pos++];
+    value |= static_cast<uint32_t>(byte & 0x7Fu) << shift;
+    if ((byte & 0x80u) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool fits_int16(int32_t value) { return value >= INT16_MIN && value <= INT16_MAX; }
+
+}  // namespace
+
+FlatLUT LUTUpload::lut() const {
+  int16_t keys[kMaxLUTPoints];
+  float values[kMaxLUTPoints];
+  for (size_t i = 0; i < num_points; i++) {
+    keys[i] = points[i].key;
+    values[i] = static_cast<float>(points[i].value) / 100.0f;
+  }
+  return FlatLUT(keys, values, num_points, interp_type);
+}
+
+size_t LUTUploadReceiver::encode(const LUTUploadPoint* points, size_t n, uint8_t* out,
+                                 size_t capacity) {
+  size_t pos = 0;
+  for (size_t i = 0; i < n; i++) {
+    bool ok;
+    if (i == 0) {
+      ok = put_varint(zigzag(points[i].key), out, capacity, pos) &&
+           put_varint(zigzag(points[i].value), out, capacity, pos);
+    } else {
+      int32_t key_step = static_cast<int32_t>(points[i].key) - points[i - 1].key;
+      if (key_step < 1) {
+        return 0;
+      }
+      ok = put_varint(static_cast<uint32_t>(key_step - 1), out, capacity, pos) &&
+           put_varint(zigzag(static_cast<int32_t>(points[i].value) - points[i - 1].value), out,
+                      capacity, pos);
+    }
+    if (!ok) {
+      return 0;
+    }
+  }
+  return pos;
+}
+
+bool LUTUploadReceiver::decode(const uint8_t* payload, size_t length, LUTUploadPoint* points,
+                               size_t n) {
+  size_t pos = 0;
+  int32_t key = 0;
+  int32_t value = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint32_t key_field;
+    uint32_t value_field;
+    if (!get_varint(payload, length, pos, key_field) ||
+        !get_varint(payload, length, pos, value_field)) {
+      return false;
+    }
+    if (i == 0) {
+      key = unzigzag(key_field);
+      value = unzigzag(value_field);
+    } else {
+      key += static_cast<int32_t>(key_field) + 1;
+      value += unzigzag(value_field);
+    }
+    if (!fits_int16(key) || !fits_int16(value)) {
+      return false;
+    }
+    points[i].key = static_cast<int16_t>(key);
+    points[i].value = static_cast<int16_t>(value);
+  }
+  return pos == length;
+}
+
+uint16_t LUTUploadReceiver::crc16(const LUTUploadHeader& header, const uint8_t* payload) {
+  uint16_t crc = 0xFFFF;
+  crc = crc16_update(crc, header.table);
+  crc = crc16_update(crc, header.sequence);
+  crc = crc16_update(crc, static_cast<uint8_t>(header.file_status));
+  crc = crc16_update(crc, static_cast<uint8_t>(header.interp_type));
+  crc = crc16_update(crc, header.num_pairs);
+  crc = crc16_update(crc, header.lut_id);
+  crc = crc16_update(crc, header.payload_length);
+  for (size_t i = 0; i < header.payload_length; i++) {
+    crc = crc16_update(crc, payload[i]);
+  }
+  return crc;
+}
+
+bool LUTUploadReceiver::same_header(const LUTUploadHeader& a, const LUTUploadHeader& b) {
+  return a.table == b.table && a.sequence == b.sequence && a.file_status == b.file_status &&
+         a.interp_type == b.interp_type && a.num_pairs == b.num_pairs && a.lut_id == b.lut_id &&
+         a.payload_length == b.payload_length && a.crc == b.crc;
+}
+
+const LUTUpload* LUTUploadReceiver::committed() const {
+  for (size_t table = 0; table < kMaxUploadTables; table++) {
+    if (pending_tables & (1u << table)) {
+      return &uploads[table];
+    }
+  }
+  return nullptr;
+}
+
+bool LUTUploadReceiver::take_rejected(uint8_t& table, uint8_t& lut_id) {
+  for (size_t i = 0; i < kMaxUploadTables; i++) {
+    if (rejected_tables & (1u << i)) {
+      rejected_tables &= static_cast<uint16_t>(~(1u << i));
+      table = static_cast<uint8_t>(i);
+      lut_id = rejected_lut_ids[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief A header identical to the last one of its table is a repeat and does nothing. A
+ *        different header with the same sequence is a new upload that reused it: not received,
+ *        reported through take_rejected(). A new sequence starts a new upload of that table
+ *        (dropping any segments of the previous one), or, when the DAQ reports it has no valid
+ *        file, commits straight away once the header's CRC checks out.
+ */
+void LUTUploadReceiver::on_header(const LUTUploadHeader& header) {
+  if (header.table >= kMaxUploadTables) {
+    upload_stats.bad_uploads++;
+    return;
+  }
+  Transfer& transfer = transfers[header.table];
+  if (transfer.has_sequence && header.sequence == transfer.header.sequence) {
+    if (!same_header(header, transfer.header)) {
+      upload_stats.sequence_reuses++;
+      rejected_tables |= static_cast<uint16_t>(1u << header.table);
+      rejected_lut_ids[header.table] = header.lut_id;
+    }
+    return;
+  }
+
+  bool has_file = header.file_status == FileStatus::FILE_PRESENT_AND_VALID;
+  if (!has_file && header.payload_length != 0) {
+    upload_stats.bad_uploads++;
+    return;
+  }
+  // a header on its own resets the table: it is only taken with a good CRC, and is not
+  // remembered otherwise so the DAQ's repeat of it still gets through
+  if (!has_file && crc16(header, nullptr) != header.crc) {
+    upload_stats.crc_errors++;
+    return;
+  }
+  transfer.header = header;
+  transfer.has_sequence = true;
+  transfer.received_segments = 0;
+  transfer.receiving = false;
+
+  if (!has_file) {
+    commit(transfer);
+    return;
+  }
+  if (header.num_pairs > kMaxLUTPoints || header.payload_length > kMaxPayload) {
+    upload_stats.bad_uploads++;
+    return;
+  }
+  transfer.receiving = true;
+  try_commit(transfer);
+}
+
+void LUTUploadReceiver::on_segment(uint8_t table, uint8_t sequence, uint8_t segment,
+                                   const uint8_t (&data)[kSegmentBytes]) {
+  if (table >= kMaxUploadTables) {
+    upload_stats.stale_segments++;
+    return;
+  }
+  Transfer& transfer = transfers[table];
+  if (!transfer.has_sequence || sequence != transfer.header.sequence) {
+    upload_stats.stale_segments++;
+    return;
+  }
+  // repeats after the commit, or segments past payload_length
+  if (!transfer.receiving || segment >= transfer.segments_needed()) {
+    return;
+  }
+
+  size_t offset = segment * kSegmentBytes;
+  for (size_t i = 0; i < kSegmentBytes && offset + i < kMaxPayload; i++) {
+    transfer.payload[offset + i] = data[i];
+  }
+  transfer.received_segments |= static_cast<uint32_t>(1u) << segment;
+  try_commit(transfer);
+}
+
+/**
+ * @brief Commit once every segment is in. On a CRC mismatch the segments are dropped and the
+ *        upload is received again from the DAQ's repeats.
+ */
+void LUTUploadReceiver::try_commit(Transfer& transfer) {
+  size_t segments = transfer.segments_needed();
+  uint32_t all_segments =
+      segments >= 32 ? UINT32_MAX : (static_cast<uint32_t>(1u) << segments) - 1u;
+  if ((transfer.received_segments & all_segments) != all_segments) {
+    return;
+  }
+  if (crc16(transfer.header, transfer.payload) != transfer.header.crc) {
+    upload_stats.crc_errors++;
+    transfer.received_segments = 0;
+    return;
+  }
+  transfer.receiving = false;
+  commit(transfer);
+}
+
+void LUTUploadReceiver::commit(const Transfer& transfer) {
+  const LUTUploadHeader& header = transfer.header;
+  LUTUploadPoint points[kMaxLUTPoints];
+  uint8_t num_points = 0;
+  if (header.file_status == FileStatus::FILE_PRESENT_AND_VALID) {
+    if (!decode(transfer.payload, header.payload_length, points, header.num_pairs)) {
+      upload_stats.bad_uploads++;
+      return;
+    }
+    num_points = header.num_pairs;
+  }
+
+  // replaces a pending upload of the same table that was never taken
+  LUTUpload& upload = uploads[header.table];
+  upload.table = header.table;
+  upload.file_status = header.file_status;
+  upload.interp_type = header.interp_type;
+  upload.lut_id = header.lut_id;
+  upload.num_points = num_points;
+  for (size_t i = 0; i < num_points; i++) {
+    upload.points[i] = points[i];
+  }
+  pending_tables |= static_cast<uint16_t>(1u << header.table);
+  upload_stats.commits++;
+}
@@ -8,6 +8,15 @@
 #include "throttle_brake_driver.hpp"
 #include "virtualTimer.h"
 
-void setup() { fsm_init(); }
+void setup() {
+  fsm_init();
+#ifdef ECU_WCET_HARNESS
+  run_control_wcet();
+#endif
+}
 
-void loop() { tick_timers(); }
+void loop() {
+#ifndef ECU_WCET_HARNESS
+  executive.run_once();
+#endif
+}
@@ -0,0 +1,177 @@
+#include "pedal_acquisition.hpp"
+
+#ifdef ESP32
+#include "pins.hpp"
+#endif
+
+bool PedalAcquisition::begin(const Config& config_) {
+  if (config_.sample_rate_hz == 0 || config_.sample_rate_hz > kMaxSampleRateHz ||
+      config_.oversample == 0) {
+    return false;
+  }
+  config = config_;
+  window_samples = 0;
+  for (size_t channel = 0; channel < kNumPedalChannels; channel++) {
+    sums[channel] = 0;
+  }
+
+#ifdef ESP32
+  spi_bus_config_t bus{};
+  bus.mosi_io_num = -1;  // the ADCs only talk
+  bus.miso_io_num = static_cast<int>(Pins::SPI_MISO);
+  bus.sclk_io_num = static_cast<int>(Pins::SPI_CLK);
+  bus.quadwp_io_num = -1;
+  bus.quadhd_io_num = -1;
+  bus.max_transfer_sz = 4;
+  if (spi_bus_initialize(kHost, &bus, SPI_DMA_CH_AUTO) != ESP_OK) {
+    return false;
+  }
+
+  // the driver toggles each ADC's CS around its transaction
+  static constexpr Pins kCSPins[kNumPedalChannels] = {
+      Pins::APPS1_CS_PIN, Pins::APPS2_CS_PIN, Pins::FRONT_BRAKE_CS_PIN, Pins::REAR_BRAKE_CS_PIN};
+  for (size_t channel = 0; channel < kNumPedalChannels; channel++) {
+    spi_device_interface_config_t device{};
+    device.mode = 2;
+    device.clock_speed_hz = static_cast<int>(config.spi_clock_hz);
+    device.spics_io_num = static_cast<int>(kCSPins[channel]);
+    device.queue_size = 1;
+    if (spi_bus_add_device(kHost, &device, &devices[channel]) != ESP_OK) {
+      return false;
+    }
+    transactions[channel] = spi_transaction_t{};
+    // full duplex: the driver rejects an rxlength above length
+    transactions[channel].flags = SPI_TRANS_USE_RXDATA;
+    transactions[channel].length = 16;
+    transactions[channel].rxlength = 16;
+  }
+
+  // one conversion up front: a transaction the driver rejects fails here, not as a stream of
+  // errors that leaves the pedals stale
+  int16_t counts[kNumPedalChannels];
+  if (!convert(counts)) {
+    return false;
+  }
+
+  if (xTaskCreatePinnedToCore(task_entry, "pedal_adc", kTaskStackBytes, this, kTaskPriority,
+                              &task, kTaskCore) != pdPASS) {
+    return false;
+  }
+  esp_timer_create_args_t timer_args{};
+  timer_args.callback = on_timer;
+  timer_args.arg = this;
+  timer_args.name = "pedal_adc";
+  return esp_timer_create(&timer_args, &timer) == ESP_OK &&
+         esp_timer_start_periodic(timer, 1000000 / config.sample_rate_hz) == ESP_OK;
+#else
+  return true;
+#endif
+}
+
+void PedalAcquisition::stop() {
+#ifdef ESP32
+  if (timer != nullptr) {
+    esp_timer_stop(timer);
+  }
+#endif
+}
+
+void PedalAcquisition::add_sample(const int16_t (&counts)[kNumPedalChannels], uint32_t now_us) {
+  for (size_t channel = 0; channel < kNumPedalChannels; channel++) {
+    sums[channel] += counts[channel];
+  }
+  stats.conversions++;
+  if (++window_samples < config.oversample) {
+    return;
+  }
+
+  PedalADCBlock block;
+  int32_t n = window_samples;
+  for (size_t channel = 0; channel < kNumPedalChannels; channel++) {
+    // mean rounded to nearest, counts can be negative
+    int32_t sum = sums[channel];
+    block.counts[channel] = static_cast<int16_t>((sum >= 0 ? sum + n / 2 : sum - n / 2) / n);
+    sums[channel] = 0;
+  }
+  block.samples = window_samples;
+  block.sequence = ++block_sequence;
+  block.timestamp_us = now_us;
+  window_samples = 0;
+  blocks.publish(block);
+  stats.blocks++;
+}
+
+int16_t PedalAcquisition::decode(uint16_t frame) {
+  int16_t value = static_cast<int16_t>(static_cast<int16_t>(frame) >> 3);
+  if (value & 0x0800) {
+    value |= static_cast<int16_t>(0xF000);
+  }
+  return value;
+}
+
+#ifdef ESP32
+
+void PedalAcquisition::on_timer(void* arg) {
+  xTaskNotifyGive(static_cast<PedalAcquisition*>(arg)->task);
+}
+
+void PedalAcquisition::task_entry(void* arg) { static_cast<PedalAcquisition*>(arg)->run(); }
+
+void PedalAcquisition::run() {
+  for (;;) {
+    // more than one pending wake up: the timer fired again before the last conversion finished
+    uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (pending > 1) {
+      stats.overruns += pending - 1;
+    }
+    int16_t counts[kNumPedalChannels];
+    if (!convert(counts)) {
+      stats.errors++;
+      continue;
+    }
+    add_sample(counts, static_cast<uint32_t>(esp_timer_get_time()));
+  }
+}
+
+bool PedalAcquisition::convert(int16_t (&counts)[kNumPedalChannels]) {
+  size_t queued = 0;
+  while (queued < kNumPedalChannels &&
+         spi_device_queue_trans(devices[queued], &transactions[queued], 0) == ESP_OK) {
+    queued++;
+  }
+  // the task blocks here while the bus runs, not the CPU
+  bool converted = queued == kNumPedalChannels;
+  for (size_t channel = 0; channel < queued; channel++) {
+    spi_transaction_t* done = nullptr;
+    if (spi_device_get_trans_result(devices[channel], &done, portMAX_DELAY) != ESP_OK ||
+        done == nullptr) {
+      converted = false;
+      continue;
+    }
+    counts[channel] = decode(static_cast<uint16_t>((done->rx_data[0] << 8) | done->rx_data[1]));
+  }
+  return converted;
+}
+
+#else
+
+void SimulatedPedalADC::convert(int16_t (&counts)[kNumPedalChannels]) {
+  for (size_t channel = 0; channel < kNumPedalChannels; channel++) {
+    int32_t offset = 0;
+    if (noise > 0) {
+      state ^= state << 13;
+      state ^= state >> 17;
+      state ^= state << 5;
+      offset = static_cast<int32_t>(state % (2u * static_cast<uint32_t>(noise) + 1)) - noise;
+    }
+    counts[channel] = static_cast<int16_t>(levels[channel] + offset);
+  }
+}
+
+void PedalAcquisition::sample_simulated(uint32_t now_us) {
+  int16_t counts[kNumPedalChannels];
+  simulated_adc.convert(counts);
+  add_sample(counts, now_us);
+}
+
+#endif
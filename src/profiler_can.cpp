@@ -0,0 +1,24 @@
+#include "profiler_can.hpp"
+
+uint16_t ProfilerCan::to_us(uint32_t ticks) {
+  uint32_t us = ticks / StageProfiler::kTicksPerUs;
+  return us > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(us);
+}
+
+void ProfilerCan::update(const StageProfiler& profiler) {
+  // round robin over the stages that ran, the signals keep the last one if none did
+  for (size_t tried = 0; tried < StageProfiler::kNumStages; tried++) {
+    ProfileStage stage = static_cast<ProfileStage>(next_stage);
+    next_stage = static_cast<uint8_t>((next_stage + 1) % StageProfiler::kNumStages);
+    const StageProfiler::StageStats& stats = profiler.stats(stage);
+    if (stats.count == 0) {
+      continue;
+    }
+    profile_stage = static_cast<uint8_t>(stage);
+    profile_min_us = to_us(stats.min_ticks);
+    profile_mean_us = to_us(stats.mean_ticks());
+    profile_max_us = to_us(stats.max_ticks);
+    profile_p99_bucket = stats.percentile_bucket(99);
+    return;
+  }
+}
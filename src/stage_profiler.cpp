@@ -0,0 +1,120 @@
+#include "stage_profiler.hpp"
+
+#include <cstdio>
+
+#ifdef ECU_PROFILING
+StageProfiler stage_profiler;
+#endif
+
+namespace {
+
+// snprintf after what was written so far, keeps counting the length once the buffer is full
+template <typename... Args>
+void append(char* buffer, size_t size, size_t& length, const char* format, Args... args) {
+  char* end = length < size ? buffer + length : nullptr;
+  int written = std::snprintf(end, length < size ? size - length : 0, format, args...);
+  if (written > 0) {
+    length += static_cast<size_t>(written);
+  }
+}
+
+}  // namespace
+
+uint32_t StageProfiler::StageStats::mean_ticks() const {
+  return count == 0 ? 0 : static_cast<uint32_t>(total_ticks / count);
+}
+
+uint8_t StageProfiler::StageStats::percentile_bucket(uint8_t percent) const {
+  if (count == 0) {
+    return 0;
+  }
+  // rank of the sample at the percentile, rounded up
+  uint64_t rank = (static_cast<uint64_t>(count) * percent + 99) / 100;
+  uint64_t seen = 0;
+  for (size_t b = 0; b < kNumBuckets; b++) {
+    seen += histogram[b];
+    if (seen >= rank && seen > 0) {
+      return static_cast<uint8_t>(b);
+    }
+  }
+  return kNumBuckets - 1;
+}
+
+uint8_t StageProfiler::bucket(uint32_t ticks) {
+  if (ticks == 0) {
+    return 0;
+  }
+  uint8_t width = static_cast<uint8_t>(32 - __builtin_clz(ticks));
+  return width < kNumBuckets ? width : kNumBuckets - 1;
+}
+
+void StageProfiler::record(ProfileStage stage, uint32_t ticks) {
+  StageStats& stats = stages[static_cast<size_t>(stage)];
+  stats.count++;
+  stats.total_ticks += ticks;
+  if (ticks < stats.min_ticks) {
+    stats.min_ticks = ticks;
+  }
+  if (ticks > stats.max_ticks) {
+    stats.max_ticks = ticks;
+  }
+  stats.histogram[bucket(ticks)]++;
+}
+
+void StageProfiler::reset() {
+  for (size_t i = 0; i < kNumStages; i++) {
+    stages[i] = StageStats{};
+  }
+}
+
+const char* StageProfiler::stage_name(ProfileStage stage) {
+  switch (stage) {
+    case ProfileStage::kControlCycle:
+      return "control_cycle";
+    case ProfileStage::kUpdateSensorValues:
+      return "update_sensor_values";
+    case ProfileStage::kCheckImplausibilities:
+      return "check_for_implausibilities";
+    case ProfileStage::kProcessState:
+      return "process_state";
+    case ProfileStage::kTorqueLookup:
+      return "torque_lookup";
+    case ProfileStage::kChangeState:
+      return "change_state";
+    case ProfileStage::kThermalLookup:
+      return "thermal_lookup";
+    case ProfileStage::kReadInverterCAN:
+      return "read_inverter_CAN";
+    case ProfileStage::kBusTick:
+      return "bus_tick";
+    default:
+      return "?";
+  }
+}
+
+size_t StageProfiler::write_report(char* buffer, size_t size) const {
+  size_t length = 0;
+  if (size > 0) {
+    buffer[0] = '\0';
+  }
+  for (size_t i = 0; i < kNumStages; i++) {
+    const StageStats& stats = stages[i];
+    if (stats.count == 0) {
+      continue;
+    }
+    append(buffer, size, length, "%s n=%lu min=%.2f mean=%.2f max=%.2f us |",
+           stage_name(static_cast<ProfileStage>(i)), static_cast<unsigned long>(stats.count),
+           static_cast<double>(stats.min_ticks) / kTicksPerUs,
+           static_cast<double>(stats.mean_ticks()) / kTicksPerUs,
+           static_cast<double>(stats.max_ticks) / kTicksPerUs);
+    // upper edge of each bucket in ticks: samples
+    for (size_t b = 0; b < kNumBuckets; b++) {
+      if (stats.histogram[b] != 0) {
+        append(buffer, size, length, " <%lu:%lu", b == 0 ? 1ul : 1ul << b,
+               static_cast<unsigned long>(stats.histogram[b]));
+      }
+    }
+    append(buffer, size, length, "\n");
+  }
+  return length;
+}
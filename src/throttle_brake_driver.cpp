@@ -1,84 +1,39 @@
 #include "throttle_brake_driver.hpp"
 
 #include <Arduino.h>
-#include <SPI.h>
 
+#include "event_log.hpp"
 #include "pins.hpp"
 
-void ThrottleBrake::initialize_CS_pin(uint8_t CS_pin) {
-  pinMode(CS_pin, OUTPUT);
-  digitalWrite(CS_pin, HIGH);
-}
-
-void ThrottleBrake::initialize_CS_pins() {
-  initialize_CS_pin(static_cast<uint8_t>(Pins::APPS1_CS_PIN));
-  initialize_CS_pin(static_cast<uint8_t>(Pins::APPS2_CS_PIN));
-  initialize_CS_pin(static_cast<uint8_t>(Pins::FRONT_BRAKE_CS_PIN));
-  initialize_CS_pin(static_cast<uint8_t>(Pins::REAR_BRAKE_CS_PIN));
-}
-
 /**
- * @brief Set implausibilities false, start SPI bus, set pin modes, write default HIGH to CS pins
+ * @brief Set implausibilities false, start the background ADC acquisition, set pin modes
  */
-void ThrottleBrake::initialize() {
+void ThrottleBrake::initialize(const PedalAcquisition::Config& sampling) {
   ThrottleBrake::APPSs_disagreement_implausibility_present = false;
   ThrottleBrake::BPPC_implausibility_present = false;
   ThrottleBrake::brake_shorted_or_opened_implausibility_present = false;
 
-  SPI.begin(static_cast<uint8_t>(Pins::SPI_CLK), static_cast<uint8_t>(Pins::SPI_MISO),
-            static_cast<uint8_t>(Pins::SPI_MOSI));
-
-  initialize_CS_pins();
+  if (!acquisition.begin(sampling)) {
+    event_log.log(LogEvent::kPedalAcquisitionFailed);
+  }
 
   pinMode(static_cast<uint8_t>(Pins::BRAKE_VALID_PIN), INPUT);
 }
 
 /**
- * @brief Reads data from ADCs and stores adc sensor data (in ADC counts) in class variables
+ * @brief Takes the newest oversampled block from the acquisition engine into the adc class
+ *        variables. Never waits on the SPI bus.
  */
-void ThrottleBrake::read_from_SPI_ADCs() {
-  SPI.beginTransaction(SPISettings(1000000, MSBFIRST, SPI_MODE2));
-  // 1000000: clock rate
-  // MSBFIRST: Most significant bit first
-
-  digitalWrite(static_cast<uint8_t>(Pins::APPS1_CS_PIN), LOW);
-
-  int16_t APPS1 = SPI.transfer16(0x0000);
-  int16_t APPS1_signed = static_cast<int16_t>(APPS1 >> 3);
-  if (APPS1_signed & 0x0800) {
-    APPS1_signed |= 0xF000;
-  }
-  ThrottleBrake::APPS1_adc = APPS1_signed;
-  digitalWrite(static_cast<uint8_t>(Pins::APPS1_CS_PIN), HIGH);
-
-  digitalWrite(static_cast<uint8_t>(Pins::APPS2_CS_PIN), LOW);
-  int16_t APPS2 = SPI.transfer16(0x0000);
-  int16_t APPS2_signed = static_cast<int16_t>(APPS2 >> 3);
-  if (APPS2_signed & 0x0800) {
-    APPS2_signed |= 0xF000;
-  }
-  ThrottleBrake::APPS2_adc = APPS2_signed;
-  digitalWrite(static_cast<uint8_t>(Pins::APPS2_CS_PIN), HIGH);
-
-  digitalWrite(static_cast<uint8_t>(Pins::FRONT_BRAKE_CS_PIN), LOW);
-  int16_t front = SPI.transfer16(0x0000);
-  int16_t front_signed = static_cast<int16_t>(front >> 3);
-  if (front_signed & 0x0800) {
-    front_signed |= 0xF000;
-  }
-  ThrottleBrake::front_brake_adc = front_signed;
-  digitalWrite(static_cast<uint8_t>(Pins::FRONT_BRAKE_CS_PIN), HIGH);
-
-  digitalWrite(static_cast<uint8_t>(Pins::REAR_BRAKE_CS_PIN), LOW);
-  int16_t rear = SPI.transfer16(0x0000);
-  int16_t rear_signed = static_cast<int16_t>(rear >> 3);
-  if (rear_signed & 0x0800) {
-    rear_signed |= 0xF000;
-  }
-  ThrottleBrake::rear_brake_adc = rear_signed;
-  digitalWrite(static_cast<uint8_t>(Pins::REAR_BRAKE_CS_PIN), HIGH);
-
-  SPI.endTransaction();
+void ThrottleBrake::read_ADCs() {
+  const PedalADCBlock& block = acquisition.latest();
+  ThrottleBrake::APPS1_adc = block.counts[static_cast<size_t>(PedalChannel::APPS1)];
+  ThrottleBrake::APPS2_adc = block.counts[static_cast<size_t>(PedalChannel::APPS2)];
+  ThrottleBrake::front_brake_adc = block.counts[static_cast<size_t>(PedalChannel::FRONT_BRAKE)];
+  ThrottleBrake::rear_brake_adc = block.counts[static_cast<size_t>(PedalChannel::REAR_BRAKE)];
+  ThrottleBrake::sample_timestamp_us = block.timestamp_us;
+  // a stalled acquisition must not keep the last throttle alive
+  ThrottleBrake::sample_stale =
+      block.samples == 0 || micros() - block.timestamp_us > kMaxSampleAgeUs;
 }
 
 int16_t ThrottleBrake::get_safe_RAW(int16_t RAW, int16_t projected_min, int16_t projected_max) {
@@ -101,8 +56,15 @@ int16_t ThrottleBrake::scale_ADC_input(int16_t ADC_input, int16_t ADC_min, int16
   }
 }
 
-void ThrottleBrake::update_sensor_values() {
-  ThrottleBrake::read_from_SPI_ADCs();
+/**
+ * @brief Take the newest oversampled ADC block and scale it. The implausibility checks and CAN
+ *        signals use the values of the last call, so everything in a control cycle agrees on one
+ *        sample.
+ *
+ * @return PedalSample
+ */
+ThrottleBrake::PedalSample ThrottleBrake::update_sensor_values() {
+  ThrottleBrake::read_ADCs();
 
   ThrottleBrake::APPS1_throttle_scaled = ThrottleBrake::scale_ADC_input(
       ThrottleBrake::APPS1_adc, static_cast<int16_t>(Bounds::APPS1_ADC_MIN),
@@ -130,6 +92,19 @@ void ThrottleBrake::update_sensor_values() {
   } else {
     ThrottleBrake::brake_pressed = false;
   }
+
+  PedalSample sample;
+  sample.APPS1_adc = ThrottleBrake::APPS1_adc;
+  sample.APPS2_adc = ThrottleBrake::APPS2_adc;
+  sample.front_brake_adc = ThrottleBrake::front_brake_adc;
+  sample.rear_brake_adc = ThrottleBrake::rear_brake_adc;
+  sample.APPS1_throttle_scaled = ThrottleBrake::APPS1_throttle_scaled;
+  sample.APPS2_throttle_scaled = ThrottleBrake::APPS2_throttle_scaled;
+  sample.front_brake_scaled = ThrottleBrake::front_brake_scaled;
+  sample.rear_brake_scaled = ThrottleBrake::rear_brake_scaled;
+  sample.brake_pressed = ThrottleBrake::brake_pressed;
+  sample.timestamp_us = ThrottleBrake::sample_timestamp_us;
+  return sample;
 }
 
 /**
@@ -188,7 +163,7 @@ void ThrottleBrake::check_brake_shorted_or_opened_implausibility() {
       ThrottleBrake::brake_shorted_or_opened_implausibility_timer.GetTimerState() ==
           VirtualTimer::State::kNotStarted) {
     ThrottleBrake::brake_shorted_or_opened_implausibility_timer.Start(millis());
-    Serial.println("Brake implausibility detected");
+    event_log.log(LogEvent::kBrakeImplausibility);
   } else if (digitalRead(static_cast<uint8_t>(Pins::BRAKE_VALID_PIN)) ==
                  static_cast<bool>(BrakeStatus::VALID) &&
              ThrottleBrake::brake_shorted_or_opened_implausibility_timer.GetTimerState() ==
@@ -202,12 +177,13 @@ void ThrottleBrake::check_brake_shorted_or_opened_implausibility() {
 }
 
 /**
- * @brief Returns true if APPS1 and APPS2 are within bounds, false otherwise
+ * @brief Returns true if APPS1 and APPS2 are within bounds and freshly sampled, false otherwise
  *
  * @return bool
  */
 bool ThrottleBrake::check_APPSs_validity() const {
-  return (ThrottleBrake::APPS1_adc >= static_cast<int16_t>(Bounds::SHORTED_THRESHOLD) &&
+  return (!ThrottleBrake::sample_stale &&
+          ThrottleBrake::APPS1_adc >= static_cast<int16_t>(Bounds::SHORTED_THRESHOLD) &&
           ThrottleBrake::APPS1_adc <= static_cast<int16_t>(Bounds::OPEN_THRESHOLD) &&
           ThrottleBrake::APPS2_adc >= static_cast<int16_t>(Bounds::SHORTED_THRESHOLD) &&
           ThrottleBrake::APPS2_adc <= static_cast<int16_t>(Bounds::OPEN_THRESHOLD));
@@ -224,7 +200,7 @@ void ThrottleBrake::check_APPSs_valid_implausibility() {
       ThrottleBrake::APPSs_invalid_implausibility_timer.GetTimerState() ==
           VirtualTimer::State::kNotStarted) {
     ThrottleBrake::APPSs_invalid_implausibility_timer.Start(millis());
-    Serial.println("APPSs invalid implausibility detected");
+    event_log.log(LogEvent::kAPPSsInvalidImplausibility);
   } else if (ThrottleBrake::check_APPSs_validity() &&
              ThrottleBrake::APPSs_invalid_implausibility_timer.GetTimerState() ==
                  VirtualTimer::State::kRunning) {
@@ -257,7 +233,7 @@ void ThrottleBrake::check_APPSs_disagreement_implausibility() {
       ThrottleBrake::APPSs_disagreement_implausibility_timer.GetTimerState() ==
           VirtualTimer::State::kNotStarted) {
     ThrottleBrake::APPSs_disagreement_implausibility_timer.Start(millis());
-    Serial.println("APPSs disagreement implausibility detected");
+    event_log.log(LogEvent::kAPPSsDisagreementImplausibility);
 
   } else if (!(APPS_diff > 10.0 || APPS_diff < -10.0) &&
              ThrottleBrake::APPSs_disagreement_implausibility_timer.GetTimerState() ==
@@ -302,25 +278,50 @@ void ThrottleBrake::check_BPPC_implausibility() {
 }
 
 /**
- * @brief Check for implausibility and set throttle/brake CAN signals accordingly
+ * @brief The values of the last update_sensor_values() and implausibility checks for the CAN
+ *        signals
+ *
+ * @return CANValues
+ */
+ThrottleBrake::CANValues ThrottleBrake::get_CAN_values() const {
+  CANValues values;
+  values.APPS1_throttle = ThrottleBrake::APPS1_throttle_scaled;
+  values.APPS2_throttle = ThrottleBrake::APPS2_throttle_scaled;
+  values.front_brake = ThrottleBrake::front_brake_scaled;
+  values.rear_brake = ThrottleBrake::rear_brake_scaled;
+  values.brake_pressed = ThrottleBrake::brake_pressed;
+  values.implausibility_present = ThrottleBrake::is_implausibility_present();
+  values.APPSs_disagreement = ThrottleBrake::APPSs_disagreement_implausibility_present;
+  values.BPPC = ThrottleBrake::BPPC_implausibility_present;
+  values.brake_invalid = ThrottleBrake::brake_shorted_or_opened_implausibility_present;
+  values.APPSs_invalid = ThrottleBrake::APPSs_invalid_implausibility_present;
+  return values;
+}
+
+/**
+ * @brief Set throttle/brake/implausibility CAN signals, on the core that encodes their frames
  *
  * @return void
  */
-void ThrottleBrake::update_throttle_brake_CAN_signals() {
-  ThrottleBrake::APPS1_Throttle = ThrottleBrake::APPS1_throttle_scaled;
-  ThrottleBrake::APPS2_Throttle = ThrottleBrake::APPS2_throttle_scaled;
-  ThrottleBrake::Front_Brake_Pressure = ThrottleBrake::front_brake_scaled;
-  ThrottleBrake::Rear_Brake_Pressure = ThrottleBrake::rear_brake_scaled;
-  ThrottleBrake::Brake_Pressed = ThrottleBrake::brake_pressed;
-  ThrottleBrake::CAN_Implausibility_Present = ThrottleBrake::is_implausibility_present();
-  ThrottleBrake::CAN_APPSs_Disagreement_Imp =
-      ThrottleBrake::APPSs_disagreement_implausibility_present;
-  ThrottleBrake::CAN_BPPC_Imp = ThrottleBrake::BPPC_implausibility_present;
-  ThrottleBrake::CAN_Brake_invalid_Imp =
-      ThrottleBrake::brake_shorted_or_opened_implausibility_present;
-  ThrottleBrake::CAN_APPSs_Invalid_Imp = ThrottleBrake::APPSs_invalid_implausibility_present;
+void ThrottleBrake::update_throttle_brake_CAN_signals(const CANValues& values) {
+  ThrottleBrake::APPS1_Throttle = values.APPS1_throttle;
+  ThrottleBrake::APPS2_Throttle = values.APPS2_throttle;
+  ThrottleBrake::Front_Brake_Pressure = values.front_brake;
+  ThrottleBrake::Rear_Brake_Pressure = values.rear_brake;
+  ThrottleBrake::Brake_Pressed = values.brake_pressed;
+  ThrottleBrake::CAN_Implausibility_Present = values.implausibility_present;
+  ThrottleBrake::CAN_APPSs_Disagreement_Imp = values.APPSs_disagreement;
+  ThrottleBrake::CAN_BPPC_Imp = values.BPPC;
+  ThrottleBrake::CAN_Brake_invalid_Imp = values.brake_invalid;
+  ThrottleBrake::CAN_APPSs_Invalid_Imp = values.APPSs_invalid;
 }
 
+const PedalAcquisition::Stats& ThrottleBrake::get_acquisition_stats() const {
+  return ThrottleBrake::acquisition.get_stats();
+}
+
+PedalAcquisition& ThrottleBrake::get_acquisition() { return ThrottleBrake::acquisition; }
+
 void ThrottleBrake::print_throttle_info() {
   // Serial.print(" imp_present: ");
   // Serial.print(ThrottleBrake::is_implausibility_present());
@@ -332,10 +333,7 @@ void ThrottleBrake::print_throttle_info() {
   // Serial.print(ThrottleBrake::brake_shorted_or_opened_implausibility_present);
   // Serial.print(" BPPC_imp: ");
   // Serial.print(ThrottleBrake::BPPC_implausibility_present);
-  Serial.print(" APPS1_ADC: ");
-  Serial.print(ThrottleBrake::APPS1_adc);
-  Serial.print(" APPS2_ADC: ");
-  Serial.print(ThrottleBrake::APPS2_adc);
+  event_log.log(LogEvent::kThrottleInfo, ThrottleBrake::APPS1_adc, ThrottleBrake::APPS2_adc);
   // // Serial.print(" Front_Bk_ADC: ");
   // // Serial.print(ThrottleBrake::front_brake_adc);
   // Serial.print(" APPS_validity: ");
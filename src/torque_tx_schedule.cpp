@@ -0,0 +1,45 @@
+#include "torque_tx_schedule.hpp"
+
+void TorqueTXSchedule::on_command(uint32_t sample_timestamp_us, uint32_t now_us) {
+  last_send_us = now_us;
+  stats.event_sends++;
+  stats.last_latency_us = now_us - sample_timestamp_us;
+  if (stats.last_latency_us > stats.max_latency_us) {
+    stats.max_latency_us = stats.last_latency_us;
+  }
+}
+
+bool TorqueTXSchedule::fallback_due(uint32_t now_us) {
+  if (now_us - last_send_us < fallback_period_us) {
+    return false;
+  }
+  // keep the phase of the last send, a late service doesn't bunch up the next ones
+  uint32_t periods = (now_us - last_send_us) / fallback_period_us;
+  last_send_us += periods * fallback_period_us;
+  stats.fallback_sends++;
+  return true;
+}
+
+TorqueTXSchedule::Send TorqueTXSchedule::next(uint32_t sequence, uint32_t sample_timestamp_us,
+                                              uint32_t now_us) {
+  if (sequence != last_sequence) {
+    last_sequence = sequence;
+    last_command_us = now_us;
+    if (now_us - sample_timestamp_us <= command_timeout_us) {
+      zeroed = false;
+      on_command(sample_timestamp_us, now_us);
+      return Send::kCommand;
+    }
+  } else if (now_us - last_command_us <= command_timeout_us) {
+    return fallback_due(now_us) ? Send::kResend : Send::kNone;
+  }
+
+  // stalled, or a command from a stale pedal sample
+  if (!zeroed) {
+    zeroed = true;
+    last_send_us = now_us;
+    stats.timeouts++;
+    return Send::kZero;
+  }
+  return fallback_due(now_us) ? Send::kResend : Send::kNone;
+}
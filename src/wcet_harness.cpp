@@ -0,0 +1,42 @@
+#include "wcet_harness.hpp"
+
+bool WcetHarness::add_scenario(const char* name, StepFn prepare, StepFn run,
+                               uint32_t budget_us) {
+  if (scenario_count >= kMaxScenarios || run == nullptr) {
+    return false;
+  }
+  Scenario& scenario = scenarios[scenario_count++];
+  scenario = Scenario{};
+  scenario.name = name;
+  scenario.prepare = prepare;
+  scenario.run = run;
+  scenario.budget_us = budget_us;
+  return true;
+}
+
+bool WcetHarness::run(uint32_t iterations) {
+  bool within_budget = true;
+  for (size_t i = 0; i < scenario_count; i++) {
+    Scenario& scenario = scenarios[i];
+    Result& result = scenario.result;
+    result = Result{};
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+      if (scenario.prepare != nullptr) {
+        scenario.prepare(iteration);
+      }
+      uint32_t start = clock();
+      scenario.run(iteration);
+      uint32_t elapsed = clock() - start;
+
+      result.runs++;
+      result.total_us += elapsed;
+      if (elapsed > result.max_us) {
+        result.max_us = elapsed;
+        result.worst_iteration = iteration;
+      }
+    }
+    result.within_budget = result.max_us <= scenario.budget_us;
+    within_budget = within_budget && result.within_budget;
+  }
+  return within_budget;
+}
@@ -0,0 +1,342 @@
+// Microbenchmarks for the LUT engine. Runs natively (std::chrono) or on the ESP32 (micros()).
+// Each benchmark also checks its result against a reference so a fast-but-wrong path fails.
+#include <unity.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+
+#include "LUT.hpp"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+static uint32_t now_us() { return micros(); }
+#else
+#include <time.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+static uint32_t now_us() {
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                   std::chrono::steady_clock::now().time_since_epoch())
+                                   .count());
+}
+#endif
+
+static MockCAN fake_can;
+static VirtualTimerGroup fake_timers;
+static Lookup lu(fake_can, fake_timers);
+
+#ifdef ARDUINO
+static constexpr int kIterations = 20000;
+#else
+static constexpr int kIterations = 2000000;
+#endif
+
+// keys spread over the throttle range plus a little outside it, to hit both clamps
+static constexpr int kNumKeys = 256;
+static int16_t keys[kNumKeys];
+
+static volatile float sink;
+
+// the interpolation FlatLUT used before slopes were precomputed (one division per call)
+static float reference_lookup(int16_t key, const FlatLUT& lut) {
+  size_t last = lut.size() - 1;
+  if (key <= lut.key_at(0)) {
+    return lut.value_at(0);
+  }
+  if (key >= lut.key_at(last)) {
+    return lut.value_at(last);
+  }
+  size_t i = 0;
+  size_t n = lut.size();
+  while (n > 1) {
+    size_t half = n / 2;
+    i = (lut.key_at(i + half) <= key) ? i + half : i;
+    n -= half;
+  }
+  return lut.value_at(i) + (lut.value_at(i + 1) - lut.value_at(i)) *
+                               static_cast<float>(key - lut.key_at(i)) /
+                               static_cast<float>(lut.key_at(i + 1) - lut.key_at(i));
+}
+
+template <typename F>
+static float ns_per_call(F&& f) {
+  float acc = 0.0f;
+  uint32_t start = now_us();
+  for (int i = 0; i < kIterations; i++) {
+    acc += f(keys[i % kNumKeys]);
+  }
+  uint32_t elapsed = now_us() - start;
+  sink = acc;
+  return static_cast<float>(elapsed) * 1000.0f / kIterations;
+}
+
+static void report(const char* name, float ns) {
+  char msg[96];
+  snprintf(msg, sizeof(msg), "%-32s %8.1f ns/lookup", name, ns);
+  TEST_MESSAGE(msg);
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void bench_slope_vs_division(void) {
+  const FlatLUT& lut = lu.DefaultAccelThrottle2Modifier_LUT;
+  for (int i = 0; i < kNumKeys; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, reference_lookup(keys[i], lut), lut.lookup(keys[i]));
+  }
+
+  float division = ns_per_call([&](int16_t key) { return reference_lookup(key, lut); });
+  float slope = ns_per_call([&](int16_t key) { return lut.lookup(key); });
+  report("division interpolation", division);
+  report("precomputed slope", slope);
+}
+
+void bench_uniform_grid_vs_search(void) {
+  const FlatLUT& lut = lu.DefaultAccelThrottle2Modifier_LUT;
+  // same table with grid indexing turned off, forces the binary search
+  FlatLUT searched = lut;
+  searched.grid_points = 0;
+  for (int16_t key = -100; key < 2200; key++) {
+    TEST_ASSERT_EQUAL_FLOAT(searched.lookup(key), lut.lookup(key));
+  }
+
+  float search = ns_per_call([&](int16_t key) { return searched.lookup(key); });
+  float grid = ns_per_call([&](int16_t key) { return lut.lookup(key); });
+  report("binary search", search);
+  report("uniform grid", grid);
+}
+
+void bench_cursor_vs_search(void) {
+  const FlatLUT& lut = lu.RPM2Throttle_LUT;
+  // motor rpm sampled at 100 Hz: a slow ramp up and back down with a little noise
+  static int16_t rpm_trace[kNumKeys * 8];
+  constexpr int kTraceLength = sizeof(rpm_trace) / sizeof(rpm_trace[0]);
+  uint32_t seed = 7;
+  for (int i = 0; i < kTraceLength; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    int ramp = (i < kTraceLength / 2) ? i * 3 : (kTraceLength - i) * 3;
+    rpm_trace[i] = static_cast<int16_t>(ramp + static_cast<int>((seed >> 16) % 21) - 10);
+  }
+
+  LUTCursor cursor;
+  for (int i = 0; i < kTraceLength; i++) {
+    TEST_ASSERT_EQUAL_FLOAT(lut.lookup(rpm_trace[i]), lut.lookup(rpm_trace[i], cursor));
+  }
+
+  auto time_trace = [&](auto&& f) {
+    float acc = 0.0f;
+    uint32_t start = now_us();
+    for (int i = 0; i < kIterations; i++) {
+      acc += f(rpm_trace[i % kTraceLength]);
+    }
+    uint32_t elapsed = now_us() - start;
+    sink = acc;
+    return static_cast<float>(elapsed) * 1000.0f / kIterations;
+  };
+  float search = time_trace([&](int16_t key) { return lut.lookup(key); });
+  float cached = time_trace([&](int16_t key) { return lut.lookup(key, cursor); });
+  report("rpm trace, no cursor", search);
+  report("rpm trace, segment cursor", cached);
+}
+
+void bench_smooth_vs_linear(void) {
+  const FlatLUT& linear = lu.DefaultAccelThrottle2Modifier_LUT;
+  std::map<int16_t, float> points;
+  for (size_t i = 0; i < linear.size(); i++) {
+    points[linear.key_at(i)] = linear.value_at(i);
+  }
+  FlatLUT smooth(points, InterpType::SMOOTH_STEP);
+  CubicSegments cubics;  // as a calibration bank binds it
+  smooth.bind_cubics(cubics);
+  for (size_t i = 0; i < linear.size(); i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, linear.value_at(i), smooth.lookup(linear.key_at(i)));
+  }
+
+  // best of a few runs, so a scheduler hiccup on the host doesn't decide the ratio
+  float linear_ns = 1e9f;
+  float smooth_ns = 1e9f;
+  for (int run = 0; run < 5; run++) {
+    linear_ns = std::min(linear_ns, ns_per_call([&](int16_t key) { return linear.lookup(key); }));
+    smooth_ns = std::min(smooth_ns, ns_per_call([&](int16_t key) { return smooth.lookup(key); }));
+  }
+  report("linear", linear_ns);
+  report("smooth step (cubic Hermite)", smooth_ns);
+  TEST_ASSERT_TRUE(smooth_ns <= 1.5f * linear_ns);
+}
+
+void bench_torque_map_vs_pipeline(void) {
+  // pedal and rpm at 100 Hz both move a little per sample, unlike the random keys above
+  auto time_mode = [&](Lookup::ThrottleLUTMode mode) {
+    lu.set_throttle_LUT_mode(mode);
+    int16_t throttle = 0;
+    int16_t rpm = 0;
+    float acc = 0.0f;
+    uint32_t start = now_us();
+    for (int i = 0; i < kIterations; i++) {
+      throttle = (throttle < 2035) ? static_cast<int16_t>(throttle + 13) : 0;
+      rpm = (rpm < 8997) ? static_cast<int16_t>(rpm + 3) : 0;
+      auto mods = lu.get_torque_mods(throttle, 2047, rpm, false);
+      acc += mods.first - mods.second;
+    }
+    uint32_t elapsed = now_us() - start;
+    sink = acc;
+    return static_cast<float>(elapsed) * 1000.0f / kIterations;
+  };
+  float interpolated = time_mode(Lookup::ThrottleLUTMode::kInterpolated);
+  float dense = time_mode(Lookup::ThrottleLUTMode::kDense);
+  float map = time_mode(Lookup::ThrottleLUTMode::kTorqueMap);
+  lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kDense);
+  report("torque mods, interpolated", interpolated);
+  report("torque mods, dense 1-D", dense);
+  report("torque mods, 2-D map", map);
+}
+
+#if defined(__AVX2__)
+static constexpr const char* kBatchPath = "AVX2";
+#elif defined(__SSE2__)
+static constexpr const char* kBatchPath = "SSE2";
+#else
+static constexpr const char* kBatchPath = "scalar";
+#endif
+
+void bench_batch_vs_scalar(void) {
+  TEST_MESSAGE(kBatchPath);
+  constexpr size_t kBatch = 4096;
+  static int16_t batch_keys[kBatch];
+  static float scalar_out[kBatch];
+  static float batch_out[kBatch];
+  for (size_t i = 0; i < kBatch; i++) {
+    batch_keys[i] = keys[i % kNumKeys];
+  }
+  const int rounds = kIterations / static_cast<int>(kBatch) + 1;
+
+  const FlatLUT& lut = lu.DefaultAccelThrottle2Modifier_LUT;
+  uint32_t start = now_us();
+  for (int round = 0; round < rounds; round++) {
+    lut.lookup_batch_scalar(batch_keys, scalar_out, kBatch);
+  }
+  float scalar_ns = static_cast<float>(now_us() - start) * 1000.0f / (rounds * kBatch);
+  start = now_us();
+  for (int round = 0; round < rounds; round++) {
+    lut.lookup_batch(batch_keys, batch_out, kBatch);
+  }
+  float batch_ns = static_cast<float>(now_us() - start) * 1000.0f / (rounds * kBatch);
+  for (size_t i = 0; i < kBatch; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, scalar_out[i], batch_out[i]);
+  }
+  report("table, scalar loop", scalar_ns);
+  report("table, batch", batch_ns);
+
+  // full pipeline on a replayed log
+  static Lookup::TorqueInputs inputs[kBatch];
+  static std::pair<int32_t, int32_t> reqs[kBatch];
+  for (size_t i = 0; i < kBatch; i++) {
+    inputs[i] = {batch_keys[i], 2047, static_cast<int16_t>(i * 2), false,
+                 static_cast<int16_t>(60 + i % 50), 40, static_cast<int16_t>(50 + i % 40)};
+  }
+  const int pipeline_rounds = rounds / 8 + 1;
+  start = now_us();
+  for (int round = 0; round < pipeline_rounds; round++) {
+    for (size_t i = 0; i < kBatch; i++) {
+      const Lookup::TorqueInputs& in = inputs[i];
+      reqs[i] = lu.get_torque_reqs_float(in.real_throttle, in.throttle_max, in.motor_rpm,
+                                         in.brake_pressed, in.igbt_temp, in.batt_temp,
+                                         in.motor_temp);
+    }
+  }
+  scalar_ns = static_cast<float>(now_us() - start) * 1000.0f / (pipeline_rounds * kBatch);
+  start = now_us();
+  for (int round = 0; round < pipeline_rounds; round++) {
+    lu.get_torque_reqs_batch(inputs, reqs, kBatch);
+  }
+  batch_ns = static_cast<float>(now_us() - start) * 1000.0f / (pipeline_rounds * kBatch);
+  report("torque pipeline, scalar loop", scalar_ns);
+  report("torque pipeline, batch", batch_ns);
+}
+
+#ifndef ARDUINO
+// calling thread's CPU time, so a second thread sharing the core is not billed to the control path
+static float thread_ns_per_call(float (*f)(int16_t)) {
+  timespec start;
+  timespec end;
+  float acc = 0.0f;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+  for (int i = 0; i < kIterations; i++) {
+    acc += f(keys[i % kNumKeys]);
+  }
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+  sink = acc;
+  return (static_cast<float>(end.tv_sec - start.tv_sec) * 1e9f +
+          static_cast<float>(end.tv_nsec - start.tv_nsec)) /
+         kIterations;
+}
+
+static float torque_mods_tick(int16_t key) {
+  int16_t throttle = static_cast<int16_t>(key < 0 ? 0 : key);
+  return lu.get_torque_mods(throttle, 2047, 3000, false).first;
+}
+
+// control path cost with the accel table idle vs. while another thread keeps uploading tables
+void bench_torque_mods_during_upload(void) {
+  float idle_ns = thread_ns_per_call(torque_mods_tick);
+
+  FlatLUT tables[2] = {FlatLUT{{0, 0.0f}, {1000, 0.5f}, {2047, 1.0f}},
+                       FlatLUT{{0, 0.0f}, {1000, 0.25f}, {2047, 1.0f}}};
+  std::atomic<bool> done{false};
+  std::atomic<int> installs{0};
+  constexpr auto kAccel = Lookup::TableID::kAccelThrottle2Modifier;
+  std::thread writer([&] {
+    for (int swap = 0; !done; swap++) {
+      if (lu.install_LUT(kAccel, tables[swap % 2], static_cast<uint8_t>(1 + swap % 2)) ==
+          Lookup::InstallResult::kInstalled) {
+        installs++;
+      }
+    }
+  });
+  float upload_ns = thread_ns_per_call(torque_mods_tick);
+  done = true;
+  writer.join();
+  lu.install_LUT(kAccel, lu.DefaultAccelThrottle2Modifier_LUT, 0);
+
+  report("torque mods, no upload", idle_ns);
+  report("torque mods, uploading", upload_ns);
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%d tables swapped in during the run", installs.load());
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(installs.load() > 0);
+}
+#endif
+
+int runUnityTests(void) {
+  uint32_t seed = 1;
+  for (int i = 0; i < kNumKeys; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    keys[i] = static_cast<int16_t>((seed >> 16) % 2200) - 50;
+  }
+
+  UNITY_BEGIN();
+  RUN_TEST(bench_slope_vs_division);
+  RUN_TEST(bench_uniform_grid_vs_search);
+  RUN_TEST(bench_cursor_vs_search);
+  RUN_TEST(bench_smooth_vs_linear);
+  RUN_TEST(bench_torque_map_vs_pipeline);
+  RUN_TEST(bench_batch_vs_scalar);
+#ifndef ARDUINO
+  RUN_TEST(bench_torque_mods_during_upload);
+#endif
+  return UNITY_END();
+}
+
+#ifdef ARDUINO
+void setup() {
+  delay(2000);  // wait for the serial monitor
+  runUnityTests();
+}
+void loop() {}
+#else
+int main() { return runUnityTests(); }
+#endif
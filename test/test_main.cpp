@@ -1,13 +1,58 @@
 #include <unity.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <map>
 
 #include "LUT.hpp"
+#include "cyclic_executive.hpp"
+#include "event_log.hpp"
+#include "pedal_acquisition.hpp"
+#include "spsc_snapshot.hpp"
+#include "stage_profiler.hpp"
+#include "torque_tx_schedule.hpp"
+#include "vehicle_snapshot.hpp"
+#include "wcet_harness.hpp"
+
+#ifndef ARDUINO
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+// native build only: count every heap allocation so the control loop can be checked for them
+static size_t heap_allocations = 0;
+
+void* operator new(size_t size) {
+  heap_allocations++;
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+#endif
 
 static MockCAN fake_can;
 static VirtualTimerGroup fake_timers;
 static Lookup lu(fake_can, fake_timers);
 
+static const FlatLUT& accel_LUT(void) {
+  return lu.table(Lookup::TableID::kAccelThrottle2Modifier);
+}
+static uint8_t accel_LUT_id(void) { return lu.LUT_id(Lookup::TableID::kAccelThrottle2Modifier); }
+static Lookup::InstallResult install_accel_LUT(const FlatLUT& lut, uint8_t lut_id) {
+  return lu.install_LUT(Lookup::TableID::kAccelThrottle2Modifier, lut, lut_id);
+}
+static const Lookup::CalibrationBank& active_calibration(void) {
+  return lu.banks[lu.active_bank.load()];
+}
+
 void setUp(void) {}
 void tearDown(void) {}
 
@@ -40,10 +85,88 @@ void test_lookup_interpolated_igbt(void) {
 
 // 8. Interpolated value for throttle LUT (halfway between 102 & 105)
 void test_lookup_interpolated_throttle(void) {
-  float v = lu.lookup(103, lu.AccelThrottle2Modifier_LUT);  // 0.03 → 0.09
+  float v = lu.lookup(103, accel_LUT());  // 0.03 → 0.09
   TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.030582524271844658, v);
 }
 
+// 8b. FlatLUT sorts its points and keeps the first value for a duplicate key (std::map behavior)
+void test_flat_lut_unsorted_input(void) {
+  FlatLUT lut{{100, 1.0f}, {0, 0.0f}, {50, 0.2f}, {50, 0.9f}};
+  TEST_ASSERT_EQUAL(3, lut.size());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.2f, lu.lookup(50, lut));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.6f, lu.lookup(75, lut));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, lu.lookup(-5, lut));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, lu.lookup(500, lut));
+}
+
+// 8c. Uniform grids are detected, including rounded keys and a uniform run followed by a tail point
+void test_flat_lut_uniform_grid_detection(void) {
+  TEST_ASSERT_EQUAL(16, lu.IGBTTemp2Modifier_LUT.grid_points);
+  TEST_ASSERT_EQUAL(21, lu.DefaultAccelThrottle2Modifier_LUT.grid_points);  // every ~102.35
+  TEST_ASSERT_EQUAL(14, lu.RPM2Throttle_LUT.grid_points);                   // 0-2600, then 10000
+  FlatLUT irregular{{0, 0.0f}, {7, 0.5f}, {8, 0.6f}, {50, 1.0f}};
+  TEST_ASSERT_EQUAL(0, irregular.grid_points);
+
+  // tail segment of RPM2Throttle_LUT is still found by search
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.245f, lu.lookup(6300, lu.RPM2Throttle_LUT));
+}
+
+// 8d. Segment cache: same results as an uncached lookup, neighbour segments count as hits
+void test_flat_lut_cursor(void) {
+  LUTCursor cursor;
+  for (int16_t temp = -10; temp <= 160; temp++) {
+    TEST_ASSERT_EQUAL_FLOAT(lu.lookup(temp, lu.IGBTTemp2Modifier_LUT),
+                            lu.lookup(temp, lu.IGBTTemp2Modifier_LUT, cursor));
+  }
+  // walking up one degree at a time never needs a search, clamped keys are not counted
+  TEST_ASSERT_EQUAL_UINT32(0, cursor.misses);
+  TEST_ASSERT_EQUAL_UINT32(149, cursor.hits);
+
+  // jumping back more than one segment does
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, lu.lookup(15, lu.IGBTTemp2Modifier_LUT, cursor));
+  TEST_ASSERT_EQUAL_UINT32(1, cursor.misses);
+}
+
+// 8e. SMOOTH_STEP: passes through every point, never overshoots, Q15 copy tracks the float curve
+void test_flat_lut_smooth_step(void) {
+  FlatLUT smooth{{{0, 0.0f}, {10, 0.2f}, {20, 0.9f}, {30, 1.0f}, {40, 1.0f}, {90, 0.5f}},
+                 InterpType::SMOOTH_STEP};
+  FlatLUT linear{{0, 0.0f}, {10, 0.2f}, {20, 0.9f}, {30, 1.0f}, {40, 1.0f}, {90, 0.5f}};
+  TEST_ASSERT_TRUE(smooth.interp_type() == InterpType::SMOOTH_STEP);
+  TEST_ASSERT_TRUE(smooth != linear);
+
+  for (size_t i = 0; i < smooth.size(); i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, smooth.value_at(i), smooth.lookup(smooth.key_at(i)));
+  }
+  // rising section bends away from the straight line, flat section stays flat
+  TEST_ASSERT_TRUE(fabsf(smooth.lookup(15) - linear.lookup(15)) > 0.01f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, smooth.lookup(35));
+
+  float previous = smooth.lookup(-5);
+  for (int16_t key = -5; key <= 100; key++) {
+    float value = smooth.lookup(key);
+    if (key <= 40) {
+      TEST_ASSERT_TRUE(value >= previous - 1e-6f);
+    } else {
+      TEST_ASSERT_TRUE(value <= previous + 1e-6f);
+    }
+    TEST_ASSERT_TRUE(value >= -1e-6f && value <= 1.0f + 1e-6f);
+    TEST_ASSERT_INT32_WITHIN(2, float_to_q15(value), smooth.lookup_q15(key));
+    previous = value;
+  }
+
+  // precomputed segments give the same curve as working each segment out per call
+  TEST_ASSERT_FALSE(smooth.has_cubics());
+  FlatLUT bound = smooth;
+  CubicSegments cubics;
+  bound.bind_cubics(cubics);
+  TEST_ASSERT_TRUE(bound.has_cubics());
+  for (int16_t key = -5; key <= 100; key++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, smooth.lookup(key), bound.lookup(key));
+    TEST_ASSERT_EQUAL_INT16(smooth.lookup_q15(key), bound.lookup_q15(key));
+  }
+}
+
 // -- Out of bound test for Pump Duty cycle --
 
 // 9. Motor below minimum LUT key (-50°C)
@@ -205,7 +328,7 @@ void test_torque_mods_exact_key(void) {
 }
 void test_torque_mods_interpolation(void) {
   auto mods = lu.get_torque_mods(1539, 2047, 0, false);
-  float exp = lu.lookup(1539, lu.AccelThrottle2Modifier_LUT);
+  float exp = lu.lookup(1539, accel_LUT());
   TEST_ASSERT_FLOAT_WITHIN(1e-3, exp, mods.first);
   TEST_ASSERT_FLOAT_WITHIN(1e-3, 0.0f, mods.second);
 }
@@ -216,7 +339,7 @@ void test_torque_mods_below_min_diff(void) {
 }
 void test_torque_mods_above_max_diff(void) {
   auto mods = lu.get_torque_mods(3000, 2047, 10000, false);
-  float exp = lu.lookup(2488, lu.AccelThrottle2Modifier_LUT);
+  float exp = lu.lookup(2488, accel_LUT());
   TEST_ASSERT_FLOAT_WITHIN(1e-6, exp, mods.first);
   TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, mods.second);
 }
@@ -228,25 +351,25 @@ void test_torque_mods_max_regen(void) {
 }
 void test_torque_mods_accel_normal(void) {
   auto mods = lu.get_torque_mods(500, 2047, 1000, false);
-  float exp = lu.lookup(111, lu.AccelThrottle2Modifier_LUT);
+  float exp = lu.lookup(111, accel_LUT());
   TEST_ASSERT_FLOAT_WITHIN(1e-3, exp, mods.first);
   TEST_ASSERT_FLOAT_WITHIN(1e-3, 0.0f, mods.second);
 }
 void test_torque_mods_fast_flooring(void) {
   auto mods = lu.get_torque_mods(2047, 2047, 10000, false);
-  float exp = lu.lookup(1535, lu.AccelThrottle2Modifier_LUT);
+  float exp = lu.lookup(1535, accel_LUT());
   TEST_ASSERT_FLOAT_WITHIN(1e-6, exp, mods.first);
   TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, mods.second);
 }
 void test_torque_mods_one_step(void) {
   auto mods = lu.get_torque_mods(1, 2047, 0, false);
-  float exp = lu.lookup(1, lu.AccelThrottle2Modifier_LUT);
+  float exp = lu.lookup(1, accel_LUT());
   TEST_ASSERT_FLOAT_WITHIN(1e-6, exp, mods.first);
   TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0, mods.second);
 }
 void test_torque_mods_high_step(void) {
   auto mods = lu.get_torque_mods(2046, 2047, 0, false);
-  float exp = lu.lookup(2046, lu.AccelThrottle2Modifier_LUT);
+  float exp = lu.lookup(2046, accel_LUT());
   TEST_ASSERT_FLOAT_WITHIN(1e-3, exp, mods.first);
   TEST_ASSERT_FLOAT_WITHIN(1e-3, 0.0f, mods.second);
 }
@@ -267,7 +390,1611 @@ void test_torque_mods_accel_brake_pressed(void) {
   TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, mods.first);
   TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, mods.second);
 }
+
+// Dense throttle tables must agree with the interpolating path over the whole throttle domain
+static float max_dense_deviation(void) {
+  float max_dev = 0.0f;
+  for (int16_t i = 0; i <= static_cast<int16_t>(Bounds::SENSOR_SCALED_MAX); i++) {
+    float accel_dev =
+        fabsf(active_calibration().dense().accel.lookup(i) - lu.lookup(i, accel_LUT()));
+    float regen_dev =
+        fabsf(active_calibration().dense().regen.lookup(i) -
+              lu.lookup(i, lu.table(Lookup::TableID::kRegenThrottle2Modifier)));
+    max_dev = std::max(max_dev, std::max(accel_dev, regen_dev));
+  }
+  return max_dev;
+}
+
+void test_dense_throttle_luts_match_interpolated(void) {
+  // 1 LSB of the Q16 modifier
+  TEST_ASSERT_TRUE(max_dense_deviation() <= 1.0f / 65536.0f);
+}
+
+void test_dense_throttle_luts_rebuilt_on_new_accel_lut(void) {
+  install_accel_LUT(FlatLUT{{0, 0.0f}, {1000, 0.5f}, {1500, 0.6f}, {2047, 1.0f}}, 1);
+  TEST_ASSERT_TRUE(max_dense_deviation() <= 1.0f / 65536.0f);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.25f, active_calibration().dense().accel.lookup(500));
+
+  install_accel_LUT(lu.DefaultAccelThrottle2Modifier_LUT, 0);
+  TEST_ASSERT_TRUE(max_dense_deviation() <= 1.0f / 65536.0f);
+}
+
+void test_torque_mods_dense_matches_interpolated(void) {
+  for (int16_t throttle = 0; throttle <= 2047; throttle += 7) {
+    lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kInterpolated);
+    auto interpolated = lu.get_torque_mods(throttle, 2047, 1000, false);
+    lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kDense);
+    auto dense = lu.get_torque_mods(throttle, 2047, 1000, false);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f / 65536.0f, interpolated.first, dense.first);
+    TEST_ASSERT_FLOAT_WITHIN(1.0f / 65536.0f, interpolated.second, dense.second);
+  }
+}
+
+void test_grid_lut_bilinear(void) {
+  static constexpr FlatLUT rows = FlatLUT::axis({0, 10});
+  static constexpr FlatLUT cols = FlatLUT::axis({0, 100, 300});
+  GridLUT<2, 3> grid{rows, cols};
+  grid.set(0, 0, 0.0f);
+  grid.set(0, 1, 1.0f);
+  grid.set(0, 2, 1.0f);
+  grid.set(1, 0, 0.5f);
+  grid.set(1, 1, -1.0f);
+  grid.set(1, 2, 0.0f);
+
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, -1.0f, grid.lookup(10, 100));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.5f, grid.lookup(0, 50));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.125f, grid.lookup(5, 50));  // mean of 0, 1, 0.5, -1
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.25f, grid.lookup(5, 200));
+  // clamps on both axes
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, grid.lookup(50, 1000));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.0f, grid.lookup(-5, -20));
+}
+
+// max |map - pipeline| of the signed modifier, over a grid of rpm starting at min_rpm
+static float max_torque_map_deviation(int16_t min_rpm) {
+  float max_deviation = 0.0f;
+  for (int16_t rpm = min_rpm; rpm <= 10500; rpm += 37) {
+    for (int16_t throttle = 0; throttle <= 2047; throttle += 5) {
+      lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kInterpolated);
+      auto pipeline = lu.get_torque_mods(throttle, 2047, rpm, false);
+      lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kTorqueMap);
+      auto map = lu.get_torque_mods(throttle, 2047, rpm, false);
+      float deviation = fabsf((pipeline.first - pipeline.second) - (map.first - map.second));
+      max_deviation = std::max(max_deviation, deviation);
+    }
+  }
+  lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kDense);
+  return max_deviation;
+}
+
+void test_torque_map_matches_pipeline(void) {
+  // exact on the grid points
+  lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kTorqueMap);
+  const auto& torque_map = active_calibration().torque_map();
+  for (size_t row = 0; row < torque_map.rows(); row++) {
+    for (size_t col = 0; col < torque_map.cols(); col++) {
+      int16_t rpm = torque_map.row_key(row);
+      int16_t throttle = torque_map.col_key(col);
+      lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kInterpolated);
+      auto pipeline = lu.get_torque_mods(throttle, 2047, rpm, false);
+      lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kTorqueMap);
+      auto map = lu.get_torque_mods(throttle, 2047, rpm, false);
+      TEST_ASSERT_FLOAT_WITHIN(1e-6, pipeline.first, map.first);
+      TEST_ASSERT_FLOAT_WITHIN(1e-6, pipeline.second, map.second);
+    }
+  }
+
+  // between them, away from the 200 - 400 rpm band where the zero torque point jumps off 0
+  // and the pipeline squeezes the whole regen curve into a few pedal counts
+  float deviation = max_torque_map_deviation(400);
+  char msg[64];
+  snprintf(msg, sizeof(msg), "torque map: max deviation %.4f above 400 rpm", deviation);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(deviation < 0.06f);
+
+  lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kTorqueMap);
+  auto braking = lu.get_torque_mods(2047, 2047, 3000, true);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, braking.first);
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, braking.second);
+  lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kDense);
+}
+
+void test_torque_map_rebuilt_on_new_accel_lut(void) {
+  install_accel_LUT(FlatLUT{{0, 0.0f}, {1000, 0.5f}, {1500, 0.6f}, {2047, 1.0f}}, 1);
+  TEST_ASSERT_TRUE(max_torque_map_deviation(400) < 0.06f);
+
+  install_accel_LUT(lu.DefaultAccelThrottle2Modifier_LUT, 0);
+  TEST_ASSERT_TRUE(max_torque_map_deviation(400) < 0.06f);
+}
+
+// a bank only keeps the throttle tables of the current mode, and never stale ones
+void test_throttle_tables_follow_mode(void) {
+  using Mode = Lookup::ThrottleLUTMode;
+  TEST_ASSERT_TRUE(std::holds_alternative<Lookup::DenseThrottleLUTs>(
+      *active_calibration().throttle_tables));
+  lu.set_throttle_LUT_mode(Mode::kTorqueMap);
+  for (const Lookup::CalibrationBank& bank : lu.banks) {
+    TEST_ASSERT_TRUE(bank.throttle_tables == nullptr ||
+                     std::holds_alternative<Lookup::TorqueMap>(*bank.throttle_tables));
+  }
+
+  // an update in kInterpolated drops the map, the next switch builds it from the new table
+  lu.set_throttle_LUT_mode(Mode::kInterpolated);
+  install_accel_LUT(FlatLUT{{0, 0.0f}, {1000, 0.5f}, {1500, 0.6f}, {2047, 1.0f}}, 1);
+  TEST_ASSERT_TRUE(
+      std::holds_alternative<std::monostate>(*active_calibration().throttle_tables));
+  auto pipeline = lu.get_torque_mods(1024, 2047, 0, false);
+  lu.set_throttle_LUT_mode(Mode::kTorqueMap);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, pipeline.first, lu.get_torque_mods(1024, 2047, 0, false).first);
+
+  install_accel_LUT(lu.DefaultAccelThrottle2Modifier_LUT, 0);
+  lu.set_throttle_LUT_mode(Mode::kDense);
+  TEST_ASSERT_TRUE(max_dense_deviation() <= 1.0f / 65536.0f);
+}
+
+void test_accel_LUT_install_rejects_invalid(void) {
+  // keys out of order, value above 1
+  FlatLUT unordered{{0, 0.0f}, {1500, 0.6f}, {1000, 0.5f}, {2047, 1.0f}};
+  FlatLUT too_large{{0, 0.0f}, {1000, 1.5f}, {2047, 1.0f}};
+  TEST_ASSERT_TRUE(install_accel_LUT(unordered, 1) == Lookup::InstallResult::kInvalid);
+  TEST_ASSERT_TRUE(install_accel_LUT(too_large, 1) == Lookup::InstallResult::kInvalid);
+  TEST_ASSERT_TRUE(install_accel_LUT(lu.DefaultAccelThrottle2Modifier_LUT, 0) ==
+                   Lookup::InstallResult::kUnchanged);
+  TEST_ASSERT_TRUE(accel_LUT() == lu.DefaultAccelThrottle2Modifier_LUT);
+  TEST_ASSERT_EQUAL(0, accel_LUT_id());
+}
+
+void test_accel_LUT_install_waits_for_pinned_bank(void) {
+  FlatLUT first{{0, 0.0f}, {1000, 0.5f}, {2047, 1.0f}};
+  FlatLUT second{{0, 0.0f}, {1000, 0.25f}, {2047, 1.0f}};
+  uint8_t default_bank = lu.active_bank.load();
+  TEST_ASSERT_TRUE(install_accel_LUT(first, 1) == Lookup::InstallResult::kInstalled);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.5f, lu.get_torque_mods(1000, 2047, 0, false).first);
+
+  // a control call that started before the swap is still reading the old bank
+  lu.pinned_bank.store(default_bank);
+  TEST_ASSERT_TRUE(install_accel_LUT(second, 2) == Lookup::InstallResult::kBusy);
+  TEST_ASSERT_TRUE(accel_LUT() == first);
+  TEST_ASSERT_EQUAL(1, accel_LUT_id());
+
+  lu.pinned_bank.store(Lookup::kNoBank);
+  TEST_ASSERT_TRUE(install_accel_LUT(second, 2) == Lookup::InstallResult::kInstalled);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.25f, lu.get_torque_mods(1000, 2047, 0, false).first);
+
+  install_accel_LUT(lu.DefaultAccelThrottle2Modifier_LUT, 0);
+}
+
+#ifndef ARDUINO
+// the control path must only ever see a complete calibration: its table, dense copy and ID from
+// the same upload, while another thread keeps swapping tables
+void test_accel_LUT_hot_swap_under_load(void) {
+  FlatLUT tables[2] = {FlatLUT{{0, 0.0f}, {1000, 0.5f}, {2047, 1.0f}},
+                       FlatLUT{{0, 0.0f}, {1000, 0.25f}, {2047, 1.0f}}};
+  std::atomic<bool> done{false};
+  std::thread writer([&] {
+    for (int swap = 0; swap < 2000; swap++) {
+      while (install_accel_LUT(tables[swap % 2], static_cast<uint8_t>(1 + swap % 2)) ==
+             Lookup::InstallResult::kBusy) {
+      }
+    }
+    done = true;
+  });
+
+  int torn = 0;
+  int reads = 0;
+  while (!done) {
+    Lookup::PinnedCalibration cal(lu);
+    float flat = cal->table(Lookup::TableID::kAccelThrottle2Modifier).lookup(1000);
+    float dense = cal->dense().accel.lookup(1000);
+    uint8_t lut_id = cal->lut_id(Lookup::TableID::kAccelThrottle2Modifier);
+    float id_value = lut_id == 2 ? 0.25f : 0.5f;
+    if (fabsf(flat - dense) > 1e-6f || (lut_id != 0 && fabsf(flat - id_value) > 1e-6f)) {
+      torn++;
+    }
+    reads++;
+  }
+  writer.join();
+  TEST_ASSERT_TRUE(reads > 0);
+  TEST_ASSERT_EQUAL(0, torn);
+
+  install_accel_LUT(lu.DefaultAccelThrottle2Modifier_LUT, 0);
+}
+#endif
+
+// an encoded upload of one table, as the DAQ sends it
+struct TestUpload {
+  LUTUploadHeader header;
+  uint8_t payload[LUTUploadReceiver::kMaxPayload] = {};
+
+  size_t segments() const {
+    return (header.payload_length + LUTUploadReceiver::kSegmentBytes - 1) /
+           LUTUploadReceiver::kSegmentBytes;
+  }
+};
+
+static TestUpload make_lut_upload(uint8_t table, uint8_t sequence, uint8_t lut_id,
+                                  const LUTUploadPoint* points, uint8_t num_points,
+                                  bool corrupt_crc = false) {
+  TestUpload upload;
+  upload.header.table = table;
+  upload.header.file_status = FileStatus::FILE_PRESENT_AND_VALID;
+  upload.header.sequence = sequence;
+  upload.header.num_pairs = num_points;
+  upload.header.interp_type = InterpType::LINEAR;
+  upload.header.lut_id = lut_id;
+  upload.header.payload_length = static_cast<uint8_t>(
+      LUTUploadReceiver::encode(points, num_points, upload.payload, sizeof(upload.payload)));
+  upload.header.crc =
+      LUTUploadReceiver::crc16(upload.header, upload.payload) ^ (corrupt_crc ? 1u : 0u);
+  return upload;
+}
+
+static void send_lut_segment(LUTUploadReceiver& receiver, const TestUpload& upload,
+                             size_t segment) {
+  uint8_t data[LUTUploadReceiver::kSegmentBytes] = {};
+  for (size_t i = 0; i < LUTUploadReceiver::kSegmentBytes; i++) {
+    size_t offset = segment * LUTUploadReceiver::kSegmentBytes + i;
+    if (offset < upload.header.payload_length) {
+      data[i] = upload.payload[offset];
+    }
+  }
+  receiver.on_segment(upload.header.table, upload.header.sequence, static_cast<uint8_t>(segment),
+                      data);
+}
+
+// header then segments, last segment first
+static void send_lut_upload(LUTUploadReceiver& receiver, const TestUpload& upload) {
+  receiver.on_header(upload.header);
+  for (size_t segment = upload.segments(); segment-- > 0;) {
+    send_lut_segment(receiver, upload, segment);
+  }
+}
+
+// a table as upload points, values rounded to hundredths
+static uint8_t to_upload_points(const FlatLUT& lut, LUTUploadPoint* points) {
+  for (size_t i = 0; i < lut.size(); i++) {
+    points[i].key = lut.key_at(i);
+    points[i].value = static_cast<int16_t>(roundf(lut.value_at(i) * 100.0f));
+  }
+  return static_cast<uint8_t>(lut.size());
+}
+
+static const LUTUploadPoint kUploadPoints[5] = {
+    {0, 0}, {500, 20}, {1000, 50}, {1500, 60}, {2047, 100}};
+
+void test_lut_upload_encoding_round_trip(void) {
+  LUTUploadPoint points[kMaxLUTPoints];
+  uint8_t n = to_upload_points(lu.RPM2Throttle_LUT, points);
+  uint8_t payload[LUTUploadReceiver::kMaxPayload];
+  size_t length = LUTUploadReceiver::encode(points, n, payload, sizeof(payload));
+  TEST_ASSERT_TRUE(length > 0);
+  // smooth curve: well under 4 bytes per point
+  TEST_ASSERT_TRUE(length < 3u * n);
+
+  LUTUploadPoint decoded[kMaxLUTPoints];
+  TEST_ASSERT_TRUE(LUTUploadReceiver::decode(payload, length, decoded, n));
+  for (size_t i = 0; i < n; i++) {
+    TEST_ASSERT_EQUAL(points[i].key, decoded[i].key);
+    TEST_ASSERT_EQUAL(points[i].value, decoded[i].value);
+  }
+
+  // extremes survive, truncated or padded payloads don't decode
+  const LUTUploadPoint extremes[2] = {{INT16_MIN, INT16_MAX}, {INT16_MAX, INT16_MIN}};
+  length = LUTUploadReceiver::encode(extremes, 2, payload, sizeof(payload));
+  TEST_ASSERT_TRUE(LUTUploadReceiver::decode(payload, length, decoded, 2));
+  TEST_ASSERT_EQUAL(INT16_MIN, decoded[0].key);
+  TEST_ASSERT_EQUAL(INT16_MIN, decoded[1].value);
+  TEST_ASSERT_FALSE(LUTUploadReceiver::decode(payload, length - 1, decoded, 2));
+  TEST_ASSERT_FALSE(LUTUploadReceiver::decode(payload, length, decoded, 1));
+
+  // keys must increase
+  const LUTUploadPoint unordered[2] = {{10, 0}, {10, 1}};
+  TEST_ASSERT_EQUAL(0, LUTUploadReceiver::encode(unordered, 2, payload, sizeof(payload)));
+}
+
+void test_lut_upload_commits_once_complete(void) {
+  LUTUploadReceiver receiver;
+  TestUpload upload = make_lut_upload(4, 1, 7, kUploadPoints, 5);
+  TEST_ASSERT_TRUE(upload.segments() > 1);
+  send_lut_upload(receiver, upload);
+  const LUTUpload* committed = receiver.committed();
+  TEST_ASSERT_NOT_NULL(committed);
+  TEST_ASSERT_EQUAL(4, committed->table);
+  TEST_ASSERT_EQUAL(7, committed->lut_id);
+  FlatLUT lut = committed->lut();
+  TEST_ASSERT_EQUAL(5, lut.size());
+  TEST_ASSERT_TRUE(lut.is_valid());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.55f, lut.lookup(1250));
+
+  // the DAQ keeps repeating the same upload: no second commit, nothing rebuilt
+  receiver.release(4);
+  send_lut_upload(receiver, upload);
+  TEST_ASSERT_NULL(receiver.committed());
+  TEST_ASSERT_EQUAL(1, receiver.stats().commits);
+}
+
+void test_lut_upload_never_mixes_sequences(void) {
+  LUTUploadReceiver receiver;
+  TestUpload first = make_lut_upload(4, 1, 1, kUploadPoints, 5);
+  receiver.on_header(first.header);
+  send_lut_segment(receiver, first, 0);
+
+  // a new upload of the table starts before the first one finished, then a late segment of the
+  // first arrives
+  const LUTUploadPoint second_points[3] = {{0, 0}, {1000, 30}, {2047, 90}};
+  send_lut_upload(receiver, make_lut_upload(4, 2, 2, second_points, 3));
+  send_lut_segment(receiver, first, 1);
+
+  const LUTUpload* upload = receiver.committed();
+  TEST_ASSERT_NOT_NULL(upload);
+  TEST_ASSERT_EQUAL(2, upload->lut_id);
+  TEST_ASSERT_EQUAL(3, upload->num_points);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.3f, upload->lut().lookup(1000));
+  TEST_ASSERT_EQUAL(1, receiver.stats().stale_segments);
+}
+
+void test_lut_upload_interleaves_tables(void) {
+  LUTUploadReceiver receiver;
+  const LUTUploadPoint regen_points[3] = {{0, 0}, {1000, 40}, {2047, 80}};
+  TestUpload accel = make_lut_upload(4, 3, 11, kUploadPoints, 5);
+  TestUpload regen = make_lut_upload(5, 3, 12, regen_points, 3);
+  receiver.on_header(regen.header);
+  receiver.on_header(accel.header);
+  for (size_t segment = 0; segment < std::max(accel.segments(), regen.segments()); segment++) {
+    if (segment < accel.segments()) {
+      send_lut_segment(receiver, accel, segment);
+    }
+    if (segment < regen.segments()) {
+      send_lut_segment(receiver, regen, segment);
+    }
+  }
+
+  TEST_ASSERT_EQUAL(2, receiver.stats().commits);
+  TEST_ASSERT_EQUAL(0, receiver.stats().stale_segments);
+  const LUTUpload* upload = receiver.committed();
+  TEST_ASSERT_NOT_NULL(upload);
+  TEST_ASSERT_EQUAL(4, upload->table);
+  TEST_ASSERT_EQUAL(11, upload->lut_id);
+  receiver.release(4);
+  upload = receiver.committed();
+  TEST_ASSERT_NOT_NULL(upload);
+  TEST_ASSERT_EQUAL(5, upload->table);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.4f, upload->lut().lookup(1000));
+  receiver.release(5);
+  TEST_ASSERT_NULL(receiver.committed());
+}
+
+void test_lut_upload_rejects_bad_crc(void) {
+  LUTUploadReceiver receiver;
+  send_lut_upload(receiver, make_lut_upload(4, 1, 3, kUploadPoints, 5, true));
+  TEST_ASSERT_NULL(receiver.committed());
+  TEST_ASSERT_EQUAL(1, receiver.stats().crc_errors);
+
+  send_lut_upload(receiver, make_lut_upload(4, 2, 3, kUploadPoints, 5));
+  TEST_ASSERT_NOT_NULL(receiver.committed());
+}
+
+// a lone header resets a table to its default: it needs a good CRC, which covers file_status
+void test_lut_upload_checks_no_file_header(void) {
+  LUTUploadReceiver receiver;
+  LUTUploadHeader no_file;
+  no_file.table = 4;
+  no_file.file_status = FileStatus::FILE_NOT_PRESENT;
+  no_file.sequence = 2;
+  receiver.on_header(no_file);
+  TEST_ASSERT_NULL(receiver.committed());
+  TEST_ASSERT_EQUAL(1, receiver.stats().crc_errors);
+
+  // a valid upload's header with only file_status flipped on the way
+  TestUpload upload = make_lut_upload(4, 3, 7, kUploadPoints, 5);
+  LUTUploadHeader flipped = upload.header;
+  flipped.file_status = FileStatus::FILE_NOT_PRESENT;
+  flipped.payload_length = 0;
+  flipped.crc = LUTUploadReceiver::crc16(upload.header, upload.payload);
+  receiver.on_header(flipped);
+  TEST_ASSERT_NULL(receiver.committed());
+  TEST_ASSERT_EQUAL(2, receiver.stats().crc_errors);
+
+  // the rejected header wasn't remembered: the good repeat still commits
+  no_file.crc = LUTUploadReceiver::crc16(no_file, nullptr);
+  receiver.on_header(no_file);
+  const LUTUpload* committed = receiver.committed();
+  TEST_ASSERT_NOT_NULL(committed);
+  TEST_ASSERT_TRUE(committed->file_status == FileStatus::FILE_NOT_PRESENT);
+}
+
+// a new upload that reuses the table's last sequence is refused and NAKed on 0x20A, repeats of
+// the accepted one are not
+void test_lut_upload_naks_reused_sequence(void) {
+  LUTUploadReceiver& receiver = lu.lut_can.receiver;
+  send_lut_upload(receiver, make_lut_upload(4, 13, 8, kUploadPoints, 5));
+  lu.updateCANLUTs();
+  TEST_ASSERT_EQUAL(8, accel_LUT_id());
+  send_lut_upload(receiver, make_lut_upload(4, 13, 8, kUploadPoints, 5));
+  uint8_t table;
+  uint8_t lut_id;
+  TEST_ASSERT_FALSE(receiver.take_rejected(table, lut_id));
+
+  const LUTUploadPoint other_points[3] = {{0, 0}, {1000, 30}, {2047, 90}};
+  uint32_t reuses = receiver.stats().sequence_reuses;
+  send_lut_upload(receiver, make_lut_upload(4, 13, 9, other_points, 3));
+  TEST_ASSERT_EQUAL(reuses + 1, receiver.stats().sequence_reuses);
+  lu.updateCANLUTs();
+  TEST_ASSERT_EQUAL(8, accel_LUT_id());
+  TEST_ASSERT_EQUAL(4, static_cast<uint8_t>(lu.lut_can.upload_table_response));
+  TEST_ASSERT_EQUAL(9, static_cast<uint8_t>(lu.lut_can.upload_lut_id_response));
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(Lookup::InstallResult::kSequenceReused),
+                    static_cast<uint8_t>(lu.lut_can.upload_result_response));
+  TEST_ASSERT_FALSE(receiver.take_rejected(table, lut_id));
+
+  install_accel_LUT(lu.DefaultAccelThrottle2Modifier_LUT, 0);
+}
+
+// tables uploaded together are published together, and a pump table with keys of its own still
+// gives the same duty cycle through the thermal frame
+void test_lut_upload_installs_on_commit(void) {
+  using TableID = Lookup::TableID;
+  const LUTUploadPoint regen_points[3] = {{0, 0}, {1000, 40}, {2047, 80}};
+  const LUTUploadPoint pump_points[3] = {{0, 0}, {45, 50}, {90, 100}};
+  uint32_t generation = active_calibration().generation;
+  LUTUploadReceiver& receiver = lu.lut_can.receiver;
+  send_lut_upload(receiver, make_lut_upload(4, 9, 4, kUploadPoints, 5));
+  send_lut_upload(receiver, make_lut_upload(5, 9, 5, regen_points, 3));
+  send_lut_upload(receiver, make_lut_upload(7, 9, 6, pump_points, 3));
+  // no such table
+  send_lut_upload(receiver, make_lut_upload(12, 9, 7, kUploadPoints, 5));
+  lu.updateCANLUTs();
+
+  TEST_ASSERT_NULL(lu.lut_can.committed_upload());
+  TEST_ASSERT_TRUE(active_calibration().generation > generation);
+  TEST_ASSERT_EQUAL(4, accel_LUT_id());
+  TEST_ASSERT_EQUAL(5, lu.LUT_id(TableID::kRegenThrottle2Modifier));
+  TEST_ASSERT_EQUAL(6, lu.LUT_id(TableID::kMotorTemp2PumpDutyCycle));
+  TEST_ASSERT_EQUAL(4, static_cast<uint8_t>(lu.lut_can.accel_lut_id_response));
+  TEST_ASSERT_EQUAL(12, static_cast<uint8_t>(lu.lut_can.upload_table_response));
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(Lookup::InstallResult::kInvalid),
+                    static_cast<uint8_t>(lu.lut_can.upload_result_response));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.55f, accel_LUT().lookup(1250));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.4f, active_calibration().dense().regen.lookup(1000));
+  TEST_ASSERT_FALSE(active_calibration().pump_keys_shared);
+  for (int16_t motor_temp = 0; motor_temp <= 100; motor_temp += 5) {
+    Lookup::ThermalFrame frame = lu.calculate_thermal_frame(motor_temp, 30, 30, 25.0f);
+    TEST_ASSERT_EQUAL(lu.calculate_pump_duty_cycle(motor_temp, 30, 30), frame.pump_duty_cycle);
+  }
+
+  // DAQ reports no files: back to the built in defaults
+  for (uint8_t table : {4, 5, 7}) {
+    LUTUploadHeader no_file;
+    no_file.table = table;
+    no_file.file_status = FileStatus::FILE_NOT_PRESENT;
+    no_file.sequence = 10;
+    no_file.crc = LUTUploadReceiver::crc16(no_file, nullptr);
+    receiver.on_header(no_file);
+  }
+  lu.updateCANLUTs();
+  for (uint8_t id = 0; id < static_cast<uint8_t>(TableID::kCount); id++) {
+    auto table_id = static_cast<TableID>(id);
+    TEST_ASSERT_EQUAL(0, lu.LUT_id(table_id));
+    TEST_ASSERT_TRUE(lu.table(table_id) == Lookup::default_table(table_id));
+  }
+  TEST_ASSERT_TRUE(active_calibration().pump_keys_shared);
+}
+
+// frames on the bus for the whole default calibration, against one header plus one frame per two
+// 4 byte points
+void test_lut_upload_bus_time(void) {
+  size_t frames = 0;
+  size_t pair_frames = 0;
+  for (uint8_t id = 0; id < static_cast<uint8_t>(Lookup::TableID::kCount); id++) {
+    LUTUploadPoint points[kMaxLUTPoints];
+    uint8_t n = to_upload_points(Lookup::default_table(static_cast<Lookup::TableID>(id)), points);
+    TestUpload upload = make_lut_upload(id, 1, 1, points, n);
+    TEST_ASSERT_TRUE(upload.header.payload_length > 0);
+    frames += 1 + upload.segments();
+    pair_frames += 1 + (n + 1) / 2;
+  }
+  char msg[80];
+  snprintf(msg, sizeof(msg), "full calibration: %u frames, %u with fixed 4 byte points",
+           static_cast<unsigned>(frames), static_cast<unsigned>(pair_frames));
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(frames < pair_frames);
+}
+
+#ifndef ARDUINO
+void test_lut_upload_allocation_free(void) {
+  LUTUploadReceiver receiver;
+  size_t before = heap_allocations;
+  for (uint8_t sequence = 1; sequence <= 20; sequence++) {
+    send_lut_upload(receiver, make_lut_upload(4, sequence % 16, 1, kUploadPoints, 5));
+    receiver.release(4);
+  }
+  TEST_ASSERT_EQUAL(0, heap_allocations - before);
+  TEST_ASSERT_EQUAL(20, receiver.stats().commits);
+}
+#endif
+
+// Drive profiles
+// puts a profile back to the base calibration it starts with
+static void reset_profile(Lookup::DriveProfile profile) {
+  lu.begin_calibration_update(profile);
+  for (uint8_t id = 0; id < lu.kNumTables; id++) {
+    Lookup::TableID table_id = static_cast<Lookup::TableID>(id);
+    lu.stage_LUT(table_id, Lookup::default_table(table_id), 0);
+  }
+  lu.publish_calibration_update();
+}
+
+void test_profile_switch_from_can(void) {
+  using TableID = Lookup::TableID;
+  using DriveProfile = Lookup::DriveProfile;
+  const Lookup::CalibrationBank* autocross = &active_calibration();
+
+  lu.lut_can.requested_profile = static_cast<uint8_t>(DriveProfile::kWet);
+  lu.updateCANLUTs();
+  TEST_ASSERT_TRUE(lu.active_profile() == DriveProfile::kWet);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(DriveProfile::kWet),
+                    static_cast<uint8_t>(lu.lut_can.active_profile_response));
+  // its own bank, a copy of the base calibration until its tables are uploaded
+  TEST_ASSERT_TRUE(&active_calibration() != autocross);
+  for (uint8_t id = 0; id < lu.kNumTables; id++) {
+    TableID table_id = static_cast<TableID>(id);
+    TEST_ASSERT_TRUE(lu.table(table_id) == Lookup::default_table(table_id));
+    TEST_ASSERT_EQUAL(0, lu.LUT_id(table_id));
+  }
+  // derived data is built from the profile's tables: the dense copy and torque map agree
+  FlatLUT wet_accel{{0, 0.0f}, {819, 0.2f}, {1638, 0.6f}, {2047, 0.7f}};
+  install_accel_LUT(wet_accel, 3);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, wet_accel.lookup(1000),
+                           active_calibration().dense().accel.lookup(1000));
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.7f, lu.get_torque_mods(2047, 2047, 0, false).first);
+
+  // an out of range profile and a repeat leave the profile as it is
+  lu.lut_can.requested_profile = 7;
+  lu.updateCANLUTs();
+  TEST_ASSERT_TRUE(lu.active_profile() == DriveProfile::kWet);
+
+  // switching back is one index store, the autocross bank was never touched
+  lu.request_profile(DriveProfile::kAutocross);
+  lu.updateCANLUTs();
+  TEST_ASSERT_TRUE(&active_calibration() == autocross);
+  TEST_ASSERT_TRUE(accel_LUT() == lu.DefaultAccelThrottle2Modifier_LUT);
+  TEST_ASSERT_EQUAL(0, static_cast<uint8_t>(lu.lut_can.active_profile_response));
+  reset_profile(DriveProfile::kWet);
+}
+
+// a control cycle in flight keeps its profile, the switch shows from the next cycle on
+void test_profile_switch_at_cycle_boundary(void) {
+  using DriveProfile = Lookup::DriveProfile;
+  // an endurance calibration: accel capped at 85 %, battery derated from 45 degC
+  lu.begin_calibration_update(DriveProfile::kEndurance);
+  lu.stage_LUT(Lookup::TableID::kAccelThrottle2Modifier,
+               FlatLUT{{0, 0.0f}, {1024, 0.55f}, {2047, 0.85f}}, 2);
+  lu.stage_LUT(Lookup::TableID::kBatteryTemp2Modifier,
+               FlatLUT{{0, 1.0f}, {45, 0.9f}, {50, 0.6f}, {60, 0.0f}}, 2);
+  lu.publish_calibration_update();
+
+  lu.begin_control_cycle();
+  float autocross = lu.get_torque_mods(2047, 2047, 0, false).first;
+  lu.request_profile(DriveProfile::kEndurance);
+  lu.updateCANLUTs();
+  TEST_ASSERT_TRUE(lu.active_profile() == DriveProfile::kEndurance);
+  TEST_ASSERT_EQUAL_FLOAT(autocross, lu.get_torque_mods(2047, 2047, 0, false).first);
+  lu.end_control_cycle();
+
+  lu.begin_control_cycle();
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.85f, lu.get_torque_mods(2047, 2047, 0, false).first);
+  lu.end_control_cycle();
+
+  // the temp derating cache is keyed on the calibration, not only the readings
+  lu.request_profile(DriveProfile::kAutocross);
+  lu.updateCANLUTs();
+  float autocross_derate = lu.calculate_temp_mod(20, 50, 20);
+  lu.request_profile(DriveProfile::kEndurance);
+  lu.updateCANLUTs();
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.6f, lu.calculate_temp_mod(20, 50, 20));
+  lu.request_profile(DriveProfile::kAutocross);
+  lu.updateCANLUTs();
+  TEST_ASSERT_EQUAL_FLOAT(autocross_derate, lu.calculate_temp_mod(20, 50, 20));
+  reset_profile(DriveProfile::kEndurance);
+}
+
+// uploads land in the profile that is active, the others keep their tables
+void test_profile_upload_targets_active_profile(void) {
+  using DriveProfile = Lookup::DriveProfile;
+  LUTUploadReceiver& receiver = lu.lut_can.receiver;
+  lu.request_profile(DriveProfile::kWet);
+  lu.updateCANLUTs();
+  send_lut_upload(receiver, make_lut_upload(4, 11, 8, kUploadPoints, 5));
+  lu.updateCANLUTs();
+  TEST_ASSERT_EQUAL(8, accel_LUT_id());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.55f, accel_LUT().lookup(1250));
+
+  lu.request_profile(DriveProfile::kAutocross);
+  lu.updateCANLUTs();
+  TEST_ASSERT_EQUAL(0, accel_LUT_id());
+  TEST_ASSERT_TRUE(accel_LUT() == lu.DefaultAccelThrottle2Modifier_LUT);
+
+  // no file: back to the flash default, which every profile shares
+  lu.request_profile(DriveProfile::kWet);
+  lu.updateCANLUTs();
+  TEST_ASSERT_EQUAL(8, accel_LUT_id());
+  LUTUploadHeader no_file;
+  no_file.table = 4;
+  no_file.file_status = FileStatus::FILE_NOT_PRESENT;
+  no_file.sequence = 12;
+  no_file.crc = LUTUploadReceiver::crc16(no_file, nullptr);
+  receiver.on_header(no_file);
+  lu.updateCANLUTs();
+  TEST_ASSERT_EQUAL(0, accel_LUT_id());
+  TEST_ASSERT_TRUE(accel_LUT() == lu.DefaultAccelThrottle2Modifier_LUT);
+
+  lu.request_profile(DriveProfile::kAutocross);
+  lu.updateCANLUTs();
+}
+
+// only the active bank and the one it replaced have throttle tables, a switch that needs the
+// pinned bank's slot waits for that control call
+void test_profile_switch_waits_for_throttle_slot(void) {
+  using DriveProfile = Lookup::DriveProfile;
+  uint8_t autocross = lu.active_bank.load();
+  lu.request_profile(DriveProfile::kWet);
+  lu.updateCANLUTs();
+  lu.pinned_bank.store(autocross);
+  lu.request_profile(DriveProfile::kEndurance);
+  lu.updateCANLUTs();
+  TEST_ASSERT_TRUE(lu.active_profile() == DriveProfile::kWet);
+
+  lu.pinned_bank.store(lu.kNoBank);
+  lu.updateCANLUTs();
+  TEST_ASSERT_TRUE(lu.active_profile() == DriveProfile::kEndurance);
+  TEST_ASSERT_NULL(lu.banks[autocross].throttle_tables);
+  uint8_t with_tables = 0;
+  for (const Lookup::CalibrationBank& bank : lu.banks) {
+    with_tables += bank.throttle_tables != nullptr ? 1 : 0;
+  }
+  TEST_ASSERT_EQUAL(lu.kNumThrottleSlots, with_tables);
+  TEST_ASSERT_TRUE(max_dense_deviation() <= 1.0f / 65536.0f);
+
+  lu.request_profile(DriveProfile::kAutocross);
+  lu.updateCANLUTs();
+  TEST_ASSERT_TRUE(lu.active_profile() == DriveProfile::kAutocross);
+  TEST_ASSERT_TRUE(max_dense_deviation() <= 1.0f / 65536.0f);
+}
+
+#ifndef ARDUINO
+static const char* kStorePath = "lut_store_test.bin";
+
+static void corrupt_store_byte(long offset) {
+  FILE* file = fopen(kStorePath, "r+b");
+  TEST_ASSERT_NOT_NULL(file);
+  fseek(file, offset, SEEK_SET);
+  int byte = fgetc(file);
+  fseek(file, offset, SEEK_SET);
+  fputc(byte ^ 0xFF, file);
+  fclose(file);
+}
+
+void test_lut_store_round_trip(void) {
+  using TableID = Lookup::TableID;
+  std::remove(kStorePath);
+  LUTStore store(kStorePath, lu.kNumTables, lu.kNumProfiles);
+  TEST_ASSERT_NULL(store.load());
+  TEST_ASSERT_FALSE(lu.load_calibration(store));
+
+  FlatLUT accel{{0, 0.0f}, {1000, 0.5f}, {2047, 1.0f}};
+  install_accel_LUT(accel, 5);
+  TEST_ASSERT_TRUE(lu.save_calibration(store));
+  // nothing new to save
+  TEST_ASSERT_FALSE(lu.save_calibration(store));
+
+  // the image holds every profile's tables as they are, autocross first
+  const LUTStoreImage* image = store.load();
+  TEST_ASSERT_NOT_NULL(image);
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(TableID::kCount) * lu.kNumProfiles,
+                    image->header.num_luts);
+  TEST_ASSERT_TRUE(image->luts[static_cast<size_t>(TableID::kAccelThrottle2Modifier)].lut == accel);
+  const StoredLUT& wet_accel =
+      image->luts[static_cast<size_t>(Lookup::DriveProfile::kWet) * lu.kNumTables +
+                  static_cast<size_t>(TableID::kAccelThrottle2Modifier)];
+  TEST_ASSERT_EQUAL(static_cast<uint8_t>(Lookup::DriveProfile::kWet), wet_accel.profile);
+  TEST_ASSERT_TRUE(wet_accel.lut == lu.DefaultAccelThrottle2Modifier_LUT);
+
+  // next power cycle
+  static Lookup rebooted(fake_can, fake_timers);
+  LUTStore boot_store(kStorePath, lu.kNumTables, lu.kNumProfiles);
+  TEST_ASSERT_TRUE(rebooted.load_calibration(boot_store));
+  TEST_ASSERT_EQUAL(5, rebooted.LUT_id(TableID::kAccelThrottle2Modifier));
+  TEST_ASSERT_TRUE(rebooted.table(TableID::kAccelThrottle2Modifier) == accel);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.5f, rebooted.get_torque_mods(1000, 2047, 0, false).first);
+  TEST_ASSERT_EQUAL(0, rebooted.LUT_id(TableID::kRegenThrottle2Modifier));
+  TEST_ASSERT_FALSE(rebooted.save_calibration(boot_store));
+  // a smooth table comes back with its cubic segments rebuilt in the bank
+  FlatLUT smooth_accel{{{0, 0.0f}, {1000, 0.3f}, {2047, 1.0f}}, InterpType::SMOOTH_STEP};
+  TEST_ASSERT_EQUAL(Lookup::InstallResult::kInstalled,
+                    rebooted.install_LUT(TableID::kAccelThrottle2Modifier, smooth_accel, 6));
+  TEST_ASSERT_TRUE(rebooted.table(TableID::kAccelThrottle2Modifier).has_cubics());
+  TEST_ASSERT_FALSE(rebooted.table(TableID::kRegenThrottle2Modifier).has_cubics());
+  TEST_ASSERT_TRUE(rebooted.save_calibration(boot_store));
+  static Lookup rebooted_again(fake_can, fake_timers);
+  TEST_ASSERT_TRUE(rebooted_again.load_calibration(boot_store));
+  const FlatLUT& reloaded = rebooted_again.table(TableID::kAccelThrottle2Modifier);
+  TEST_ASSERT_TRUE(reloaded == smooth_accel);
+  TEST_ASSERT_TRUE(reloaded.has_cubics());
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, smooth_accel.lookup(700), reloaded.lookup(700));
+  // an upload to another profile is kept for that profile only
+  rebooted.request_profile(Lookup::DriveProfile::kEndurance);
+  rebooted.updateCANLUTs();
+  TEST_ASSERT_EQUAL(0, rebooted.LUT_id(TableID::kAccelThrottle2Modifier));
+  TEST_ASSERT_TRUE(rebooted.table(TableID::kAccelThrottle2Modifier) ==
+                   rebooted.DefaultAccelThrottle2Modifier_LUT);
+
+  install_accel_LUT(lu.DefaultAccelThrottle2Modifier_LUT, 0);
+  std::remove(kStorePath);
+}
+
+void test_lut_store_keeps_previous_image(void) {
+  std::remove(kStorePath);
+  LUTStore store(kStorePath, lu.kNumTables, lu.kNumProfiles);
+  install_accel_LUT(FlatLUT{{0, 0.0f}, {1000, 0.5f}, {2047, 1.0f}}, 5);
+  TEST_ASSERT_TRUE(lu.save_calibration(store));
+  install_accel_LUT(FlatLUT{{0, 0.0f}, {1000, 0.25f}, {2047, 1.0f}}, 6);
+  TEST_ASSERT_TRUE(lu.save_calibration(store));
+  TEST_ASSERT_EQUAL(2, store.load()->header.sequence);
+
+  // a write of the second slot that never finished: the first image is loaded
+  long second_slot = static_cast<long>(LUTStore::kSlotSize);
+  corrupt_store_byte(second_slot + static_cast<long>(offsetof(LUTStoreImage, luts)) + 100);
+  const LUTStoreImage* image = store.load();
+  TEST_ASSERT_NOT_NULL(image);
+  TEST_ASSERT_EQUAL(1, image->header.sequence);
+  TEST_ASSERT_TRUE(lu.load_calibration(store));
+  TEST_ASSERT_EQUAL(5, accel_LUT_id());
+
+  // an image from firmware with another table layout
+  static LUTStoreImage other_version;
+  other_version = *image;
+  other_version.header.version++;
+  other_version.header.crc = LUTStore::crc32(other_version.header, other_version.luts);
+  TEST_ASSERT_FALSE(store.is_valid(other_version));
+  // a table this firmware doesn't have, under a good CRC
+  other_version = *image;
+  other_version.luts[3].table = static_cast<uint8_t>(lu.kNumTables);
+  other_version.header.crc = LUTStore::crc32(other_version.header, other_version.luts);
+  TEST_ASSERT_FALSE(store.is_valid(other_version));
+  other_version.luts[3].table = 0;
+  other_version.luts[3].profile = static_cast<uint8_t>(lu.kNumProfiles);
+  other_version.header.crc = LUTStore::crc32(other_version.header, other_version.luts);
+  TEST_ASSERT_FALSE(store.is_valid(other_version));
+  TEST_ASSERT_TRUE(store.is_valid(*image));
+
+  // both slots bad: defaults stay
+  install_accel_LUT(lu.DefaultAccelThrottle2Modifier_LUT, 0);
+  corrupt_store_byte(4);
+  TEST_ASSERT_NULL(store.load());
+  TEST_ASSERT_FALSE(lu.load_calibration(store));
+  TEST_ASSERT_EQUAL(0, accel_LUT_id());
+  std::remove(kStorePath);
+}
+#endif
+
+// Cyclic executive, on the simulated clock
+static char executive_trace[64];
+static size_t executive_trace_length = 0;
+static uint32_t slow_task_us = 0;
+
+static void trace_task(char id, uint32_t exec_us) {
+  if (executive_trace_length < sizeof(executive_trace) - 1) {
+    executive_trace[executive_trace_length++] = id;
+    executive_trace[executive_trace_length] = '\0';
+  }
+  SimulatedClock::advance(exec_us);
+}
+static void fast_task(void) { trace_task('f', 100); }
+static void control_task(void) { trace_task('c', 300); }
+static void thermal_task(void) { trace_task('t', 200); }
+static void status_task(void) { trace_task('s', slow_task_us); }
+
+static void setup_executive(CyclicExecutive& executive) {
+  SimulatedClock::now_us = 0;
+  executive_trace_length = 0;
+  executive_trace[0] = '\0';
+  // registered out of rate order on purpose
+  executive.add_task("control", 10000, control_task, 2000);
+  executive.add_task("status", 100000, status_task);
+  executive.add_task("fast", 1000, fast_task);
+  executive.add_task("thermal", 10000, thermal_task);
+  executive.start();
+}
+
+// idle passes every 50 us, like loop() spinning between releases
+static void run_executive_for(CyclicExecutive& executive, uint32_t duration_us) {
+  uint32_t end = SimulatedClock::now_us + duration_us;
+  while (static_cast<int32_t>(SimulatedClock::now_us - end) < 0) {
+    if (executive.run_once() == 0) {
+      SimulatedClock::advance(50);
+    }
+  }
+}
+
+void test_executive_rate_monotonic_order(void) {
+  CyclicExecutive executive{SimulatedClock::now};
+  slow_task_us = 50;
+  setup_executive(executive);
+  TEST_ASSERT_EQUAL(4, executive.run_once());
+  // shortest period first, equal periods in registration order
+  TEST_ASSERT_EQUAL_STRING("fcts", executive_trace);
+  TEST_ASSERT_EQUAL(0, executive.run_once());
+
+  run_executive_for(executive, 100000 - SimulatedClock::now_us);
+  TEST_ASSERT_EQUAL(100, executive.stats("fast")->runs);
+  TEST_ASSERT_EQUAL(10, executive.stats("control")->runs);
+  TEST_ASSERT_EQUAL(10, executive.stats("thermal")->runs);
+  TEST_ASSERT_EQUAL(1, executive.stats("status")->runs);
+  TEST_ASSERT_NULL(executive.stats("missing"));
+  for (const char* name : {"fast", "control", "thermal", "status"}) {
+    TEST_ASSERT_EQUAL(0, executive.stats(name)->overruns);
+    TEST_ASSERT_EQUAL(0, executive.stats(name)->skipped);
+  }
+  // thermal waits behind fast and control every time all three are released together
+  TEST_ASSERT_EQUAL(400, executive.stats("thermal")->max_jitter_us);
+  TEST_ASSERT_EQUAL(300, executive.stats("control")->max_exec_us);
+}
+
+void test_executive_counts_overruns(void) {
+  CyclicExecutive executive{SimulatedClock::now};
+  slow_task_us = 0;
+  setup_executive(executive);
+  run_executive_for(executive, 100000);
+  TEST_ASSERT_EQUAL(0, executive.stats("fast")->overruns);
+
+  // status runs for 2.5 fast periods: fast misses its deadline once and drops two releases
+  slow_task_us = 2500;
+  executive.reset_stats();
+  run_executive_for(executive, 100000);
+  const CyclicExecutive::TaskStats* fast = executive.stats("fast");
+  TEST_ASSERT_EQUAL(1, fast->overruns);
+  TEST_ASSERT_EQUAL(2, fast->skipped);
+  TEST_ASSERT_EQUAL(98, fast->runs);
+  TEST_ASSERT_EQUAL(0, executive.stats("control")->overruns);
+  TEST_ASSERT_EQUAL(2500, executive.stats("status")->max_exec_us);
+
+  // the same clock gives the same schedule
+  char first[sizeof(executive_trace)];
+  CyclicExecutive again{SimulatedClock::now};
+  setup_executive(again);
+  run_executive_for(again, 5000);
+  std::copy(executive_trace, executive_trace + sizeof(executive_trace), first);
+  CyclicExecutive replay{SimulatedClock::now};
+  setup_executive(replay);
+  run_executive_for(replay, 5000);
+  TEST_ASSERT_EQUAL_STRING(first, executive_trace);
+}
+
+// Snapshot buffer between the CAN I/O and control cores
+struct TestSnapshot {
+  uint32_t sequence = 0;
+  uint32_t payload[15] = {};  // every word derived from sequence (0 for T{}), a torn copy shows
+};
+
+static TestSnapshot make_test_snapshot(uint32_t sequence) {
+  TestSnapshot snapshot;
+  snapshot.sequence = sequence;
+  for (uint32_t i = 0; i < 15; i++) {
+    snapshot.payload[i] = sequence * 2654435761u * (i + 1);
+  }
+  return snapshot;
+}
+
+static bool test_snapshot_consistent(const TestSnapshot& snapshot) {
+  for (uint32_t i = 0; i < 15; i++) {
+    if (snapshot.payload[i] != snapshot.sequence * 2654435761u * (i + 1)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void test_snapshot_buffer_latest_value(void) {
+  static SnapshotBuffer<TestSnapshot> buffer;
+  TEST_ASSERT_EQUAL(0, buffer.latest().sequence);
+  buffer.publish(make_test_snapshot(1));
+  buffer.publish(make_test_snapshot(2));
+  // state, not events: only the newest is seen
+  const TestSnapshot& latest = buffer.latest();
+  TEST_ASSERT_EQUAL(2, latest.sequence);
+  // the consumer's copy doesn't change under it while the producer keeps going
+  buffer.publish(make_test_snapshot(3));
+  buffer.publish(make_test_snapshot(4));
+  TEST_ASSERT_EQUAL(2, latest.sequence);
+  TEST_ASSERT_TRUE(test_snapshot_consistent(latest));
+  TEST_ASSERT_EQUAL(4, buffer.latest().sequence);
+  TEST_ASSERT_EQUAL(4, buffer.latest().sequence);
+}
+
+#ifndef ARDUINO
+// one thread per side, like the two cores: every snapshot read is whole and none go backwards
+void test_snapshot_buffer_threads(void) {
+  static SnapshotBuffer<TestSnapshot> buffer;
+  constexpr uint32_t kPublishes = 200000;
+  std::atomic<bool> done{false};
+  std::thread producer([&] {
+    for (uint32_t sequence = 1; sequence <= kPublishes; sequence++) {
+      buffer.publish(make_test_snapshot(sequence));
+    }
+    done.store(true);
+  });
+
+  uint32_t last = 0;
+  uint32_t reads = 0;
+  uint32_t torn = 0;
+  uint32_t backwards = 0;
+  while (last != kPublishes) {
+    bool finished = done.load();
+    const TestSnapshot& snapshot = buffer.latest();
+    torn += test_snapshot_consistent(snapshot) ? 0 : 1;
+    backwards += snapshot.sequence < last ? 1 : 0;
+    last = snapshot.sequence;
+    reads++;
+    // the last publish is visible once the producer is done
+    if (finished && last != kPublishes) {
+      TEST_ASSERT_EQUAL(kPublishes, buffer.latest().sequence);
+      last = kPublishes;
+    }
+  }
+  producer.join();
+  TEST_ASSERT_EQUAL(0, torn);
+  TEST_ASSERT_EQUAL(0, backwards);
+  TEST_ASSERT_TRUE(reads > 0);
+}
+#endif
+
+// one control cycle: the snapshot is taken once and every consumer reads it, whatever the CAN I/O
+// task and the pedal box publish in the meantime
+void test_vehicle_snapshot_one_sample_per_cycle(void) {
+  static SnapshotBuffer<BusInputs> bus_inputs;
+  BusInputs hot;
+  hot.bms_state = BMSState::kActive;
+  hot.battery_temperature = 53.0f;
+  hot.before_motor_temperature = 40.0f;
+  hot.inverter.motor_rpm = 3000;
+  hot.inverter.IGBT_temp = 125;
+  hot.inverter.motor_temp = 115;
+  bus_inputs.publish(hot);
+  ThrottleBrake::PedalSample pedals;
+  pedals.APPS1_throttle_scaled = 1500;
+  pedals.APPS2_throttle_scaled = 1500;
+  pedals.timestamp_us = 1000;
+
+  VehicleSnapshot vehicle{};
+  take_vehicle_snapshot(vehicle, pedals, bus_inputs);
+  TEST_ASSERT_EQUAL_UINT32(1, vehicle.sequence);
+  TEST_ASSERT_EQUAL_UINT32(1000, vehicle.timestamp_us);
+
+  // mid cycle: the car cools down and the driver lets go of the throttle and brakes
+  BusInputs cool = hot;
+  cool.bms_state = BMSState::kFault;
+  cool.battery_temperature = 25.0f;
+  cool.before_motor_temperature = 25.0f;
+  cool.inverter.motor_rpm = 500;
+  cool.inverter.IGBT_temp = 30;
+  cool.inverter.motor_temp = 30;
+  bus_inputs.publish(cool);
+  pedals.APPS1_throttle_scaled = 200;
+  pedals.brake_pressed = true;
+  pedals.timestamp_us = 3000;
+
+  // the consumers, in update() order: state machine inputs, thermal frame, torque
+  TEST_ASSERT_TRUE(vehicle.bus.bms_state == BMSState::kActive);
+  TEST_ASSERT_FALSE(vehicle.pedals.brake_pressed);
+  Lookup::ThermalFrame frame = lu.calculate_thermal_frame(
+      vehicle.bus.inverter.motor_temp, vehicle.bus.inverter.IGBT_temp,
+      vehicle.bus.battery_temperature, vehicle.bus.before_motor_temperature);
+  auto torque_reqs = lu.get_torque_reqs(
+      vehicle.pedals.APPS1_throttle_scaled, static_cast<int16_t>(Bounds::SENSOR_SCALED_MAX),
+      vehicle.bus.inverter.motor_rpm, vehicle.pedals.brake_pressed, frame);
+
+  // all from the first sample
+  Lookup::ThermalFrame hot_frame = lu.calculate_thermal_frame(115, 125, 53, 40.0f);
+  TEST_ASSERT_TRUE(hot_frame.igbt_limiting);
+  TEST_ASSERT_EQUAL_FLOAT(hot_frame.temp_mod, frame.temp_mod);
+  TEST_ASSERT_EQUAL_UINT8(hot_frame.pump_duty_cycle, frame.pump_duty_cycle);
+  TEST_ASSERT_EQUAL_UINT8(hot_frame.fan_duty_cycle, frame.fan_duty_cycle);
+  auto hot_reqs = lu.get_torque_reqs(1500, 2047, 3000, false, hot_frame);
+  TEST_ASSERT_TRUE(hot_reqs.first > 0);
+  TEST_ASSERT_EQUAL_INT32(hot_reqs.first, torque_reqs.first);
+  TEST_ASSERT_EQUAL_INT32(hot_reqs.second, torque_reqs.second);
+
+  // the next cycle takes the newer inputs, once
+  take_vehicle_snapshot(vehicle, pedals, bus_inputs);
+  TEST_ASSERT_EQUAL_UINT32(2, vehicle.sequence);
+  TEST_ASSERT_EQUAL_UINT32(3000, vehicle.timestamp_us);
+  TEST_ASSERT_TRUE(vehicle.bus.bms_state == BMSState::kFault);
+  TEST_ASSERT_EQUAL(500, vehicle.bus.inverter.motor_rpm);
+  TEST_ASSERT_TRUE(vehicle.pedals.brake_pressed);
+}
+
+void test_pedal_adc_decode(void) {
+  // 12 bit two's complement counts after three leading bits
+  TEST_ASSERT_EQUAL(0, PedalAcquisition::decode(0x0000));
+  TEST_ASSERT_EQUAL(1000, PedalAcquisition::decode(1000 << 3));
+  TEST_ASSERT_EQUAL(2047, PedalAcquisition::decode(0x07FF << 3));
+  TEST_ASSERT_EQUAL(-5, PedalAcquisition::decode(0x0FFB << 3));
+  TEST_ASSERT_EQUAL(-2048, PedalAcquisition::decode(0x0800 << 3));
+  // the low three bits are not part of the count
+  TEST_ASSERT_EQUAL(1000, PedalAcquisition::decode((1000 << 3) | 0x7));
+}
+
+void test_pedal_acquisition_rejects_bad_config(void) {
+  static PedalAcquisition acquisition;
+  TEST_ASSERT_FALSE(acquisition.begin(PedalAcquisition::Config{0, 8, 1000000}));
+  TEST_ASSERT_FALSE(acquisition.begin(
+      PedalAcquisition::Config{PedalAcquisition::kMaxSampleRateHz + 1, 8, 1000000}));
+  TEST_ASSERT_FALSE(acquisition.begin(PedalAcquisition::Config{4000, 0, 1000000}));
+}
+
+#ifndef ARDUINO
+void test_pedal_acquisition_oversamples(void) {
+  static PedalAcquisition acquisition;
+  TEST_ASSERT_TRUE(acquisition.begin(PedalAcquisition::Config{8000, 8, 1000000}));
+  TEST_ASSERT_EQUAL(0, acquisition.latest().samples);
+
+  const int16_t levels[kNumPedalChannels] = {500, 1600, 2000, -30};
+  for (size_t channel = 0; channel < kNumPedalChannels; channel++) {
+    acquisition.simulated_adc.levels[channel] = levels[channel];
+  }
+  acquisition.simulated_adc.noise = 40;
+  // same seed: the conversions the acquisition sees
+  SimulatedPedalADC reference = acquisition.simulated_adc;
+  int32_t sums[kNumPedalChannels] = {};
+  uint32_t now = 0;
+  for (int i = 0; i < 80; i++) {
+    now += 125;
+    acquisition.sample_simulated(now);
+    int16_t counts[kNumPedalChannels];
+    reference.convert(counts);
+    for (size_t channel = 0; i >= 72 && channel < kNumPedalChannels; channel++) {
+      sums[channel] += counts[channel];
+    }
+  }
+  const PedalADCBlock& block = acquisition.latest();
+  TEST_ASSERT_EQUAL(10, block.sequence);
+  TEST_ASSERT_EQUAL(8, block.samples);
+  TEST_ASSERT_EQUAL(now, block.timestamp_us);
+  for (size_t channel = 0; channel < kNumPedalChannels; channel++) {
+    // rounded mean of the last window
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, sums[channel] / 8.0f, block.counts[channel]);
+    TEST_ASSERT_INT_WITHIN(40, levels[channel], block.counts[channel]);
+  }
+
+  // a partial window is not published
+  for (int i = 0; i < 7; i++) {
+    acquisition.sample_simulated(now += 125);
+  }
+  TEST_ASSERT_EQUAL(10, acquisition.latest().sequence);
+  acquisition.sample_simulated(now += 125);
+  TEST_ASSERT_EQUAL(11, acquisition.latest().sequence);
+  TEST_ASSERT_EQUAL(88, acquisition.get_stats().conversions);
+  TEST_ASSERT_EQUAL(11, acquisition.get_stats().blocks);
+}
+
+// acquisition on one thread, control reads on another: every block is one whole window
+void test_pedal_acquisition_threads(void) {
+  static PedalAcquisition acquisition;
+  constexpr uint16_t kOversample = 4;
+  constexpr uint32_t kBlocks = 50000;
+  TEST_ASSERT_TRUE(acquisition.begin(PedalAcquisition::Config{8000, kOversample, 1000000}));
+  std::thread sampler([&] {
+    uint32_t now = 0;
+    for (uint32_t block = 0; block < kBlocks; block++) {
+      // every channel of window n reads n % 2000
+      for (size_t channel = 0; channel < kNumPedalChannels; channel++) {
+        acquisition.simulated_adc.levels[channel] = static_cast<int16_t>(block % 2000);
+      }
+      for (uint16_t i = 0; i < kOversample; i++) {
+        acquisition.sample_simulated(now += 125);
+      }
+    }
+  });
+
+  uint32_t last = 0;
+  uint32_t torn = 0;
+  uint32_t backwards = 0;
+  while (last != kBlocks) {
+    const PedalADCBlock& block = acquisition.latest();
+    if (block.samples == 0) {
+      continue;
+    }
+    int16_t expected = static_cast<int16_t>((block.sequence - 1) % 2000);
+    for (size_t channel = 0; channel < kNumPedalChannels; channel++) {
+      torn += block.counts[channel] == expected ? 0 : 1;
+    }
+    torn += block.timestamp_us == block.sequence * kOversample * 125 ? 0 : 1;
+    backwards += block.sequence < last ? 1 : 0;
+    last = block.sequence;
+  }
+  sampler.join();
+  TEST_ASSERT_EQUAL(0, torn);
+  TEST_ASSERT_EQUAL(0, backwards);
+}
+#endif
+
+#ifndef ARDUINO
+// 8 kHz pedal sampling, a 10 ms control cycle taking 300 us and event-triggered torque frames:
+// every command reaches the bus one block age + compute time after its sample, no TX timer phase
+void test_torque_tx_pedal_to_bus_latency(void) {
+  static PedalAcquisition acquisition;
+  TEST_ASSERT_TRUE(acquisition.begin(PedalAcquisition::Config{8000, 8, 1000000}));
+  TorqueTXSchedule schedule{10000, 30000};
+  constexpr uint32_t kSamplePeriodUs = 125;
+  constexpr uint32_t kComputeUs = 300;
+
+  uint32_t ready_at = 0;  // a computed command waiting for the end of its cycle, 0: none
+  uint32_t ready_sample_us = 0;
+  for (uint32_t now = kSamplePeriodUs; now <= 500000; now += kSamplePeriodUs) {
+    acquisition.sample_simulated(now);
+    if (now % 10000 == 3000) {
+      ready_sample_us = acquisition.latest().timestamp_us;
+      ready_at = now + kComputeUs;
+    }
+    if (ready_at != 0 && now >= ready_at) {
+      schedule.on_command(ready_sample_us, now);
+      ready_at = 0;
+    } else {
+      schedule.fallback_due(now);
+    }
+  }
+  const TorqueTXSchedule::Stats& stats = schedule.get_stats();
+  TEST_ASSERT_EQUAL(50, stats.event_sends);
+  // commands come every period: the fallback never fires
+  TEST_ASSERT_EQUAL(0, stats.fallback_sends);
+  // the block ending at 3000 was fresh, 300 us compute rounded up to the 125 us step
+  TEST_ASSERT_EQUAL(375, stats.last_latency_us);
+  TEST_ASSERT_TRUE(stats.max_latency_us <= 8 * kSamplePeriodUs + kComputeUs + kSamplePeriodUs);
+}
+
+// no new command: the last one is re-sent every fallback period, phase kept
+void test_torque_tx_fallback_keeps_bus_alive(void) {
+  TorqueTXSchedule schedule{10000, 30000};
+  schedule.on_command(0, 1000);
+  TEST_ASSERT_FALSE(schedule.fallback_due(10999));
+  TEST_ASSERT_TRUE(schedule.fallback_due(11000));
+  TEST_ASSERT_FALSE(schedule.fallback_due(11000));
+  // serviced late: one send, the next stays on the 10 ms grid
+  TEST_ASSERT_TRUE(schedule.fallback_due(35500));
+  TEST_ASSERT_FALSE(schedule.fallback_due(40999));
+  TEST_ASSERT_TRUE(schedule.fallback_due(41000));
+  TEST_ASSERT_EQUAL(3, schedule.get_stats().fallback_sends);
+  // a new command restarts the period
+  schedule.on_command(41000, 43000);
+  TEST_ASSERT_FALSE(schedule.fallback_due(52999));
+  TEST_ASSERT_TRUE(schedule.fallback_due(53000));
+  TEST_ASSERT_EQUAL(2000, schedule.get_stats().last_latency_us);
+}
+
+// the control core stops publishing: the last torque request is dropped to zero after the
+// command timeout, not re-sent forever, and the first fresh request brings it back
+void test_torque_tx_zero_after_stalled_commands(void) {
+  using Send = TorqueTXSchedule::Send;
+  TorqueTXSchedule schedule{10000, 30000};
+  // nothing commanded yet: only the fallback (of zero torque)
+  TEST_ASSERT_TRUE(schedule.next(0, 0, 5000) == Send::kNone);
+  TEST_ASSERT_TRUE(schedule.next(0, 0, 10000) == Send::kResend);
+
+  // a command every 10 ms from a 2 ms old sample, the bus task passes every ms
+  uint32_t sequence = 0;
+  uint32_t now = 10000;
+  for (; now <= 100000; now += 1000) {
+    Send send = now % 10000 == 0 ? schedule.next(++sequence, now - 2000, now)
+                                 : schedule.next(sequence, now - 2000 - now % 10000, now);
+    TEST_ASSERT_TRUE(send == (now % 10000 == 0 ? Send::kCommand : Send::kNone));
+  }
+  TEST_ASSERT_EQUAL(0, schedule.get_stats().timeouts);
+
+  // stalled at the command of 100 ms: still re-sent up to the timeout, then zero once
+  uint32_t sample_us = 98000;
+  int zeros = 0;
+  int resends = 0;
+  for (; now <= 200000; now += 1000) {
+    Send send = schedule.next(sequence, sample_us, now);
+    if (send == Send::kZero) {
+      TEST_ASSERT_EQUAL(131000, now);
+      zeros++;
+    } else if (send == Send::kResend) {
+      resends++;
+    }
+  }
+  TEST_ASSERT_EQUAL(1, zeros);
+  // 110, 120, 130 ms with the command, then every 10 ms after 131 ms with zero torque
+  TEST_ASSERT_EQUAL(3 + 6, resends);
+  TEST_ASSERT_EQUAL(1, schedule.get_stats().timeouts);
+
+  // the control core is back but its pedal sample is stale: stays zero
+  TEST_ASSERT_TRUE(schedule.next(++sequence, sample_us, now) != Send::kCommand);
+  // a fresh one is sent at once
+  TEST_ASSERT_TRUE(schedule.next(++sequence, now - 2000, now) == Send::kCommand);
+  TEST_ASSERT_EQUAL(2000, schedule.get_stats().last_latency_us);
+
+  // a command from a stale sample while driving: zero at once
+  now += 1000;
+  TEST_ASSERT_TRUE(schedule.next(++sequence, now - 40000, now) == Send::kZero);
+  TEST_ASSERT_EQUAL(2, schedule.get_stats().timeouts);
+}
+#endif
+
+void test_profiler_stats_and_histogram(void) {
+  static StageProfiler profiler;
+  TEST_ASSERT_EQUAL(0, profiler.stats(ProfileStage::kProcessState).count);
+  TEST_ASSERT_EQUAL(0, profiler.stats(ProfileStage::kProcessState).percentile_bucket(99));
+
+  const uint32_t samples[] = {0, 1, 3, 1000, 1023, 1024, 96};
+  for (uint32_t ticks : samples) {
+    profiler.record(ProfileStage::kProcessState, ticks);
+  }
+  const StageProfiler::StageStats& stats = profiler.stats(ProfileStage::kProcessState);
+  TEST_ASSERT_EQUAL(7, stats.count);
+  TEST_ASSERT_EQUAL(0, stats.min_ticks);
+  TEST_ASSERT_EQUAL(1024, stats.max_ticks);
+  TEST_ASSERT_EQUAL(3147 / 7, stats.mean_ticks());
+  // bucket b holds [2^(b-1), 2^b)
+  TEST_ASSERT_EQUAL(1, stats.histogram[0]);
+  TEST_ASSERT_EQUAL(1, stats.histogram[1]);
+  TEST_ASSERT_EQUAL(1, stats.histogram[2]);
+  TEST_ASSERT_EQUAL(1, stats.histogram[7]);
+  TEST_ASSERT_EQUAL(2, stats.histogram[10]);
+  TEST_ASSERT_EQUAL(1, stats.histogram[11]);
+  TEST_ASSERT_EQUAL(StageProfiler::kNumBuckets - 1, StageProfiler::bucket(UINT32_MAX));
+  TEST_ASSERT_EQUAL(7, stats.percentile_bucket(50));
+  TEST_ASSERT_EQUAL(11, stats.percentile_bucket(99));
+  // other stages untouched
+  TEST_ASSERT_EQUAL(0, profiler.stats(ProfileStage::kChangeState).count);
+
+  profiler.reset();
+  TEST_ASSERT_EQUAL(0, profiler.stats(ProfileStage::kProcessState).count);
+  TEST_ASSERT_EQUAL(UINT32_MAX, profiler.stats(ProfileStage::kProcessState).min_ticks);
+}
+
+#ifndef ARDUINO
+void test_profiler_scope_and_report(void) {
+  static StageProfiler profiler;
+  const Lookup::ThermalFrame frame{};
+  int64_t sink = 0;
+  for (int i = 0; i < 100; i++) {
+    ProfileScope scope{profiler, ProfileStage::kTorqueLookup};
+    sink += lu.get_torque_reqs(static_cast<int16_t>(i * 20), 2047, 3000, false, frame).first;
+  }
+  TEST_ASSERT_TRUE(sink >= 0);
+  const StageProfiler::StageStats& stats = profiler.stats(ProfileStage::kTorqueLookup);
+  TEST_ASSERT_EQUAL(100, stats.count);
+  TEST_ASSERT_TRUE(stats.min_ticks <= stats.mean_ticks());
+  TEST_ASSERT_TRUE(stats.mean_ticks() <= stats.max_ticks);
+
+  // the host side dump: one line per stage that ran
+  char report[512];
+  size_t length = profiler.write_report(report, sizeof(report));
+  TEST_ASSERT_EQUAL(std::strlen(report), length);
+  TEST_ASSERT_TRUE(std::strncmp(report, "torque_lookup n=100 ", 20) == 0);
+  TEST_ASSERT_EQUAL('\n', report[length - 1]);
+  std::printf("%s", report);
+  // truncated like snprintf, the full length is still reported
+  char small[16];
+  TEST_ASSERT_EQUAL(length, profiler.write_report(small, sizeof(small)));
+  TEST_ASSERT_EQUAL(15, std::strlen(small));
+}
+#endif
+
+void test_event_log_order_and_format(void) {
+  static EventLog log;
+  LogRecord record;
+  TEST_ASSERT_FALSE(log.pop(record));
+
+  TEST_ASSERT_TRUE(log.log(LogEvent::kTransitionOffToN));
+  TEST_ASSERT_TRUE(log.log(LogEvent::kThrottleInfo, int16_t{-12}, 2047));
+  TEST_ASSERT_TRUE(log.pop(record));
+  TEST_ASSERT_TRUE(record.event == LogEvent::kTransitionOffToN);
+  TEST_ASSERT_EQUAL(0, record.num_args);
+  TEST_ASSERT_TRUE(log.pop(record));
+  TEST_ASSERT_TRUE(record.event == LogEvent::kThrottleInfo);
+  TEST_ASSERT_EQUAL(2, record.num_args);
+  TEST_ASSERT_EQUAL(-12, record.args[0]);
+  TEST_ASSERT_EQUAL(2047, record.args[1]);
+  TEST_ASSERT_FALSE(log.pop(record));
+
+  // the text is only made on the consumer side
+  record.timestamp_us = 1234;
+  char line[64];
+  size_t length = EventLog::format(record, line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("1234 APPS1_ADC: -12 APPS2_ADC: 2047", line);
+  TEST_ASSERT_EQUAL(std::strlen(line), length);
+  // truncated like snprintf, the full length is still reported
+  char small[8];
+  TEST_ASSERT_EQUAL(length, EventLog::format(record, small, sizeof(small)));
+  TEST_ASSERT_EQUAL_STRING("1234 AP", small);
+  record.event = LogEvent::kCount;
+  EventLog::format(record, line, sizeof(line));
+  TEST_ASSERT_EQUAL_STRING("1234 unknown event 14", line);
+}
+
+// a full ring never blocks the writer: the new record is dropped and counted
+void test_event_log_counts_overruns(void) {
+  static EventLog log;
+  for (int32_t i = 0; i < static_cast<int32_t>(EventLog::kCapacity); i++) {
+    TEST_ASSERT_TRUE(log.log(LogEvent::kInverterInfo, i));
+  }
+  TEST_ASSERT_FALSE(log.log(LogEvent::kInverterInfo, -1));
+  TEST_ASSERT_FALSE(log.log(LogEvent::kInverterInfo, -2));
+  TEST_ASSERT_EQUAL(2, log.overruns());
+
+  // the oldest records are kept, and a freed slot takes a new one
+  LogRecord record;
+  TEST_ASSERT_TRUE(log.pop(record));
+  TEST_ASSERT_EQUAL(0, record.args[0]);
+  TEST_ASSERT_TRUE(log.log(LogEvent::kInverterInfo, 1000));
+  for (int32_t i = 1; i < static_cast<int32_t>(EventLog::kCapacity); i++) {
+    TEST_ASSERT_TRUE(log.pop(record));
+    TEST_ASSERT_EQUAL(i, record.args[0]);
+  }
+  TEST_ASSERT_TRUE(log.pop(record));
+  TEST_ASSERT_EQUAL(1000, record.args[0]);
+  TEST_ASSERT_FALSE(log.pop(record));
+  TEST_ASSERT_EQUAL(2, log.overruns());
+}
+
+#ifndef ARDUINO
+// both cores log while the log task drains: every record arrives whole and in order per writer,
+// or is counted as dropped
+void test_event_log_threads(void) {
+  static EventLog log;
+  constexpr int32_t kPerWriter = 50000;
+  std::atomic<int> writers_done{0};
+  auto writer = [&](int32_t id) {
+    for (int32_t i = 0; i < kPerWriter; i++) {
+      log.log(LogEvent::kStatusTiming, id, i, id * 7 + i, -i, i ^ id);
+    }
+    writers_done++;
+  };
+  std::thread first(writer, 1);
+  std::thread second(writer, 2);
+
+  int32_t last[3] = {-1, -1, -1};
+  uint32_t received = 0;
+  int torn = 0;
+  int out_of_order = 0;
+  LogRecord record;
+  for (;;) {
+    bool done = writers_done == 2;
+    if (!log.pop(record)) {
+      if (done) {
+        break;
+      }
+      continue;
+    }
+    received++;
+    int32_t id = record.args[0];
+    int32_t i = record.args[1];
+    if (id < 1 || id > 2 || record.num_args != 5 || record.args[2] != id * 7 + i ||
+        record.args[3] != -i || record.args[4] != (i ^ id)) {
+      torn++;
+      continue;
+    }
+    if (i <= last[id]) {
+      out_of_order++;
+    }
+    last[id] = i;
+  }
+  first.join();
+  second.join();
+  TEST_ASSERT_EQUAL(0, torn);
+  TEST_ASSERT_EQUAL(0, out_of_order);
+  TEST_ASSERT_EQUAL(2 * kPerWriter, received + log.overruns());
+  TEST_ASSERT_TRUE(received > 0);
+}
+#endif
+
+void test_executive_decimated_period(void) {
+  // 1 kHz control: thermal / status keep their rates, on control's releases
+  TEST_ASSERT_EQUAL(10000, CyclicExecutive::decimated_period(1000, 10000));
+  TEST_ASSERT_EQUAL(100000, CyclicExecutive::decimated_period(1000, 100000));
+  TEST_ASSERT_EQUAL(10000, CyclicExecutive::decimated_period(10000, 10000));
+  // never faster than asked, never off the base grid
+  TEST_ASSERT_EQUAL(10000, CyclicExecutive::decimated_period(10000, 1000));
+  TEST_ASSERT_EQUAL(3000, CyclicExecutive::decimated_period(1000, 2500));
+}
+
+// run time of the WCET test steps: 10 us, 50 us on every 7th iteration
+static void wcet_test_prepare(uint32_t iteration) { SimulatedClock::advance(iteration * 1000); }
+static void wcet_test_run(uint32_t iteration) {
+  SimulatedClock::advance(iteration % 7 == 3 ? 50 : 10);
+}
+
+void test_wcet_harness_budget(void) {
+  SimulatedClock::now_us = 0;
+  WcetHarness harness{SimulatedClock::now};
+  TEST_ASSERT_FALSE(harness.add_scenario("no run", nullptr, nullptr, 100));
+  TEST_ASSERT_TRUE(harness.add_scenario("fits", wcet_test_prepare, wcet_test_run, 50));
+  TEST_ASSERT_TRUE(harness.add_scenario("over", nullptr, wcet_test_run, 49));
+  TEST_ASSERT_EQUAL(2, harness.num_scenarios());
+
+  // one over budget run fails the whole check
+  TEST_ASSERT_FALSE(harness.run(70));
+  const WcetHarness::Result& fits = harness.result(0);
+  TEST_ASSERT_EQUAL(70, fits.runs);
+  // prepare is not timed
+  TEST_ASSERT_EQUAL(50, fits.max_us);
+  TEST_ASSERT_EQUAL(3, fits.worst_iteration);
+  TEST_ASSERT_EQUAL((60 * 10 + 10 * 50) / 70, fits.mean_us());
+  TEST_ASSERT_TRUE(fits.within_budget);
+  TEST_ASSERT_FALSE(harness.result(1).within_budget);
+  TEST_ASSERT_EQUAL_STRING("over", harness.name(1));
+  TEST_ASSERT_EQUAL(49, harness.budget_us(1));
+
+  // a rerun starts over
+  TEST_ASSERT_TRUE(harness.run(1));
+  TEST_ASSERT_EQUAL(1, harness.result(0).runs);
+  TEST_ASSERT_EQUAL(10, harness.result(0).max_us);
+}
+
+void test_lookup_batch_matches_scalar(void) {
+  static int16_t keys[12000];
+  static float batch[12000];
+  for (size_t i = 0; i < 12000; i++) {
+    keys[i] = static_cast<int16_t>(static_cast<int>(i) - 1000);
+  }
+  for (uint8_t id = 0; id <= static_cast<uint8_t>(Lookup::TableID::kCoolantTemp2FanDutyCycle);
+       id++) {
+    auto table_id = static_cast<Lookup::TableID>(id);
+    // odd length so the scalar tail runs too
+    lu.lookup_batch(table_id, keys, batch, 11997);
+    for (size_t i = 0; i < 11997; i++) {
+      TEST_ASSERT_FLOAT_WITHIN(1e-6, lu.table(table_id).lookup(keys[i]), batch[i]);
+    }
+  }
+
+  FlatLUT smooth{{{0, 0.0f}, {10, 0.2f}, {20, 0.9f}, {30, 1.0f}}, InterpType::SMOOTH_STEP};
+  smooth.lookup_batch(keys, batch, 1203);
+  for (size_t i = 0; i < 1203; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(1e-6, smooth.lookup(keys[i]), batch[i]);
+  }
+}
+
+void test_torque_reqs_batch_matches_scalar(void) {
+  static Lookup::TorqueInputs inputs[1000];
+  static std::pair<int32_t, int32_t> reqs[1000];
+  uint32_t seed = 99;
+  for (auto& input : inputs) {
+    seed = seed * 1664525u + 1013904223u;
+    input.real_throttle = static_cast<int16_t>((seed >> 8) % 2048);
+    input.throttle_max = 2047;
+    input.motor_rpm = static_cast<int16_t>((seed >> 12) % 7000);
+    input.brake_pressed = (seed & 0xF) == 0;
+    input.igbt_temp = static_cast<int16_t>((seed >> 20) % 160);
+    input.batt_temp = static_cast<int16_t>((seed >> 4) % 70);
+    input.motor_temp = static_cast<int16_t>((seed >> 16) % 130);
+  }
+
+  // every throttle mode, the torque map included
+  for (auto mode : {Lookup::ThrottleLUTMode::kInterpolated, Lookup::ThrottleLUTMode::kDense,
+                    Lookup::ThrottleLUTMode::kTorqueMap}) {
+    lu.set_throttle_LUT_mode(mode);
+    lu.get_torque_reqs_batch(inputs, reqs, 1000);
+    for (size_t i = 0; i < 1000; i++) {
+      const Lookup::TorqueInputs& in = inputs[i];
+      auto expected = lu.get_torque_reqs_float(in.real_throttle, in.throttle_max, in.motor_rpm,
+                                               in.brake_pressed, in.igbt_temp, in.batt_temp,
+                                               in.motor_temp);
+      TEST_ASSERT_EQUAL_INT32(expected.first, reqs[i].first);
+      TEST_ASSERT_EQUAL_INT32(expected.second, reqs[i].second);
+    }
+  }
+  lu.set_throttle_LUT_mode(Lookup::ThrottleLUTMode::kDense);
+}
+
 // Unit tests for LUT::calculate_temp_mod
+void test_temp_mod_reuses_unchanged_inputs(void) {
+  float first = lu.calculate_temp_mod(125, 53, 115);
+  TEST_ASSERT_EQUAL(true, static_cast<bool>(lu.can_data.temp_limiting_statuses[0]));
+
+  // same readings: cached product, no table lookups
+  Lookup::LUTCacheStats before = lu.get_LUT_cache_stats();
+  TEST_ASSERT_EQUAL_FLOAT(first, lu.calculate_temp_mod(125, 53, 115));
+  Lookup::LUTCacheStats after = lu.get_LUT_cache_stats();
+  TEST_ASSERT_EQUAL_UINT32(before.hits + before.misses, after.hits + after.misses);
+
+  // new readings recompute, going back recomputes the old result and flags
+  TEST_ASSERT_EQUAL_FLOAT(1.0f, lu.calculate_temp_mod(20, 20, 20));
+  TEST_ASSERT_EQUAL(false, static_cast<bool>(lu.can_data.temp_limiting_statuses[0]));
+  TEST_ASSERT_EQUAL_FLOAT(first, lu.calculate_temp_mod(125, 53, 115));
+  TEST_ASSERT_EQUAL(true, static_cast<bool>(lu.can_data.temp_limiting_statuses[0]));
+
+  // the fixed point stage has its own cache, but publishes its own flags on a hit
+  lu.calculate_temp_mod_fixed(20, 20, 20);
+  lu.calculate_temp_mod(125, 53, 115);
+  lu.calculate_temp_mod_fixed(20, 20, 20);
+  TEST_ASSERT_EQUAL(false, static_cast<bool>(lu.can_data.temp_limiting_statuses[0]));
+}
+
+// the fused frame gives the same answers as the separate stages
+void test_thermal_frame_matches_separate_stages(void) {
+  for (int16_t motor = -10; motor <= 130; motor += 3) {
+    for (int16_t igbt = -10; igbt <= 160; igbt += 7) {
+      for (int16_t batt = -5; batt <= 65; batt += 4) {
+        float coolant = static_cast<float>(motor) * 0.5f;
+        Lookup::ThermalFrame frame = lu.calculate_thermal_frame(motor, igbt, batt, coolant);
+#ifdef LUT_FIXED_POINT
+        q15_t temp_mod = lu.calculate_temp_mod_fixed(igbt, batt, motor);
+        TEST_ASSERT_EQUAL_INT32(temp_mod, frame.temp_mod_q15);
+        TEST_ASSERT_EQUAL_FLOAT(q15_to_float(temp_mod), frame.temp_mod);
+#else
+        TEST_ASSERT_EQUAL_FLOAT(lu.calculate_temp_mod(igbt, batt, motor), frame.temp_mod);
+#endif
+        TEST_ASSERT_EQUAL_UINT8(lu.calculate_pump_duty_cycle(motor, igbt, batt),
+                                frame.pump_duty_cycle);
+        TEST_ASSERT_EQUAL_UINT8(lu.calculate_fan_duty_cycle(coolant), frame.fan_duty_cycle);
+        TEST_ASSERT_EQUAL(lu.lookup(igbt, lu.IGBTTemp2Modifier_LUT) < 1.0f, frame.igbt_limiting);
+        TEST_ASSERT_EQUAL(lu.lookup(batt, lu.BatteryTemp2Modifier_LUT) < 1.0f, frame.batt_limiting);
+        TEST_ASSERT_EQUAL(lu.lookup(motor, lu.MotorTemp2Modifier_LUT) < 1.0f, frame.motor_limiting);
+      }
+    }
+  }
+
+  Lookup::ThermalFrame frame = lu.calculate_thermal_frame(85, 115, 53, 30.0f);
+  auto fused = lu.get_torque_reqs(1500, 2047, 3000, false, frame);
+  auto separate = lu.get_torque_reqs(1500, 2047, 3000, false, 115, 53, 85);
+  TEST_ASSERT_EQUAL_INT32(separate.first, fused.first);
+  TEST_ASSERT_EQUAL_INT32(separate.second, fused.second);
+}
+
+// unchanged readings and tables give the last frame back without a lookup
+void test_thermal_frame_reuses_unchanged_temperatures(void) {
+  using TableID = Lookup::TableID;
+  Lookup::ThermalFrame first = lu.calculate_thermal_frame(115, 125, 53, 30.2f);
+  TEST_ASSERT_TRUE(first.igbt_limiting);
+
+  Lookup::LUTCacheStats before = lu.get_LUT_cache_stats();
+  Lookup::ThermalFrame again = lu.calculate_thermal_frame(115, 125, 53, 29.8f);
+  Lookup::LUTCacheStats after = lu.get_LUT_cache_stats();
+  TEST_ASSERT_EQUAL_UINT32(before.hits + before.misses, after.hits + after.misses);
+  TEST_ASSERT_EQUAL_FLOAT(first.temp_mod, again.temp_mod);
+  TEST_ASSERT_EQUAL_UINT8(first.pump_duty_cycle, again.pump_duty_cycle);
+  TEST_ASSERT_EQUAL_UINT8(first.fan_duty_cycle, again.fan_duty_cycle);
+
+  // a hit publishes the cached flags, not whatever the last stage left
+  lu.calculate_temp_mod(20, 20, 20);
+  TEST_ASSERT_EQUAL(false, static_cast<bool>(lu.can_data.temp_limiting_statuses[0]));
+  lu.calculate_thermal_frame(115, 125, 53, 30.0f);
+  TEST_ASSERT_EQUAL(true, static_cast<bool>(lu.can_data.temp_limiting_statuses[0]));
+
+  // a new calibration recomputes
+  uint8_t motor_mod_id = lu.LUT_id(TableID::kMotorTemp2Modifier);
+  FlatLUT half{{-40, 0.5f}, {200, 0.5f}};
+  lu.install_LUT(TableID::kMotorTemp2Modifier, half, 9);
+  Lookup::ThermalFrame derated = lu.calculate_thermal_frame(115, 125, 53, 30.0f);
+  TEST_ASSERT_EQUAL_FLOAT(lu.calculate_temp_mod(125, 53, 115), derated.temp_mod);
+  TEST_ASSERT_TRUE(derated.motor_limiting);
+  lu.install_LUT(TableID::kMotorTemp2Modifier, lu.MotorTemp2Modifier_LUT, motor_mod_id);
+  TEST_ASSERT_EQUAL_FLOAT(first.temp_mod, lu.calculate_thermal_frame(115, 125, 53, 30.0f).temp_mod);
+}
+
+#ifndef ARDUINO
+// one DRIVE tick of the lookup work done by the FSM, float and fixed point
+void test_control_cycle_allocation_free(void) {
+  size_t before = heap_allocations;
+  for (int tick = 0; tick < 1000; tick++) {
+    int16_t temp = static_cast<int16_t>(40 + tick / 100);
+    lu.get_torque_reqs_float(static_cast<int16_t>(tick * 2 % 2048), 2047,
+                             static_cast<int16_t>(tick * 5), tick % 50 == 0, temp, temp, temp);
+    lu.get_torque_reqs_fixed(static_cast<int16_t>(tick * 2 % 2048), 2047,
+                             static_cast<int16_t>(tick * 5), tick % 50 == 0, temp, temp, temp);
+    lu.calculate_pump_duty_cycle(temp, temp, temp);
+    lu.calculate_fan_duty_cycle(static_cast<float>(temp));
+    Lookup::ThermalFrame frame =
+        lu.calculate_thermal_frame(temp, temp, temp, static_cast<float>(temp));
+    lu.get_torque_reqs(1000, 2047, static_cast<int16_t>(tick * 5), false, frame);
+    lu.update_status_CAN(lu.get_status_CAN());
+  }
+  TEST_ASSERT_EQUAL(0, heap_allocations - before);
+}
+#endif
+
 void test_temp_mod_nominal(void) {
   TEST_ASSERT_FLOAT_WITHIN(1e-6, 1.0f, lu.calculate_temp_mod(0, 0, 0));
 }
@@ -462,6 +2189,112 @@ void test_integration_boundary_cases(void) {
   TEST_ASSERT_EQUAL_INT32(expR, reqs.second);
 }
 
+// Float vs integer-only (Q15) pipeline over the full input domain. Prints the max deviation.
+void test_fixed_point_pipeline_max_deviation(void) {
+  char msg[128];
+
+  // pedal x rpm at nominal temps, compared in mA at the inverter request
+  int32_t max_req_dev = 0;
+  for (int16_t throttle = 0; throttle <= 2047; throttle++) {
+    for (int16_t rpm = -200; rpm <= 11000; rpm += 25) {
+      for (bool brake : {false, true}) {
+        auto ref = lu.get_torque_reqs_float(throttle, 2047, rpm, brake, 25, 25, 25);
+        auto fixed = lu.get_torque_reqs_fixed(throttle, 2047, rpm, brake, 25, 25, 25);
+        max_req_dev = std::max(max_req_dev, std::abs(ref.first - fixed.first));
+        max_req_dev = std::max(max_req_dev, std::abs(ref.second - fixed.second));
+      }
+    }
+  }
+
+  // every combination of the three temperatures, compared as a modifier
+  float max_temp_dev = 0.0f;
+  for (int16_t igbt = -20; igbt <= 170; igbt++) {
+    for (int16_t batt = -20; batt <= 80; batt++) {
+      for (int16_t motor = -20; motor <= 140; motor++) {
+        float ref = lu.calculate_temp_mod(igbt, batt, motor);
+        float fixed = q15_to_float(lu.calculate_temp_mod_fixed(igbt, batt, motor));
+        max_temp_dev = std::max(max_temp_dev, fabsf(ref - fixed));
+      }
+    }
+  }
+
+  snprintf(msg, sizeof(msg), "fixed vs float: max torque req dev %ld mA, max temp mod dev %.2f LSB",
+           static_cast<long>(max_req_dev), max_temp_dev * kQ15One);
+  TEST_MESSAGE(msg);
+
+  // a one count shift of the pedal zero point is the worst case: stay under 1% of max torque
+  TEST_ASSERT_LESS_OR_EQUAL(static_cast<int32_t>(Lookup::TorqueReqLimit::kAccelMax) / 100,
+                            max_req_dev);
+  TEST_ASSERT_TRUE(max_temp_dev <= 2.0f / kQ15One);
+}
+
+// the Q15 pipeline reads the throttle curves the way throttle_LUT_mode says, like the float one
+void test_fixed_point_pipeline_follows_mode(void) {
+  using Mode = Lookup::ThrottleLUTMode;
+  for (auto mode : {Mode::kInterpolated, Mode::kDense, Mode::kTorqueMap}) {
+    lu.set_throttle_LUT_mode(mode);
+    int32_t max_req_dev = 0;
+    for (int16_t throttle = 0; throttle <= 2047; throttle += 7) {
+      for (int16_t rpm = -200; rpm <= 11000; rpm += 150) {
+        auto ref = lu.get_torque_reqs_float(throttle, 2047, rpm, false, 25, 25, 25);
+        auto fixed = lu.get_torque_reqs_fixed(throttle, 2047, rpm, false, 25, 25, 25);
+        max_req_dev = std::max(max_req_dev, std::abs(ref.first - fixed.first));
+        max_req_dev = std::max(max_req_dev, std::abs(ref.second - fixed.second));
+        if (mode == Mode::kTorqueMap) {
+          // one map lookup in both, the Q15 path only converts its result
+          auto float_mods = lu.get_torque_mods(throttle, 2047, rpm, false);
+          auto fixed_mods = lu.get_torque_mods_fixed(throttle, 2047, rpm, false);
+          TEST_ASSERT_EQUAL_INT32(float_to_q15(float_mods.first), fixed_mods.first);
+          TEST_ASSERT_EQUAL_INT32(float_to_q15(float_mods.second), fixed_mods.second);
+        }
+      }
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(static_cast<int32_t>(Lookup::TorqueReqLimit::kAccelMax) / 100,
+                              max_req_dev);
+  }
+  lu.set_throttle_LUT_mode(Mode::kDense);
+}
+
+// Replays a drive-like trace at 100 Hz (rpm sweeping through launches and braking zones, temps
+// creeping up with sensor noise) and checks the segment cache hit rate of the control loop
+void test_LUT_cache_hit_rate_drive_replay(void) {
+  Lookup::LUTCacheStats before = lu.get_LUT_cache_stats();
+
+  uint32_t seed = 12345;
+  float rpm = 0.0f;
+  for (int tick = 0; tick < 60 * 100; tick++) {
+    seed = seed * 1664525u + 1013904223u;
+    int16_t noise = static_cast<int16_t>((seed >> 16) % 5) - 2;
+
+    // 8 s cycle: 5 s accelerating to ~5500 rpm, 3 s braking back down
+    float phase = static_cast<float>(tick % 800) / 800.0f;
+    rpm += (phase < 0.625f) ? 11.0f : -18.0f;
+    rpm = std::max(0.0f, rpm);
+    int16_t motor_rpm = static_cast<int16_t>(rpm) + noise * 5;
+    int16_t throttle = (phase < 0.625f) ? 1800 : 0;
+
+    int16_t igbt_temp = static_cast<int16_t>(40 + tick / 150) + noise;
+    int16_t motor_temp = static_cast<int16_t>(35 + tick / 200) + noise;
+    int16_t batt_temp = static_cast<int16_t>(25 + tick / 600) + noise;
+
+    lu.get_torque_reqs(throttle, 2047, motor_rpm, phase >= 0.625f, igbt_temp, batt_temp,
+                       motor_temp);
+    lu.calculate_pump_duty_cycle(motor_temp, igbt_temp, batt_temp);
+    lu.calculate_fan_duty_cycle(static_cast<float>(motor_temp - 10));
+  }
+
+  Lookup::LUTCacheStats after = lu.get_LUT_cache_stats();
+  uint32_t hits = after.hits - before.hits;
+  uint32_t misses = after.misses - before.misses;
+  float hit_rate = static_cast<float>(hits) / static_cast<float>(hits + misses);
+
+  char msg[96];
+  snprintf(msg, sizeof(msg), "LUT segment cache: %lu hits, %lu misses, %.2f%% hit rate",
+           static_cast<unsigned long>(hits), static_cast<unsigned long>(misses), hit_rate * 100);
+  TEST_MESSAGE(msg);
+  TEST_ASSERT_TRUE(hit_rate > 0.95f);
+}
+
 int runUnityTests(void) {
   UNITY_BEGIN();
   RUN_TEST(test_testing_framework);
@@ -471,6 +2304,10 @@ int runUnityTests(void) {
   RUN_TEST(test_lookup_exact_hit);
   RUN_TEST(test_lookup_interpolated_igbt);
   RUN_TEST(test_lookup_interpolated_throttle);
+  RUN_TEST(test_flat_lut_unsorted_input);
+  RUN_TEST(test_flat_lut_uniform_grid_detection);
+  RUN_TEST(test_flat_lut_cursor);
+  RUN_TEST(test_flat_lut_smooth_step);
   RUN_TEST(test_below_min_Pump_Duty_Cycle_motor);
   RUN_TEST(test_below_min_Pump_Duty_Cycle_IGBT);
   RUN_TEST(test_below_min_Pump_Duty_Cycle_battery);
@@ -515,6 +2352,89 @@ int runUnityTests(void) {
   RUN_TEST(test_torque_mods_accel_brake_pressed);
   RUN_TEST(test_torque_mods_one_step);
   RUN_TEST(test_torque_mods_high_step);
+  RUN_TEST(test_dense_throttle_luts_match_interpolated);
+  RUN_TEST(test_dense_throttle_luts_rebuilt_on_new_accel_lut);
+  RUN_TEST(test_torque_mods_dense_matches_interpolated);
+  // 2-D torque map
+  RUN_TEST(test_grid_lut_bilinear);
+  RUN_TEST(test_torque_map_matches_pipeline);
+  RUN_TEST(test_torque_map_rebuilt_on_new_accel_lut);
+  RUN_TEST(test_throttle_tables_follow_mode);
+  // CAN LUT hot swap
+  RUN_TEST(test_accel_LUT_install_rejects_invalid);
+  RUN_TEST(test_accel_LUT_install_waits_for_pinned_bank);
+#ifndef ARDUINO
+  RUN_TEST(test_accel_LUT_hot_swap_under_load);
+#endif
+  // CAN LUT upload receiver
+  RUN_TEST(test_lut_upload_encoding_round_trip);
+  RUN_TEST(test_lut_upload_commits_once_complete);
+  RUN_TEST(test_lut_upload_never_mixes_sequences);
+  RUN_TEST(test_lut_upload_interleaves_tables);
+  RUN_TEST(test_lut_upload_rejects_bad_crc);
+  RUN_TEST(test_lut_upload_checks_no_file_header);
+  RUN_TEST(test_lut_upload_naks_reused_sequence);
+  RUN_TEST(test_lut_upload_installs_on_commit);
+  RUN_TEST(test_lut_upload_bus_time);
+#ifndef ARDUINO
+  RUN_TEST(test_lut_upload_allocation_free);
+#endif
+  // drive profiles
+  RUN_TEST(test_profile_switch_from_can);
+  RUN_TEST(test_profile_switch_at_cycle_boundary);
+  RUN_TEST(test_profile_upload_targets_active_profile);
+  RUN_TEST(test_profile_switch_waits_for_throttle_slot);
+  // persistent LUT bank
+#ifndef ARDUINO
+  RUN_TEST(test_lut_store_round_trip);
+  RUN_TEST(test_lut_store_keeps_previous_image);
+#endif
+  // cyclic executive
+  RUN_TEST(test_executive_rate_monotonic_order);
+  RUN_TEST(test_executive_counts_overruns);
+  // CAN I/O <-> control snapshots
+  RUN_TEST(test_snapshot_buffer_latest_value);
+#ifndef ARDUINO
+  RUN_TEST(test_snapshot_buffer_threads);
+#endif
+  RUN_TEST(test_vehicle_snapshot_one_sample_per_cycle);
+  // pedal ADC acquisition
+  RUN_TEST(test_pedal_adc_decode);
+  RUN_TEST(test_pedal_acquisition_rejects_bad_config);
+#ifndef ARDUINO
+  RUN_TEST(test_pedal_acquisition_oversamples);
+  RUN_TEST(test_pedal_acquisition_threads);
+#endif
+  // event-triggered torque frames
+#ifndef ARDUINO
+  RUN_TEST(test_torque_tx_pedal_to_bus_latency);
+  RUN_TEST(test_torque_tx_fallback_keeps_bus_alive);
+  RUN_TEST(test_torque_tx_zero_after_stalled_commands);
+#endif
+  // deferred event log
+  RUN_TEST(test_event_log_order_and_format);
+  RUN_TEST(test_event_log_counts_overruns);
+#ifndef ARDUINO
+  RUN_TEST(test_event_log_threads);
+#endif
+  // control rate / WCET budget
+  RUN_TEST(test_executive_decimated_period);
+  RUN_TEST(test_wcet_harness_budget);
+  // stage profiler
+  RUN_TEST(test_profiler_stats_and_histogram);
+#ifndef ARDUINO
+  RUN_TEST(test_profiler_scope_and_report);
+#endif
+  // temp derating stage
+  RUN_TEST(test_temp_mod_reuses_unchanged_inputs);
+  RUN_TEST(test_thermal_frame_matches_separate_stages);
+  RUN_TEST(test_thermal_frame_reuses_unchanged_temperatures);
+#ifndef ARDUINO
+  RUN_TEST(test_control_cycle_allocation_free);
+#endif
+  // batch evaluation
+  RUN_TEST(test_lookup_batch_matches_scalar);
+  RUN_TEST(test_torque_reqs_batch_matches_scalar);
   // temp mod
   RUN_TEST(test_temp_mod_nominal);
   RUN_TEST(test_temp_mod_extreme_degrade);
@@ -546,6 +2466,11 @@ int runUnityTests(void) {
   RUN_TEST(test_integration_extreme_values);
   RUN_TEST(test_integration_small_fractional);
   RUN_TEST(test_integration_boundary_cases);
+  // fixed point pipeline
+  RUN_TEST(test_fixed_point_pipeline_max_deviation);
+  RUN_TEST(test_fixed_point_pipeline_follows_mode);
+  // segment cache
+  RUN_TEST(test_LUT_cache_hit_rate_drive_replay);
 
   return UNITY_END();
 }